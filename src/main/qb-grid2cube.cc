@@ -0,0 +1,236 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// qb-grid2cube.cc: convert the binary grid files written by saveden -binary
+// and savedenfreq (saveden_format binary|float) to cube or VTK
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#include <qball/GridFile.h>
+
+using namespace std;
+
+// big endian copy of a double, as required by binary VTK files
+static void write_be(ostream& os, double v)
+{
+#ifndef WORDS_BIGENDIAN
+  unsigned char* c = (unsigned char*) &v;
+  for ( int i = 0; i < 4; i++ )
+  {
+    unsigned char tmp = c[i]; c[i] = c[7-i]; c[7-i] = tmp;
+  }
+#endif
+  os.write((const char*) &v, sizeof(double));
+}
+
+int main(int argc, char** argv)
+{
+  bool vtk = false;
+  string infile, outbase;
+  for ( int i = 1; i < argc; i++ )
+  {
+    string arg(argv[i]);
+    if ( arg == "-vtk" )
+      vtk = true;
+    else if ( arg[0] != '-' && infile.empty() )
+      infile = arg;
+    else if ( arg[0] != '-' && outbase.empty() )
+      outbase = arg;
+    else
+      infile = "";
+  }
+  if ( infile.empty() )
+  {
+    cerr << "Usage: " << argv[0] << " [-vtk] file.grid [outbase]" << endl;
+    cerr << "  writes outbase.cube (x, y, z prefixes for vector fields)" << endl;
+    cerr << "  or outbase.vtk, outbase defaults to file without .grid" << endl;
+    return 1;
+  }
+  if ( outbase.empty() )
+  {
+    outbase = infile;
+    if ( outbase.size() > 5 && outbase.substr(outbase.size()-5) == ".grid" )
+      outbase = outbase.substr(0,outbase.size()-5);
+  }
+
+  ifstream is(infile.c_str(),ios::binary);
+  GridFileHeader h;
+  if ( !is || !h.read(is) )
+  {
+    cerr << argv[0] << ": " << infile << " is not a qball grid file" << endl;
+    return 1;
+  }
+  const int np0 = h.np[0];
+  const int np1 = h.np[1];
+  const int np2 = h.np[2];
+  const long long int n = h.npoints();
+
+  vector<vector<double> > f(h.nfields,vector<double>(n));
+  for ( int k = 0; k < h.nfields; k++ )
+  {
+    if ( h.wordsize == 4 )
+    {
+      vector<float> buf(n);
+      is.read((char*) &buf[0],n*sizeof(float));
+      for ( long long int i = 0; i < n; i++ )
+        f[k][i] = buf[i];
+    }
+    else
+      is.read((char*) &f[k][0],n*sizeof(double));
+  }
+  if ( !is )
+  {
+    cerr << argv[0] << ": " << infile << " is truncated" << endl;
+    return 1;
+  }
+
+  // as in the cube files written by qball, the grid is centered on the
+  // origin: point (i,j,k) of the output holds point (i+np0/2,...) of the file
+  const D3vector origin = h.origin - (np0/2)*h.d[0] - (np1/2)*h.d[1]
+                          - (np2/2)*h.d[2];
+
+  if ( !vtk )
+  {
+    const char* prefix[3] = { "x", "y", "z" };
+    for ( int k = 0; k < h.nfields; k++ )
+    {
+      string filename = outbase + ".cube";
+      if ( h.nfields == 3 )
+        filename = prefix[k] + outbase + ".cube";
+      else if ( h.nfields > 1 )
+      {
+        ostringstream oss;
+        oss << outbase << "." << k << ".cube";
+        filename = oss.str();
+      }
+      ofstream os(filename.c_str());
+      os.setf(ios::fixed,ios::floatfield);
+      os << setprecision(8);
+      os << "Qbox " << h.label << " in VMD CUBE format" << endl;
+      os << "  iteration " << h.mditer << ", stride " << h.stride << endl;
+      os << h.natoms() << " " << origin << endl;
+      os << np0 << " " << h.d[0] << endl;
+      os << np1 << " " << h.d[1] << endl;
+      os << np2 << " " << h.d[2] << endl;
+      for ( int ia = 0; ia < h.natoms(); ia++ )
+      {
+        const double* a = &h.atoms[4*ia];
+        os << (int) a[0] << " " << a[0] << " " << a[1] << " " << a[2]
+           << " " << a[3] << endl;
+      }
+      os.setf(ios::scientific,ios::floatfield);
+      os << setprecision(5);
+      int cnt = 0;
+      for ( int i = 0; i < np0; i++ )
+      {
+        const int ip = (i + np0/2) % np0;
+        for ( int j = 0; j < np1; j++ )
+        {
+          const int jp = (j + np1/2) % np1;
+          for ( int l = 0; l < np2; l++ )
+          {
+            const int lp = (l + np2/2) % np2;
+            os << f[k][ip + (long long int)np0*(jp + np1*lp)] << " ";
+            if ( ++cnt >= 6 )
+            {
+              cnt = 0;
+              os << '\n';
+            }
+          }
+        }
+      }
+      os << endl;
+      cout << "wrote " << filename << endl;
+    }
+  }
+  else
+  {
+    string filename = outbase + ".vtk";
+    ofstream os(filename.c_str(),ios::binary);
+    const bool ortho = h.d[0].y == 0.0 && h.d[0].z == 0.0 &&
+                       h.d[1].x == 0.0 && h.d[1].z == 0.0 &&
+                       h.d[2].x == 0.0 && h.d[2].y == 0.0;
+    os << "# vtk DataFile Version 2.0" << endl;
+    os << "qbox " << h.label << ", iteration " << h.mditer << endl;
+    os << "BINARY" << endl;
+    if ( ortho )
+    {
+      os << "DATASET STRUCTURED_POINTS" << endl;
+      os << "DIMENSIONS\t" << np0 << '\t' << np1 << '\t' << np2 << endl;
+      os << "ORIGIN\t" << origin.x << '\t' << origin.y << '\t' << origin.z
+         << endl;
+      os << "SPACING\t" << h.d[0].x << '\t' << h.d[1].y << '\t' << h.d[2].z
+         << endl;
+    }
+    else
+    {
+      // non-orthogonal cell: explicit point coordinates
+      os << "DATASET STRUCTURED_GRID" << endl;
+      os << "DIMENSIONS\t" << np0 << '\t' << np1 << '\t' << np2 << endl;
+      os << "POINTS " << n << " double" << endl;
+      for ( int l = 0; l < np2; l++ )
+        for ( int j = 0; j < np1; j++ )
+          for ( int i = 0; i < np0; i++ )
+          {
+            const D3vector r = origin + i*h.d[0] + j*h.d[1] + l*h.d[2];
+            write_be(os,r.x);
+            write_be(os,r.y);
+            write_be(os,r.z);
+          }
+      os << endl;
+    }
+    os << "POINT_DATA\t" << n << endl;
+    if ( h.nfields == 3 )
+      os << "VECTORS field double" << endl;
+    else
+      os << "SCALARS field double " << h.nfields << endl
+         << "LOOKUP_TABLE default" << endl;
+    for ( int l = 0; l < np2; l++ )
+    {
+      const int lp = (l + np2/2) % np2;
+      for ( int j = 0; j < np1; j++ )
+      {
+        const int jp = (j + np1/2) % np1;
+        for ( int i = 0; i < np0; i++ )
+        {
+          const int ip = (i + np0/2) % np0;
+          for ( int k = 0; k < h.nfields; k++ )
+            write_be(os,f[k][ip + (long long int)np0*(jp + np1*lp)]);
+        }
+      }
+    }
+    cout << "wrote " << filename << endl;
+  }
+  return 0;
+}
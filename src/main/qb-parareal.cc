@@ -0,0 +1,231 @@
+////////////////////////////////////////////////////////////////////////////////  
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC. 
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory. 
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008 
+// LLNL-CODE-635376. All rights reserved. 
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+//
+// qb-parareal.cc: Parareal time-parallel driver for RT-TDDFT.
+//
+// usage: qball-parareal inputfile nslices nfine ncoarse [kmax [tol]]
+//
+// The tasks are split into nslices groups, each running its own copy of
+// inputfile (which prepares the initial state and sets wf_dyn and tddt but
+// should not contain the TD run command).  Group g propagates time slice g,
+// of length nfine*tddt.  The fine propagator is wf_dyn with nfine steps of
+// tddt, the coarse propagator is AETRS with ncoarse steps of
+// nfine*tddt/ncoarse.  The Parareal correction
+//   U_{g+1}^{k+1} = G(U_g^{k+1}) + F(U_g^k) - G(U_g^k)
+// is passed from group to group along a communicator linking the tasks
+// with equal rank in each group.  The iteration stops after kmax sweeps or
+// when the end-of-slice density (L1 norm) and electronic
+// dipole change by less than tol in every slice.
+// The TD state records, -mpiio checkpoints, grid files and the observable
+// log are written over the communicator of the slice.  savefreq
+// checkpoints (one file per state) communicate over MPI_COMM_WORLD and
+// would hang, and would be rewritten by every iteration: they are
+// rejected.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+#include <cassert>
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <complex>
+#include <mpi.h>
+#include <vector>
+using namespace std;
+
+#include <qball/qbLink.h>
+
+namespace {
+void send_wf(const vector<complex<double> >& c, int dest, MPI_Comm comm) {
+  MPI_Send((void*) &c[0],2*c.size(),MPI_DOUBLE,dest,0,comm);
+}
+void recv_wf(vector<complex<double> >& c, int source, MPI_Comm comm) {
+  MPI_Status status;
+  MPI_Recv(&c[0],2*c.size(),MPI_DOUBLE,source,0,comm,&status);
+  int count;
+  MPI_Get_count(&status,MPI_DOUBLE,&count);
+  assert(count == 2*c.size());
+}
+}
+
+int main(int argc, char **argv) {
+
+  int mype;
+  int npes;
+  MPI_Init(&argc,&argv);
+  MPI_Comm_size(MPI_COMM_WORLD, &npes);
+  MPI_Comm_rank(MPI_COMM_WORLD, &mype);
+
+  if (argc < 5 || argc > 7) {
+    if (mype == 0) 
+      cout << "use: qball-parareal inputfile nslices nfine ncoarse [kmax [tol]]" << endl;
+    MPI_Finalize();
+    return 1;
+  }
+
+  const string inpfile(argv[1]);
+  const int nslices = atoi(argv[2]);
+  const int nfine = atoi(argv[3]);
+  const int ncoarse = atoi(argv[4]);
+  const int kmax = ( argc > 5 ) ? atoi(argv[5]) : nslices;
+  const double tol = ( argc > 6 ) ? atof(argv[6]) : 1.e-4;
+  if (nslices <= 0 || nfine <= 0 || ncoarse <= 0) {
+    if (mype == 0)
+      cout << "<ERROR> qball-parareal: nslices, nfine and ncoarse must be "
+           << "positive </ERROR>" << endl;
+    MPI_Abort(MPI_COMM_WORLD,1);
+  }
+
+  int npes_sub = npes/nslices;
+  if (npes_sub <= 0) {
+    if (mype == 0)
+      cout << "<ERROR> qball-parareal: " << nslices << " time slices need at "
+           << "least as many tasks, npes = " << npes << " </ERROR>" << endl;
+    MPI_Abort(MPI_COMM_WORLD,1);
+  }
+  if (npes%nslices != 0 && mype == 0) 
+    cout << "<WARNING> " << npes%nslices << " tasks left idle: npes_sub = " << npes_sub << " </WARNING>" << endl;
+
+  // qbLink construction is collective over MPI_COMM_WORLD
+  vector<qbLink*> qb(nslices);
+  int firstpe = 0;
+  for (int i=0; i<nslices; i++) {
+    int lastpe = firstpe + npes_sub-1;
+    ostringstream outfile;
+    outfile << inpfile << ".slice" << i << ".out";
+    qb[i] = new qbLink(outfile.str(),firstpe,lastpe);
+    firstpe += npes_sub;
+  }
+
+  // link tasks of equal rank in consecutive slices
+  const int islice = mype/npes_sub;
+  const bool inslice = ( islice < nslices );
+  MPI_Comm timecomm;
+  MPI_Comm_split(MPI_COMM_WORLD,inslice ? mype%npes_sub : MPI_UNDEFINED,
+                 islice,&timecomm);
+
+  if (inslice) {
+    qbLink& q = *qb[islice];
+    assert(q.active());
+    const bool oncoutpe = ( mype == 0 );
+    const bool first = ( islice == 0 );
+    const bool last = ( islice == nslices-1 );
+
+    q.processInputFile(inpfile);
+    if (q.get_savefreq() > 0) {
+      if (oncoutpe)
+        cout << "<ERROR> qball-parareal: savefreq checkpoints are not "
+             << "supported in time slices, set savefreq 0 </ERROR>" << endl;
+      MPI_Abort(MPI_COMM_WORLD,1);
+    }
+    const string wf_dyn = q.get_wf_dyn();
+    const double tddt = q.get_tddt();
+    const double tddt_coarse = tddt*nfine/ncoarse;
+    if (oncoutpe)
+      cout << "<parareal nslices=\"" << nslices << "\" wf_dyn=\"" << wf_dyn
+           << "\" tddt=\"" << tddt << "\" nfine=\"" << nfine
+           << "\" tddt_coarse=\"" << tddt_coarse << "\" ncoarse=\"" << ncoarse
+           << "\"/>" << endl;
+
+    // u: start state of the slice, g: coarse propagation of u,
+    // unext: current estimate of the start state of the next slice
+    vector<complex<double> > u, g, f, unext;
+    q.get_wavefunction(u);
+    
+    // initial serial coarse sweep
+    if (!first) {
+      recv_wf(u,islice-1,timecomm);
+      q.set_wavefunction(u,false);
+    }
+    q.runEhrenSteps(ncoarse,"AETRS",tddt_coarse);
+    q.get_wavefunction(g);
+    if (!last)
+      send_wf(g,islice+1,timecomm);
+    unext = g;
+
+    vector<double> rho, rho_prev;
+    double dip[3], dip_prev[3];
+    q.get_density(rho_prev,dip_prev);
+
+    bool converged = false;
+    for ( int k = 0; k < kmax && !converged; k++ ) {
+      // fine propagation of all slices, concurrently
+      q.set_wavefunction(u,false);
+      q.runEhrenSteps(nfine,wf_dyn,tddt);
+      q.get_wavefunction(f);
+
+      // serial coarse correction sweep
+      if (!first) {
+        recv_wf(u,islice-1,timecomm);
+        q.set_wavefunction(u,false);
+        q.runEhrenSteps(ncoarse,"AETRS",tddt_coarse);
+        vector<complex<double> > gnew;
+        q.get_wavefunction(gnew);
+        for ( int i = 0; i < unext.size(); i++ )
+          unext[i] = gnew[i] + f[i] - g[i];
+        g.swap(gnew);
+      }
+      else {
+        // the start of the first slice is exact
+        unext = f;
+      }
+      q.set_wavefunction(unext,!first);
+      q.get_wavefunction(unext);
+      if (!last)
+        send_wf(unext,islice+1,timecomm);
+
+      // change of the end-of-slice state since the previous iteration
+      q.get_density(rho,dip);
+      double change[2];
+      change[0] = q.density_difference(rho,rho_prev);
+      change[1] = 0.0;
+      for ( int i = 0; i < 3; i++ )
+        change[1] = max(change[1],fabs(dip[i]-dip_prev[i]));
+      double maxchange[2];
+      MPI_Allreduce(change,maxchange,2,MPI_DOUBLE,MPI_MAX,timecomm);
+      rho_prev.swap(rho);
+      for ( int i = 0; i < 3; i++ )
+        dip_prev[i] = dip[i];
+
+      converged = ( maxchange[0] < tol && maxchange[1] < tol );
+      if (oncoutpe)
+        cout << "<parareal_iteration k=\"" << k+1 << "\" density_change=\""
+             << maxchange[0] << "\" dipole_change=\"" << maxchange[1]
+             << "\"/>" << endl;
+    }
+    if (oncoutpe)
+      cout << "<parareal_" << ( converged ? "converged" : "not_converged" )
+           << "/>" << endl;
+    MPI_Comm_free(&timecomm);
+  }
+
+  for (int i=0; i<nslices; i++) 
+    if (qb[i] != 0)
+      delete qb[i];
+
+  MPI_Finalize();
+}
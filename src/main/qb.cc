@@ -66,6 +66,7 @@ using namespace std;
 #include <ui/RandomizeRealWfCmd.h>
 #include <ui/RandomizeVelCmd.h>
 #include <ui/RunCmd.h>
+#include <ui/RunKicksCmd.h>
 #include <ui/MDSaveCmd.h>
 #include <ui/SaveCmd.h>
 #include <ui/SavesysCmd.h>
@@ -127,6 +128,7 @@ using namespace std;
 #include <vars/Force_Complex_WF.h>
 #include <vars/Non_Selfconsistent_Energy_Output.h>
 #include <vars/TDDt.h>
+#include <vars/TDDtAdapt.h>
 #include <vars/NA_overlaps.h>
 #include <vars/Dt.h>
 #include <vars/Nempty.h>
@@ -137,6 +139,8 @@ using namespace std;
 #include <vars/Stress.h>
 #include <vars/Thermostat.h>
 #include <vars/ThresholdScf.h>
+#include <vars/KrylovTol.h>
+#include <vars/ChebyshevTol.h>
 #include <vars/ThresholdForce.h>
 #include <vars/ThresholdStress.h>
 #include <vars/ThTemp.h>
@@ -170,6 +174,11 @@ using namespace std;
 #include <vars/Pblock.h>
 #include <vars/SaveFreq.h>
 #include <vars/SaveDenFreq.h>
+#include <vars/SaveAsync.h>
+#include <vars/SaveCompression.h>
+#include <vars/SaveDenFormat.h>
+#include <vars/ObservableLogFile.h>
+#include <vars/SpeciesCacheDir.h>
 #include <vars/SaveWfFreq.h>
 #include <vars/SaveProjFreq.h>
 #include <vars/SaveHoleFreq.h>
@@ -180,6 +189,7 @@ using namespace std;
 #include <vars/GaussField.h>
 #include <vars/SineField.h>
 #include <vars/CalDipFreq.h>
+#include <vars/EnergyOutputFreq.h>
 #include <vars/NetCharge.h>
 #include <vars/EsmBC.h>
 #include <vars/EsmW.h>
@@ -195,6 +205,7 @@ using namespace std;
 #include <vars/BlHF.h>
 #include <vars/BtHF.h>
 #include <vars/MLWFDist.h>
+#include <vars/MLWFSubbox.h>
 #include <vars/Vext.h> 
 
 #ifdef HAVE_BGQLIBS
@@ -356,6 +367,7 @@ int main(int argc, char **argv, char **envp)
   ui->addCmd(new RandomizeRealWfCmd(s));
   ui->addCmd(new RandomizeVelCmd(s));
   ui->addCmd(new RunCmd(s));
+  ui->addCmd(new RunKicksCmd(s));
   ui->addCmd(new MDSaveCmd(s));
   ui->addCmd(new SaveCmd(s));
   ui->addCmd(new SavesysCmd(s));
@@ -390,6 +402,7 @@ int main(int argc, char **argv, char **envp)
   ui->addVar(new BlHF(s));
   ui->addVar(new BtHF(s));
   ui->addVar(new MLWFDist(s));
+  ui->addVar(new MLWFSubbox(s));
   ui->addVar(new Cell(s));
   ui->addVar(new CellDyn(s));
   ui->addVar(new CellLock(s));
@@ -420,6 +433,8 @@ int main(int argc, char **argv, char **envp)
   ui->addVar(new Stress(s));
   ui->addVar(new Thermostat(s));
   ui->addVar(new ThresholdScf(s));
+  ui->addVar(new KrylovTol(s));
+  ui->addVar(new ChebyshevTol(s));
   ui->addVar(new ThresholdForce(s));
   ui->addVar(new ThresholdStress(s));
   ui->addVar(new ThTemp(s));
@@ -452,10 +467,16 @@ int main(int argc, char **argv, char **envp)
   ui->addVar(new Force_Complex_WF(s));
   ui->addVar(new Non_Selfconsistent_Energy_Output(s));
   ui->addVar(new TDDt(s));
+  ui->addVar(new TDDtAdapt(s));
   ui->addVar(new NA_overlaps(s));
   ui->addVar(new WF_Phase_RealVar(s));
   ui->addVar(new SaveFreq(s));
   ui->addVar(new SaveDenFreq(s));
+  ui->addVar(new SaveAsync(s));
+  ui->addVar(new SaveCompression(s));
+  ui->addVar(new SaveDenFormat(s));
+  ui->addVar(new ObservableLogFile(s));
+  ui->addVar(new SpeciesCacheDir(s));
   ui->addVar(new SaveWfFreq(s));
   ui->addVar(new SaveProjFreq(s));
   ui->addVar(new SaveHoleFreq(s));
@@ -467,6 +488,7 @@ int main(int argc, char **argv, char **envp)
   ui->addVar(new GaussField(s));
   ui->addVar(new SineField(s));
   ui->addVar(new CalDipFreq(s));
+  ui->addVar(new EnergyOutputFreq(s));
   ui->addVar(new NetCharge(s));
   ui->addVar(new EsmBC(s));
   ui->addVar(new EsmW(s));
@@ -488,16 +510,12 @@ int main(int argc, char **argv, char **envp)
   if ( argc == 2 )
   {
     // input file was given as a command line argument
+    // it is read once and broadcast to all tasks
     bool echo = true;
-    ifstream in;
-    if ( ctxt.oncoutpe() ) {
-      in.open(argv[1], ios::in);
-      if(!in.is_open()) {
-	ui->error(string("Cannot open input file: ") + argv[1]);
-	exit(1);
-      }
+    if ( !ui->processFile(argv[1], "[qball]", echo, /*interactive =*/ false) ) {
+      ui->error(string("Cannot open input file: ") + argv[1]);
+      exit(1);
     }
-    ui->processCmds(in, "[qball]", echo, /*interactive =*/ false);
   }
   else
   {
@@ -60,6 +60,16 @@ class Spline {
     spline(x, y, n, yp1, ypn, &y2_[0]);
   }
 
+  // raw data of a fitted spline, used to store and restore it
+  const std::vector<double> & x() const { return x_; }
+  const std::vector<double> & y() const { return y_; }
+  const std::vector<double> & y2() const { return y2_; }
+  void set(const std::vector<double> & x, const std::vector<double> & y, const std::vector<double> & y2){
+    x_ = x;
+    y_ = y;
+    y2_ = y2;
+  }
+
   double value(const double & x) const {
     double y;
     splint(&x_[0], &y_[0], &y2_[0], x_.size(), x, &y);
@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// AsyncFileWriter.cc
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#include "AsyncFileWriter.h"
+#include <fstream>
+#include <iostream>
+using namespace std;
+
+namespace {
+void write_file(const string& filename, const string& data)
+{
+  ofstream os(filename.c_str(),ofstream::binary);
+  if ( !os.is_open() )
+  {
+    cout << "<ERROR> AsyncFileWriter: cannot open " << filename
+         << " </ERROR>" << endl;
+    return;
+  }
+  os.write(data.data(),data.size());
+  os.close();
+}
+
+void run_jobs(vector<function<void()> >* jobs)
+{
+  for ( int i = 0; i < jobs->size(); i++ )
+    (*jobs)[i]();
+  delete jobs;
+}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void AsyncFileWriter::add_file(const string& filename, string& data)
+{
+  // the shared_ptr keeps the copy of the job cheap
+  std::shared_ptr<string> buf = std::make_shared<string>();
+  buf->swap(data);
+  staged_size_ += buf->size();
+  staged_.push_back([filename,buf]() { write_file(filename,*buf); });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool AsyncFileWriter::busy(void) const
+{
+#ifdef HAVE_PTHREAD
+  return thread_.joinable();
+#else
+  return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void AsyncFileWriter::flush(void)
+{
+  wait();
+  vector<function<void()> >* jobs = new vector<function<void()> >;
+  jobs->swap(staged_);
+  staged_size_ = 0.0;
+#ifdef HAVE_PTHREAD
+  thread_ = thread(run_jobs,jobs);
+#else
+  run_jobs(jobs);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void AsyncFileWriter::wait(void)
+{
+#ifdef HAVE_PTHREAD
+  if ( thread_.joinable() )
+    thread_.join();
+#endif
+}
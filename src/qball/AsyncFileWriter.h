@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// AsyncFileWriter.h
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#ifndef ASYNCFILEWRITER_H
+#define ASYNCFILEWRITER_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <memory>
+#ifdef HAVE_PTHREAD
+#include <thread>
+#endif
+using namespace std;
+
+// Writes checkpoint files in a background thread (save_async ON).
+// The data of a checkpoint is first copied to staging buffers with add()
+// or add_file(); flush() then hands the staged jobs to a thread that
+// writes them to disk while the calling task continues. A new flush()
+// (or wait()) blocks until the previous one has finished.
+// The jobs only do file I/O and must not make MPI calls. Without thread
+// support the jobs are run synchronously in flush().
+class AsyncFileWriter
+{
+  private:
+
+  vector<function<void()> > staged_;
+#ifdef HAVE_PTHREAD
+  thread thread_;
+#endif
+  double staged_size_;
+
+  public:
+
+  // stage a job run by the background thread
+  void add(const function<void()>& job) { staged_.push_back(job); }
+  // stage a binary file, data is moved to the staging buffer
+  void add_file(const string& filename, string& data);
+  // size in bytes of the staged files
+  double staged_size(void) const { return staged_size_; }
+  bool busy(void) const;
+
+  // start writing the staged jobs, after the previous flush is done
+  void flush(void);
+  // wait until all files handed to flush() are written
+  void wait(void);
+
+  AsyncFileWriter() : staged_size_(0.0) {}
+  ~AsyncFileWriter() { wait(); }
+};
+#endif
+
+// Local Variables:
+// mode: c++
+// End:
@@ -54,6 +54,9 @@
 #include "SimpleConvergenceDetector.h"
 #include "Hugoniostat.h"
 #include "PrintMem.h"
+#include "AsyncFileWriter.h"
+#include "CheckpointCompressor.h"
+#include "GridFile.h"
 #include "FourierTransform.h"
 #include "profile.h"
 #include <fstream>
@@ -1399,7 +1402,20 @@ void BOSampleStepper::step(int niter)
 
             const Context* wfctxt = s_.wf.spincontext(0);
             FourierTransform* ft_ = cd_.vft();
-            if (wfctxt->mycol() == 0) {
+            if ( s_.ctrl.saveden_format != "cube" ) {
+               // all tasks write their slab of the grid, see GridFile.h
+               GridFileHeader h;
+               h.label = "electron density";
+               h.wordsize = ( s_.ctrl.saveden_format == "float" ) ? 4 : 8;
+               h.stride = s_.ctrl.saveden_stride;
+               h.mditer = s_.ctrl.mditer;
+               h.set_atoms(s_.atoms);
+               vector<const double*> fields(1,cd_.rhor[0].data());
+               const UnitCell& cell = s_.wf.cell();
+               GridFile::write(filebase + "." + oss.str() + ".grid",h,fields,*ft_,*wfctxt,
+                               s_.ctxt_,cell.a(0),cell.a(1),cell.a(2));
+            }
+            else if (wfctxt->mycol() == 0) {
                vector<double> rhortmp(ft_->np012loc());
                for (int j = 0; j < ft_->np012loc(); j++)
                   rhortmp[j] = cd_.rhor[0][j];
@@ -1412,8 +1428,7 @@ void BOSampleStepper::step(int niter)
                   }
                }
                if ( wfctxt->oncoutpe() ) {
-                  ofstream os;
-                  os.open(denfilename.c_str(),ofstream::out);    // text output
+                  ostringstream os;    // cube header
                   os.setf(ios::fixed,ios::floatfield);
                   os << setprecision(8);
                   vector<double> tmprecv(ft_->np012());
@@ -1468,29 +1483,27 @@ void BOSampleStepper::step(int niter)
                   }
 
                   // write density data to file
-                  int cnt = 0;
-                  for (int ii = 0; ii < np0; ii++) {
-                     const int ip = (ii + np0/2) % np0;
-                     ostringstream oss;
-                     oss.setf(ios::scientific,ios::floatfield);
-                     oss << setprecision(5);
-                     for (int jj = 0; jj < np1; jj++) {
-                        const int jp = (jj + np1/2) % np1;
-                        for (int kk = 0; kk < np2; kk++) {
-                           const int kp = (kk + np2/2) % np2;
-                           int index = ip + jp*np0 + kp*np0*np1;
-                           oss << tmprecv[index] << " ";
-                           cnt++;
-                           if (cnt >= 6) {
-                              cnt = 0;
-                              oss << endl;
-                           }
-                        }
-                     }
-                     string tos = oss.str();
-                     os.write(tos.c_str(),tos.length());
+                  if ( s_.ctrl.save_async ) {
+                     // format and write the file in the background
+                     if ( s_.ckpt_writer == 0 )
+                        s_.ckpt_writer = new AsyncFileWriter();
+                     const string header = os.str();
+                     std::shared_ptr<vector<double> > rho = std::make_shared<vector<double> >();
+                     rho->swap(tmprecv);
+                     s_.ckpt_writer->add([denfilename,header,rho,np0,np1,np2]() {
+                        ofstream dos(denfilename.c_str(),ofstream::out);
+                        dos << header;
+                        ChargeDensity::write_cube_data(dos,*rho,np0,np1,np2);
+                        dos.close();
+                     });
+                     s_.ckpt_writer->flush();
+                  }
+                  else {
+                     ofstream dos(denfilename.c_str(),ofstream::out);    // text output
+                     dos << os.str();
+                     ChargeDensity::write_cube_data(dos,tmprecv,np0,np1,np2);
+                     dos.close();
                   }
-                  os.close();
                }
             }
          }
@@ -1584,7 +1597,18 @@ void BOSampleStepper::step(int niter)
                }
             }
             string filestr = dirstr + "/" + filebase;
-            s_.wf.write_states(filestr,format);
+            AsyncFileWriter* writer = 0;
+            if ( s_.ctrl.save_async )
+            {
+               if ( s_.ckpt_writer == 0 )
+                  s_.ckpt_writer = new AsyncFileWriter();
+               writer = s_.ckpt_writer;
+            }
+            CheckpointCompressor cmp(s_.ctrl.save_compression,s_.ctrl.save_compression_tol);
+            s_.wf.write_states(filestr,format,writer,&cmp);
+            // the staged states are written while the run continues
+            if ( writer != 0 )
+               writer->flush();
             s_.wf.write_mditer(filestr,s_.ctrl.mditer);
 
             // write .sys file
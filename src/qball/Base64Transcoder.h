@@ -46,6 +46,9 @@ class Base64Transcoder
   
   Base64Transcoder();
   int encode(int nbytes, const my_byte* const from, char* const to);
+  // encode nbytes bytes and write them to o in lines of 72 chars, as
+  // print does, using a small buffer instead of the whole encoded string
+  int encode(size_t nbytes, const my_byte* const from, ostream& o);
   int decode(int nchars, const char* const from, my_byte* const to);
   void byteswap_double(size_t n, double* const x);
   void byteswap_int(size_t n, int* const x);
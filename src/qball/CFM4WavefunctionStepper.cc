@@ -0,0 +1,247 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// CFM4WavefunctionStepper.cc
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#include "CFM4WavefunctionStepper.h"
+#include "SelfConsistentPotential.h"
+#include "VectorPotential.h"
+#include "ElectricEnthalpy.h"
+#include "ChargeDensity.h"
+#include "Sample.h"
+#include "TDState.h"
+#include <iostream>
+#include <cmath>
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+CFM4WavefunctionStepper::CFM4WavefunctionStepper(Wavefunction& wf, double tddt, TimerMap& tmap, EnergyFunctional & ef, Sample & s, Wavefunction* workwf)
+    : ExponentialWavefunctionStepper(wf,tddt,tmap,ef,s,false,workwf), startwf_(0)
+{
+  potential_.resize(4);
+  vector_potential_.resize(4);
+  e_field_.resize(4);
+  step_.resize(3,tddt);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+CFM4WavefunctionStepper::~CFM4WavefunctionStepper()
+{
+  delete startwf_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CFM4WavefunctionStepper::predict_potential(std::vector<SelfConsistentPotential>& v)
+{
+  // v[0], v[1], v[2]: potential at t, t + dt/2 and t + dt. The last two
+  // come from two ETRS steps of dt/2 from psi(t); their O(dt^3) error
+  // keeps the potential at the nodes O(dt^3) for these few steps.
+  if ( startwf_ == 0 )
+    startwf_ = new Wavefunction(wf_);
+  tmap_["expowf_copy"].start();
+  *startwf_ = wf_;
+  tmap_["expowf_copy"].stop();
+
+  const double dt = tddt_;
+  const bool estimate_error = estimate_error_;
+  estimate_error_ = false;
+  tddt_ = 0.5 * dt;
+  v[0] = potential_[3];
+  for ( int i = 1; i < 3; i++ )
+  {
+    ExponentialWavefunctionStepper::preupdate();
+    ExponentialWavefunctionStepper::update(wf_);
+
+    // potential of the propagated wavefunctions
+    tmap_["expowf_ef"].start();
+    ef_.hamil_cd()->update_density();
+    ef_.update_hamiltonian();
+    ef_.update_vhxc();
+    tmap_["expowf_ef"].stop();
+    v[i] = ef_.get_self_consistent_potential();
+  }
+  tddt_ = dt;
+  estimate_error_ = estimate_error;
+
+  // back to psi(t) and H(t)
+  tmap_["expowf_copy"].start();
+  wf_ = *startwf_;
+  *s_.hamil_wf = *startwf_;
+  ef_.set_self_consistent_potential(potential_[3]);
+  tmap_["expowf_copy"].stop();
+  if ( s_.ctrl.ultrasoft )
+  {
+    workwf_->update_usfns();
+    s_.hamil_wf->update_usfns();
+  }
+  if ( ef_.el_enth() )
+  {
+    tmap_["expowf_ef"].start();
+    ef_.el_enth()->update();
+    tmap_["expowf_ef"].stop();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CFM4WavefunctionStepper::preupdate()
+{
+  // no error estimate for CFM4 steps
+  error_ = -1.0;
+
+  if ( s_.ctrl.ultrasoft )
+  {
+    workwf_->update_usfns();
+    s_.hamil_wf->update_usfns();
+  }
+
+  // save the potential, vector potential and field of the current step
+  ElectricEnthalpy* el_enth = ef_.el_enth();
+  push_history(potential_,ef_.get_self_consistent_potential());
+  push_history(vector_potential_,
+               ef_.vp ? ef_.vp->value() : vector_potential_[3]);
+  push_history(e_field_,el_enth ? el_enth->e_field() : e_field_[3]);
+  stored_iter_++;
+
+  // times of the stored steps relative to t, in units of the step
+  const int nhist = min(stored_iter_,4);
+  double x[4];
+  history_times(step_,tddt_,x);
+  double coef_hist[2][4];
+  node_weights(nhist,&x[4-nhist],coef_hist);
+
+  // Potential at the nodes: cubic through the last four steps or, at the
+  // start of a run and after a restart, predictor steps. The vector
+  // potential and the field use the available history.
+  std::vector<SelfConsistentPotential> vpts;
+  double coef_v[2][4];
+  if ( stored_iter_ >= 4 )
+  {
+    delete startwf_;
+    startwf_ = 0;
+    vpts = potential_;
+    for ( int iexp = 0; iexp < 2; iexp++ )
+      for ( int k = 0; k < 4; k++ )
+        coef_v[iexp][k] = coef_hist[iexp][k];
+  }
+  else
+  {
+    vpts.resize(3);
+    predict_potential(vpts);
+    const double xp[3] = { 0.0, 0.5, 1.0 };
+    node_weights(3,xp,coef_v);
+  }
+
+  // the Hamiltonian only depends on the field through el_enth
+  bool field_changes = false;
+  if ( el_enth )
+    for ( int k = 4-nhist; k < 3; k++ )
+      if ( norm(e_field_[k] - e_field_[3]) > 0.0 )
+        field_changes = true;
+
+  for ( int iexp = 0; iexp < 2; iexp++ )
+  {
+    // exp(-i dt (w1 H1 + w2 H2)) = exp(-i dt/2 Hmix), with Hmix linear
+    // in the potential and the field
+    tmap_["expowf_copy"].start();
+    SelfConsistentPotential mixed_potential;
+    mixed_potential.combine(vpts,coef_v[iexp]);
+    ef_.set_self_consistent_potential(mixed_potential);
+    tmap_["expowf_copy"].stop();
+    if ( ef_.vp )
+    {
+      // a constant shift of the kinetic energy, quadratic in A, only
+      // changes the global phase
+      const D3vector amix = mix_history(nhist,coef_hist[iexp],vector_potential_);
+      tmap_["expowf_ef"].start();
+      ef_.vp->set_value(amix);
+      ef_.vector_potential_changed(false);
+      tmap_["expowf_ef"].stop();
+    }
+    if ( field_changes )
+    {
+      const D3vector emix = mix_history(nhist,coef_hist[iexp],e_field_);
+      tmap_["expowf_ef"].start();
+      el_enth->update_e_field(emix);
+      el_enth->update();
+      tmap_["expowf_ef"].stop();
+    }
+
+    exponential(1, 0.5*tddt_, 0.0);
+  }
+
+  // restore the Hamiltonian at time t
+  tmap_["expowf_copy"].start();
+  ef_.set_self_consistent_potential(potential_[3]);
+  tmap_["expowf_copy"].stop();
+  if ( ef_.vp )
+  {
+    tmap_["expowf_ef"].start();
+    ef_.vp->set_value(vector_potential_[3]);
+    ef_.vector_potential_changed(false);
+    tmap_["expowf_ef"].stop();
+  }
+  if ( field_changes )
+  {
+    tmap_["expowf_ef"].start();
+    el_enth->update_e_field(e_field_[3]);
+    tmap_["expowf_ef"].stop();
+  }
+
+  // the next step sees this one at -tddt_
+  push_history(step_,tddt_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CFM4WavefunctionStepper::update(Wavefunction& dwf)
+{
+  // the step is completed in preupdate()
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CFM4WavefunctionStepper::write_state(std::ostream& os) const
+{
+  ExponentialWavefunctionStepper::write_state(os);
+  for ( int i = 0; i < vector_potential_.size(); i++ )
+    TDState::put(os,vector_potential_[i]);
+  for ( int i = 0; i < e_field_.size(); i++ )
+    TDState::put(os,e_field_[i]);
+  for ( int i = 0; i < step_.size(); i++ )
+    TDState::put(os,step_[i]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CFM4WavefunctionStepper::read_state(std::istream& is)
+{
+  ExponentialWavefunctionStepper::read_state(is);
+  for ( int i = 0; i < vector_potential_.size(); i++ )
+    TDState::get(is,vector_potential_[i]);
+  for ( int i = 0; i < e_field_.size(); i++ )
+    TDState::get(is,e_field_[i]);
+  for ( int i = 0; i < step_.size(); i++ )
+    TDState::get(is,step_[i]);
+}
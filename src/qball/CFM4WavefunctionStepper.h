@@ -0,0 +1,133 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// CFM4WavefunctionStepper.h
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#ifndef CFM4WAVEFUNCTIONSTEPPER_H
+#define CFM4WAVEFUNCTIONSTEPPER_H
+
+#include "ExponentialWavefunctionStepper.h"
+#include <math/d3vector.h>
+#include <cmath>
+using namespace std;
+
+// Fourth-order commutator-free Magnus propagator
+// U(t+dt,t) = exp(-i dt (a2 H1 + a1 H2)) exp(-i dt (a1 H1 + a2 H2))
+// with H1, H2 the Hamiltonian at t + c1 dt, t + c2 dt (Gauss-Legendre
+// nodes) and a1 = 1/4 + sqrt(3)/6, a2 = 1/4 - sqrt(3)/6.
+// The self-consistent potential, the vector potential and the electric
+// field at the nodes are taken from the cubic through the last four steps,
+// which keeps the error at the nodes O(dt^4). The first steps of a run,
+// before four steps are stored, obtain the potential at t + dt/2 and
+// t + dt from two ETRS half steps and interpolate it quadratically.
+class CFM4WavefunctionStepper : public ExponentialWavefunctionStepper
+{
+  private:
+
+  // vector potential and electric field of the last four steps
+  std::vector<D3vector> vector_potential_;
+  std::vector<D3vector> e_field_;
+  // time steps between the stored steps
+  std::vector<double> step_;
+  // psi(t) during the predictor steps at the start of a run
+  Wavefunction* startwf_;
+
+  void predict_potential(std::vector<SelfConsistentPotential>& v);
+
+  public:
+
+  // Weights of n values at the times t + x[k] dt such that
+  // sum_k coef[i][k] v_k = 2 (w1 v(t + c1 dt) + w2 v(t + c2 dt)), where
+  // v is the polynomial through the n points and (w1,w2) the weights of
+  // exponential i. The potential of exponential i is then this sum.
+  static void node_weights(int n, const double* x, double coef[2][4])
+  {
+    const double sq3 = sqrt(3.0);
+    const double c[2] = { 0.5 - sq3/6.0, 0.5 + sq3/6.0 };
+    const double a1 = 0.25 + sq3/6.0;
+    const double a2 = 0.25 - sq3/6.0;
+    // the first exponential applied is exp(-i dt (a1 H1 + a2 H2))
+    const double w[2][2] = { { a1, a2 }, { a2, a1 } };
+    for ( int iexp = 0; iexp < 2; iexp++ )
+      for ( int k = 0; k < n; k++ )
+      {
+        coef[iexp][k] = 0.0;
+        for ( int ic = 0; ic < 2; ic++ )
+        {
+          double l = 1.0;
+          for ( int j = 0; j < n; j++ )
+            if ( j != k )
+              l *= ( c[ic] - x[j] ) / ( x[k] - x[j] );
+          coef[iexp][k] += 2.0 * w[iexp][ic] * l;
+        }
+      }
+  }
+
+  // drop the oldest of the stored values and append v
+  template <class T>
+  static void push_history(std::vector<T>& h, const T& v)
+  {
+    for ( int k = 0; k+1 < h.size(); k++ )
+      h[k] = h[k+1];
+    h.back() = v;
+  }
+
+  // times x[0..3] of the last four steps relative to t, in units of tddt,
+  // from the lengths of the three steps between them
+  static void history_times(const std::vector<double>& step, double tddt,
+                            double x[4])
+  {
+    x[3] = 0.0;
+    for ( int k = 2; k >= 0; k-- )
+      x[k] = x[k+1] - step[k] / tddt;
+  }
+
+  // sum_k coef[k] h_k over the last nhist stored values
+  static D3vector mix_history(int nhist, const double* coef,
+                              const std::vector<D3vector>& h)
+  {
+    D3vector sum(0.0,0.0,0.0);
+    for ( int k = 0; k < nhist; k++ )
+      sum += coef[k] * h[h.size()-nhist+k];
+    return sum;
+  }
+
+  void preupdate();
+  void update(Wavefunction& dwf);
+  void write_state(std::ostream& os) const;
+  void read_state(std::istream& is);
+
+  CFM4WavefunctionStepper(Wavefunction& wf, double tddt, TimerMap& tmap, EnergyFunctional & ef, Sample & s, Wavefunction* workwf = 0);
+  ~CFM4WavefunctionStepper();
+};
+#endif
+
+// Local Variables:
+// mode: c++
+// coding: utf-8
+// End:
@@ -41,6 +41,7 @@
 #include "StructureFactor.h"
 #include <math/blas.h>
 #include <iomanip>
+#include <sstream>
 #ifdef HAVE_BGQLIBS
 extern "C" void cdLoop(const int size, complex<double>* v1, complex<double>* v2, complex<double>* vout);
 extern "C" void cdLoop2(const int size, double* v1, double* v2, double* vout);
@@ -172,8 +173,16 @@ void ChargeDensity::initializeSymmetries( Sample& s)
       symmultloc[i] = 0;
    }
    nsymgrp_ = 0;
-   int np2first = vft_->np2_first(vcontext_.myrow());
-   int np2last = np2first + vft_->np2_loc(vcontext_.myrow());
+   int np2first = vft_->np2_first();
+   int np2last = np2first + vft_->np2_loc();
+
+   // task owning each plane k of the grid
+   const int nprocs = vcontext_.size();
+   vector<int> kowner(np2v_);
+   for (int iproc=0; iproc<nprocs; iproc++)
+      for (int k=vft_->np2_first(iproc);
+           k<vft_->np2_first(iproc)+vft_->np2_loc(iproc); k++)
+         kowner[k] = iproc;
 
    for (int sy=0; sy<nsym_; sy++) {
       if (s.symmetries.symlist[sy]->setGrid(np0v_,np1v_,np2v_)) {
@@ -196,24 +205,36 @@ void ChargeDensity::initializeSymmetries( Sample& s)
       for (int j=0; j<np1v_; j++) 
          for (int k=0; k<np2v_; k++) 
             doneit[i][j][k] = 0;
+
+   // each group is owned by the task holding its first point, at slot
+   // nown[owner] of the owner's list. A group touching local points gets
+   // a local index in the lists symowner and symslot.
+   vector<int> nown(nprocs,0);
+   vector<int> symowner, symslot;
      
    for (int i=0; i<np0v_; i++) {
       for (int j=0; j<np1v_; j++) {
          for (int k=0; k<np2v_; k++) {
             if (doneit[i][j][k] == 0) {
                doneit[i][j][k] = 1;
+               const int owner = kowner[k];
+               const int slot = nown[owner]++;
+               int igrploc = -1;
 
                // check if k is on local proc
                if (k >= np2first && k < np2last) {
                   int locindex = (k-np2first)*np1v_*np0v_ + j*np0v_ + i;
-                  symindexloc[locindex]=nsymgrp_;
+                  igrploc = symowner.size();
+                  symowner.push_back(owner);
+                  symslot.push_back(slot);
+                  symindexloc[locindex]=igrploc;
                   symmultloc[locindex]++;
                }
                  
                for (int sy=0; sy<nsym_; sy++) {
                   
-                  // map i,j,k to local index, set symindexloc[that] = nsymgrp_
-                  // symmultloc[that]++
+                  // map i,j,k to local index, set symindexloc[that] to the
+                  // local index of the group, symmultloc[that]++
 
                   int istar,jstar,kstar;
                   s.symmetries.symlist[sy]->applyToGridPoint(i,j,k,istar,jstar,kstar);
@@ -221,7 +242,12 @@ void ChargeDensity::initializeSymmetries( Sample& s)
                   // check if kstar is on local proc
                   if (kstar >= np2first && kstar < np2last) {
                      int locindex = (kstar-np2first)*np1v_*np0v_ + jstar*np0v_ + istar;
-                     symindexloc[locindex]=nsymgrp_;
+                     if (igrploc < 0) {
+                        igrploc = symowner.size();
+                        symowner.push_back(owner);
+                        symslot.push_back(slot);
+                     }
+                     symindexloc[locindex]=igrploc;
                      symmultloc[locindex]++;
                   }
                }
@@ -230,12 +256,105 @@ void ChargeDensity::initializeSymmetries( Sample& s)
          }
       }
    }
+   const int ngrploc = symowner.size();
+   int myproc = 0;
+#if USE_MPI
+   MPI_Comm_rank(vcontext_.comm(),&myproc);
+#endif
+   nsymown_ = nown[myproc];
+
+   // order the local groups by owner so that partial sums sent to each
+   // owner are contiguous
+   symscounts_.assign(nprocs,0);
+   for (int ig=0; ig<ngrploc; ig++)
+      symscounts_[symowner[ig]]++;
+   symsdispl_.assign(nprocs,0);
+   for (int iproc=1; iproc<nprocs; iproc++)
+      symsdispl_[iproc] = symsdispl_[iproc-1] + symscounts_[iproc-1];
+   vector<int> igrpmap(ngrploc);
+   vector<int> sslot(ngrploc);
+   {
+      vector<int> pos(symsdispl_);
+      for (int ig=0; ig<ngrploc; ig++) {
+         igrpmap[ig] = pos[symowner[ig]]++;
+         sslot[igrpmap[ig]] = symslot[ig];
+      }
+   }
+   for (int i=0; i<np012loc; i++)
+      symindexloc[i] = igrpmap[symindexloc[i]];
+
+   // send the owner slots of the local groups to their owners
+   symrcounts_.resize(nprocs);
+   symrdispl_.assign(nprocs,0);
+#if USE_MPI
+   MPI_Alltoall(&symscounts_[0],1,MPI_INT,&symrcounts_[0],1,MPI_INT,
+                vcontext_.comm());
+#else
+   symrcounts_ = symscounts_;
+#endif
+   for (int iproc=1; iproc<nprocs; iproc++)
+      symrdispl_[iproc] = symrdispl_[iproc-1] + symrcounts_[iproc-1];
+   const int nrecv = symrdispl_[nprocs-1] + symrcounts_[nprocs-1];
+   symrecvslot_.resize(nrecv);
+#if USE_MPI
+   MPI_Alltoallv(sslot.data(),&symscounts_[0],&symsdispl_[0],MPI_INT,
+                 symrecvslot_.data(),&symrcounts_[0],&symrdispl_[0],MPI_INT,
+                 vcontext_.comm());
+#else
+   symrecvslot_ = sslot;
+#endif
+
+   symsendbuf_.resize(ngrploc);
+   symrecvbuf_.resize(nrecv);
+   symownbuf_.resize(nsymown_);
 
    if (vcontext_.oncoutpe()) 
       cout << "<!-- Finished mapping symmetric grid points:  nsymgrp = " << nsymgrp_ << ", np012 = " << np0v_*np1v_*np2v_ << ", vbasis.size = " << vbasis_->size() << ", nsym = " << nsym_ << " -->" << endl;
 
 }
 ////////////////////////////////////////////////////////////////////////////////
+void ChargeDensity::symmetrize(double* prhor)
+{
+   // average a real space function over groups of symmetry-equivalent
+   // points: partial sums of each group are sent to the owner of the
+   // group, summed, and the averages are sent back
+   const int np012loc = vft_->np012loc();
+   const int ngrploc = symsendbuf_.size();
+   const int nrecv = symrecvbuf_.size();
+   const double nsyminv = 1./((double)nsym_+1.);
+
+   for (int ig=0; ig<ngrploc; ig++)
+      symsendbuf_[ig] = 0.0;
+   for (int i=0; i<np012loc; i++)
+      symsendbuf_[symindexloc[i]] += nsyminv*symmultloc[i]*prhor[i];
+
+#if USE_MPI
+   MPI_Alltoallv(symsendbuf_.data(),&symscounts_[0],&symsdispl_[0],MPI_DOUBLE,
+                 symrecvbuf_.data(),&symrcounts_[0],&symrdispl_[0],MPI_DOUBLE,
+                 vcontext_.comm());
+#else
+   symrecvbuf_ = symsendbuf_;
+#endif
+
+   for (int ig=0; ig<nsymown_; ig++)
+      symownbuf_[ig] = 0.0;
+   for (int k=0; k<nrecv; k++)
+      symownbuf_[symrecvslot_[k]] += symrecvbuf_[k];
+   for (int k=0; k<nrecv; k++)
+      symrecvbuf_[k] = symownbuf_[symrecvslot_[k]];
+
+#if USE_MPI
+   MPI_Alltoallv(symrecvbuf_.data(),&symrcounts_[0],&symrdispl_[0],MPI_DOUBLE,
+                 symsendbuf_.data(),&symscounts_[0],&symsdispl_[0],MPI_DOUBLE,
+                 vcontext_.comm());
+#else
+   symsendbuf_ = symrecvbuf_;
+#endif
+
+   for (int i=0; i<np012loc; i++)
+      prhor[i] = symsendbuf_[symindexloc[i]];
+}
+////////////////////////////////////////////////////////////////////////////////
 ChargeDensity::~ChargeDensity(void) {
    delete vbasis_;
    delete vft_;
@@ -477,49 +596,8 @@ void ChargeDensity::update_density() {
     }
 
     tmap["charge_sym"].start();
-    if (nsym_ > 0) {
-      int np012loc = vft_->np012loc();
-
-      int subset = 16777216; // if total density exceeds 128 megs, break sum into parts
-      double nsyminv = 1./((double)nsym_+1.);
-      if (nsymgrp_ <= subset) {
-        double symrho[nsymgrp_];
-        for (int i=0; i<nsymgrp_; i++)
-          symrho[i] = 0.0;
-      
-        const double *const prhor = &rhor[ispin][0];
-        for (int i=0; i<np012loc; i++) 
-          symrho[symindexloc[i]] += nsyminv*symmultloc[i]*prhor[i];
-
-        //wf_.spincontext(ispin)->dsum('c',nsymgrp_,1,&symrho[0],nsymgrp_);
-        vcontext_.dsum('c',nsymgrp_,1,&symrho[0],nsymgrp_);
-        for (int i=0; i<np012loc; i++)
-          rhor[ispin][i] = symrho[symindexloc[i]];
-      }
-      else {
-        int nsubsets = nsymgrp_/subset;
-        if (nsymgrp_%subset != 0) nsubsets++;
-        double symrho[subset];
-        for (int n=0; n<nsubsets; n++) {
-          int min = n*subset;
-          int max = min+subset;
-          if (max > nsymgrp_) max = nsymgrp_;
-          int size = max-min+1;
-
-          for (int i=0; i<subset; i++)
-            symrho[i] = 0.0;
-          const double *const prhor = &rhor[ispin][0];
-          for (int i=0; i<np012loc; i++)
-            if (symindexloc[i] >= min && symindexloc[i] < max)
-              symrho[symindexloc[i]-min] += nsyminv*symmultloc[i]*prhor[i];
-            
-          vcontext_.dsum('c',size,1,&symrho[0],size);
-          for (int i=0; i<np012loc; i++)
-            if (symindexloc[i] >= min && symindexloc[i] < max)
-              rhor[ispin][i] = symrho[symindexloc[i]-min];
-        }
-      }
-    }
+    if (nsym_ > 0)
+      symmetrize(&rhor[ispin][0]);
     tmap["charge_sym"].stop();
     
     // check integral of charge density
@@ -1095,3 +1173,32 @@ void ChargeDensity::update_kinetic_energy_density(void)
 
   }
 } //YY
+
+////////////////////////////////////////////////////////////////////////////////
+void ChargeDensity::write_cube_data(ostream& os, const vector<double>& rhor,
+  int np0, int np1, int np2)
+{
+  // the cube grid starts at -(a0+a1+a2)/2, the FFT grid at the origin
+  int cnt = 0;
+  for (int ii = 0; ii < np0; ii++) {
+    const int ip = (ii + np0/2) % np0;
+    ostringstream oss;
+    oss.setf(ios::scientific,ios::floatfield);
+    oss << setprecision(5);
+    for (int jj = 0; jj < np1; jj++) {
+      const int jp = (jj + np1/2) % np1;
+      for (int kk = 0; kk < np2; kk++) {
+        const int kp = (kk + np2/2) % np2;
+        int index = ip + jp*np0 + kp*np0*np1;
+        oss << rhor[index] << " ";
+        cnt++;
+        if (cnt >= 6) {
+          cnt = 0;
+          oss << endl;
+        }
+      }
+    }
+    string tos = oss.str();
+    os.write(tos.c_str(),tos.length());
+  }
+}
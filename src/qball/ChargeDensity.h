@@ -64,6 +64,13 @@ class ChargeDensity {
   vector<int> symmultloc;
   int nsym_;
   int nsymgrp_;
+  // sparse symmetrization: each group of symmetry-equivalent points is
+  // owned by one task, partial sums are exchanged with MPI_Alltoallv
+  int nsymown_;
+  vector<double> symsendbuf_, symrecvbuf_, symownbuf_;
+  vector<int> symscounts_, symsdispl_, symrcounts_, symrdispl_;
+  vector<int> symrecvslot_;
+  void symmetrize(double* prhor);
   bool ultrasoft_;
   bool highmem_;
   bool nlcc_;
@@ -117,6 +124,10 @@ class ChargeDensity {
   void add_nlccden();
   void nlcc_forceden(int is, vector<complex<double> > &rhog);
   void print_memory(ostream&os, double& totsum, double& locsum) const;
+  // data section of a VMD CUBE file from the density rhor gathered on
+  // the full np0*np1*np2 grid
+  static void write_cube_data(ostream& os, const vector<double>& rhor,
+    int np0, int np1, int np2);
   void print_timing();
   
   ChargeDensity( Sample& s);
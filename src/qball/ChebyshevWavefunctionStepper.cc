@@ -0,0 +1,461 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// ChebyshevWavefunctionStepper.cc
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#include "ChebyshevWavefunctionStepper.h"
+#include "SlaterDet.h"
+#include "VectorPotential.h"
+#include "Sample.h"
+#include "TDState.h"
+#include <math/blas.h>
+#include <iostream>
+#include <valarray>
+#include <cmath>
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+// list of the Slater determinants held by this task
+static void local_sds(const Wavefunction& wf, vector<SlaterDet*>& sdlist)
+{
+  sdlist.clear();
+  for ( int ispin = 0; ispin < wf.nspin(); ispin++ )
+    if ( wf.spinactive(ispin) )
+      for ( int ikp = 0; ikp < wf.nkp(); ikp++ )
+        if ( wf.kptactive(ikp) )
+          sdlist.push_back(wf.sd(ispin,ikp));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// d[j] = Re <a_j|b_j> for the local columns j of a and b
+static void column_dots(const ComplexMatrix& a, const ComplexMatrix& b,
+  double* d)
+{
+  const int mloc = a.mloc();
+  const int nloc = a.nloc();
+  for ( int j = 0; j < nloc; j++ )
+  {
+    const complex<double>* pa = a.cvalptr(j*mloc);
+    const complex<double>* pb = b.cvalptr(j*mloc);
+    double sum = 0.0;
+    for ( int i = 0; i < mloc; i++ )
+      sum += real(conj(pa[i])*pb[i]);
+    d[j] = sum;
+  }
+  if ( nloc > 0 )
+    a.context().dsum('c',nloc,1,d,nloc);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ChebyshevWavefunctionStepper::ChebyshevWavefunctionStepper(Wavefunction& wf, double tddt, TimerMap& tmap, EnergyFunctional & ef, Sample & s, double tol, double dvmax, bool ions_move, Wavefunction* workwf)
+    : ExponentialWavefunctionStepper(wf,tddt,tmap,ef,s,false,workwf), tol_(tol), dvmax_(dvmax), have_potential_(false), have_bounds_(false), chebyshev_step_(false), ions_move_(ions_move), startwf_(0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ChebyshevWavefunctionStepper::~ChebyshevWavefunctionStepper()
+{
+  delete startwf_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int ChebyshevWavefunctionStepper::nwf_allocated(void) const
+{
+  return ExponentialWavefunctionStepper::nwf_allocated() + ( startwf_ != 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double ChebyshevWavefunctionStepper::norm_change(const Wavefunction& wf0) const
+{
+  // largest change of the norm of a state between wf0 and wf_
+  vector<SlaterDet*> sd0, sd1;
+  local_sds(wf0,sd0);
+  local_sds(wf_,sd1);
+  double dn = 0.0;
+  for ( int isd = 0; isd < sd1.size(); isd++ )
+  {
+    const ComplexMatrix& c0 = sd0[isd]->c();
+    const ComplexMatrix& c1 = sd1[isd]->c();
+    const int nloc = c1.nloc();
+    vector<double> n0(nloc), n1(nloc);
+    column_dots(c0,c0,&n0[0]);
+    column_dots(c1,c1,&n1[0]);
+    for ( int j = 0; j < nloc; j++ )
+      dn = max(dn,fabs(n1[j]-n0[j]));
+  }
+  wf_.context().dmax(1,1,&dn,1);
+  return dn;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ChebyshevWavefunctionStepper::lanczos(int nstep, double& emin, double& emax)
+{
+  // nstep Lanczos steps for each state, starting from the states in wf_.
+  // emin is the lowest Ritz value and emax the highest Ritz value plus
+  // the last off-diagonal element, an upper bound of the spectrum.
+  // wf_, newwf_ and workwf_ are overwritten.
+
+  // dummy variables to call ef_.energy
+  std::vector<std::vector<double> > fion;
+  std::valarray<double> sigma;
+
+  vector<SlaterDet*> sdq, sdp, sdw;
+  local_sds(wf_,sdq);
+  local_sds(newwf_,sdp);
+  local_sds(*workwf_,sdw);
+  const int nsd = sdq.size();
+
+  // alpha[isd][n*nloc+j], beta[isd][n*nloc+j] for local state j
+  vector<vector<double> > alpha(nsd), beta(nsd);
+  for ( int isd = 0; isd < nsd; isd++ )
+  {
+    ComplexMatrix& q = sdq[isd]->c();
+    const int nloc = q.nloc();
+    alpha[isd].resize(nstep*nloc);
+    beta[isd].resize((nstep+1)*nloc);
+    vector<double> nrm(nloc);
+    column_dots(q,q,&nrm[0]);
+    for ( int j = 0; j < nloc; j++ )
+    {
+      beta[isd][j] = 0.0;
+      const double fac = nrm[j] > 0.0 ? 1.0 / sqrt(nrm[j]) : 0.0;
+      complex<double>* p = q.valptr(j*q.mloc());
+      for ( int i = 0; i < q.mloc(); i++ )
+        p[i] *= fac;
+    }
+  }
+
+  for ( int n = 0; n < nstep; n++ )
+  {
+    tmap_["expowf_ef"].start();
+    ef_.energy(wf_, true, *workwf_, false, fion, false, sigma);
+    tmap_["expowf_ef"].stop();
+
+    tmap_["expowf_axpy"].start();
+    for ( int isd = 0; isd < nsd; isd++ )
+    {
+      ComplexMatrix& q = sdq[isd]->c();
+      ComplexMatrix& p = sdp[isd]->c();
+      ComplexMatrix& w = sdw[isd]->c();
+      const int mloc = q.mloc();
+      const int nloc = q.nloc();
+      double* an = &alpha[isd][n*nloc];
+      double* bn = &beta[isd][n*nloc];
+      double* bn1 = &beta[isd][(n+1)*nloc];
+      column_dots(q,w,an);
+      for ( int j = 0; j < nloc; j++ )
+      {
+        complex<double>* pw = w.valptr(j*mloc);
+        const complex<double>* pq = q.cvalptr(j*mloc);
+        const complex<double>* pp = p.cvalptr(j*mloc);
+        for ( int i = 0; i < mloc; i++ )
+          pw[i] -= an[j] * pq[i] + bn[j] * pp[i];
+      }
+      column_dots(w,w,bn1);
+      // q_(n+1) = w / beta_(n+1), the previous vector moves to p
+      p = q;
+      for ( int j = 0; j < nloc; j++ )
+      {
+        bn1[j] = sqrt(bn1[j]);
+        const double fac = bn1[j] > 0.0 ? 1.0 / bn1[j] : 0.0;
+        complex<double>* pq = q.valptr(j*mloc);
+        const complex<double>* pw = w.cvalptr(j*mloc);
+        for ( int i = 0; i < mloc; i++ )
+          pq[i] = fac * pw[i];
+      }
+    }
+    tmap_["expowf_axpy"].stop();
+  }
+
+  // eigenvalues of the tridiagonal matrices
+  emin = 1.0e30;
+  emax = -1.0e30;
+  char jobz = 'N';
+  char uplo = 'L';
+  int m = nstep;
+  valarray<double> t(m*m), w(m), work(3*m);
+  int lwork = 3*m;
+  int info;
+  for ( int isd = 0; isd < nsd; isd++ )
+  {
+    const int nloc = sdq[isd]->c().nloc();
+    for ( int j = 0; j < nloc; j++ )
+    {
+      t = 0.0;
+      for ( int k = 0; k < m; k++ )
+      {
+        t[k+m*k] = alpha[isd][k*nloc+j];
+        if ( k > 0 )
+          t[k+m*(k-1)] = beta[isd][k*nloc+j];
+      }
+      dsyev(&jobz,&uplo,&m,&t[0],&m,&w[0],&work[0],&lwork,&info);
+      assert(info == 0);
+      emin = min(emin,w[0]);
+      emax = max(emax,w[m-1]+beta[isd][m*nloc+j]);
+    }
+  }
+  wf_.context().dmin(1,1,&emin,1);
+  wf_.context().dmax(1,1,&emax,1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ChebyshevWavefunctionStepper::spectral_bounds(void)
+{
+  // The lower bound is estimated from the propagated states, the upper
+  // bound from random states that contain high-energy components.
+  // The states are kept in hamil_wf, which is set by the expansion that
+  // follows.
+  const int nstep = 8;
+
+  tmap_["expowf_copy"].start();
+  *s_.hamil_wf = wf_;
+  tmap_["expowf_copy"].stop();
+
+  double emin1, emax1, emin2, emax2;
+  lanczos(nstep,emin1,emax1);
+
+  wf_.clear();
+  wf_.randomize(1.0,false);
+  lanczos(nstep,emin2,emax2);
+
+  tmap_["expowf_copy"].start();
+  wf_ = *s_.hamil_wf;
+  tmap_["expowf_copy"].stop();
+
+  // Ritz values lie inside the spectrum: widen the interval. If it is
+  // still too narrow, preupdate() widens it further.
+  emin_ = min(emin1,emin2);
+  emax_ = max(emax1,emax2);
+  const double margin = 0.05 * ( emax_ - emin_ );
+  emin_ -= margin;
+  emax_ += margin;
+
+  if ( wf_.context().oncoutpe() )
+    cout << "<!-- ChebyshevWavefunctionStepper: spectral bounds " << emin_
+         << " " << emax_ << " -->" << endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ChebyshevWavefunctionStepper::chebyshev(double dt)
+{
+  // exp(-i dt H) = exp(-i dt c) sum_k a_k T_k(Hs), Hs = (H - c)/r
+  // with a_0 = J_0(r dt), a_k = 2 (-i)^k J_k(r dt) and the recurrence
+  // phi_(k+1) = 2 Hs phi_k - phi_(k-1).
+  // phi_k is in wf_, phi_(k-1) in newwf_, H phi_k in workwf_ and the
+  // sum in hamil_wf.
+
+  // dummy variables to call ef_.energy
+  std::vector<std::vector<double> > fion;
+  std::valarray<double> sigma;
+
+  const double c = 0.5 * ( emax_ + emin_ );
+  const double r = 0.5 * ( emax_ - emin_ );
+  const double x = r * dt;
+
+  // the Bessel functions decay faster than exponentially for k > x
+  int nterms = 1;
+  while ( nterms <= x || fabs(jn(nterms,x)) >= tol_ )
+    nterms++;
+
+  vector<SlaterDet*> sdq, sdp, sdw, sde;
+  local_sds(wf_,sdq);
+  local_sds(newwf_,sdp);
+  local_sds(*workwf_,sdw);
+  local_sds(*s_.hamil_wf,sde);
+  const int nsd = sdq.size();
+
+  tmap_["expowf_copy"].start();
+  for ( int isd = 0; isd < nsd; isd++ )
+  {
+    sde[isd]->c() = sdq[isd]->c();
+    sde[isd]->c() *= jn(0,x);
+  }
+  tmap_["expowf_copy"].stop();
+
+  complex<double> mi_k = 1.0;
+  for ( int k = 1; k < nterms; k++ )
+  {
+    tmap_["expowf_ef"].start();
+    ef_.energy(wf_, true, *workwf_, false, fion, false, sigma);
+    tmap_["expowf_ef"].stop();
+
+    mi_k *= complex<double>(0.0,-1.0);
+    const complex<double> ak = 2.0 * mi_k * jn(k,x);
+    tmap_["expowf_axpy"].start();
+    for ( int isd = 0; isd < nsd; isd++ )
+    {
+      ComplexMatrix& q = sdq[isd]->c();
+      ComplexMatrix& p = sdp[isd]->c();
+      ComplexMatrix& w = sdw[isd]->c();
+      w.axpy(-c,q);
+      if ( k == 1 )
+      {
+        w *= 1.0 / r;
+      }
+      else
+      {
+        w *= 2.0 / r;
+        w.axpy(-1.0,p);
+      }
+      sde[isd]->c().axpy(ak,w);
+      p = q;
+      q = w;
+    }
+    tmap_["expowf_axpy"].stop();
+  }
+
+  tmap_["expowf_copy"].start();
+  const complex<double> phase = exp(complex<double>(0.0,-c*dt));
+  for ( int isd = 0; isd < nsd; isd++ )
+  {
+    sdq[isd]->c() = sde[isd]->c();
+    sdq[isd]->c() *= phase;
+  }
+  for ( int ispin = 0; ispin < wf_.nspin(); ispin++)
+    for ( int ikp = 0; ikp < wf_.nkp(); ikp++ )
+      s_.hamil_wf->sd(ispin, ikp)->c() = wf_.sd(ispin, ikp)->c();
+  tmap_["expowf_copy"].stop();
+
+  if ( wf_.context().oncoutpe() )
+    cout << "<!-- ChebyshevWavefunctionStepper: " << nterms
+         << " terms -->" << endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ChebyshevWavefunctionStepper::preupdate()
+{
+  // no error estimate for the expansion
+  error_ = -1.0;
+
+  // change of the self-consistent potential since the previous step
+  SelfConsistentPotential potential = ef_.get_self_consistent_potential();
+  double dv = dvmax_;
+  if ( have_potential_ )
+  {
+    dv = potential.max_difference(previous_potential_);
+    wf_.context().dmax(1,1,&dv,1);
+  }
+  previous_potential_ = potential;
+  have_potential_ = true;
+
+  // the applied fields and the ionic positions change H without
+  // changing the self-consistent potential
+  const bool external_change = ef_.vp != 0 || ef_.el_enth() != 0 ||
+    s_.ctrl.compute_sine_field || s_.ctrl.compute_gaussian_field ||
+    ions_move_;
+
+  chebyshev_step_ = ( dv < dvmax_ && !external_change );
+  if ( chebyshev_step_ )
+  {
+    // the Hamiltonian is considered fixed over the step:
+    // propagate psi(t) to psi(t + dt) in one expansion
+    if ( !have_bounds_ )
+    {
+      spectral_bounds();
+      have_bounds_ = true;
+    }
+    if ( startwf_ == 0 )
+      startwf_ = new Wavefunction(wf_);
+    tmap_["expowf_copy"].start();
+    *startwf_ = wf_;
+    tmap_["expowf_copy"].stop();
+
+    // the expansion is unitary up to tol_ for a spectrum inside
+    // [emin_,emax_]; components outside the interval grow
+    const double normtol = 100.0 * tol_;
+    const int max_redo = 4;
+    for ( int iredo = 0; ; iredo++ )
+    {
+      chebyshev(tddt_);
+      const double dn = norm_change(*startwf_);
+      if ( dn < normtol )
+        break;
+      if ( iredo == max_redo )
+      {
+        if ( wf_.context().oncoutpe() )
+          cout << "<WARNING> ChebyshevWavefunctionStepper: norm change "
+               << dn << " after " << max_redo << " wider intervals "
+               << "</WARNING>" << endl;
+        break;
+      }
+      const double margin = 0.5 * ( emax_ - emin_ );
+      emin_ -= margin;
+      emax_ += margin;
+      if ( wf_.context().oncoutpe() )
+        cout << "<!-- ChebyshevWavefunctionStepper: norm change " << dn
+             << ", redo with spectral bounds " << emin_ << " " << emax_
+             << " -->" << endl;
+      tmap_["expowf_copy"].start();
+      wf_ = *startwf_;
+      tmap_["expowf_copy"].stop();
+    }
+  }
+  else
+  {
+    // the Hamiltonian changes: ETRS step, and new bounds when the
+    // expansion is used again
+    if ( wf_.context().oncoutpe() && !external_change )
+      cout << "<!-- ChebyshevWavefunctionStepper: potential change " << dv
+           << ", ETRS step -->" << endl;
+    have_bounds_ = false;
+    ExponentialWavefunctionStepper::preupdate();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ChebyshevWavefunctionStepper::update(Wavefunction& dwf)
+{
+  if ( !chebyshev_step_ )
+    ExponentialWavefunctionStepper::update(dwf);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ChebyshevWavefunctionStepper::write_state(std::ostream& os) const
+{
+  ExponentialWavefunctionStepper::write_state(os);
+  const int flags = ( have_potential_ ? 1 : 0 ) + ( have_bounds_ ? 2 : 0 );
+  TDState::put(os,flags);
+  TDState::put(os,emin_);
+  TDState::put(os,emax_);
+  if ( have_potential_ )
+    previous_potential_.write(os);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ChebyshevWavefunctionStepper::read_state(std::istream& is)
+{
+  ExponentialWavefunctionStepper::read_state(is);
+  int flags;
+  TDState::get(is,flags);
+  have_potential_ = ( flags & 1 );
+  have_bounds_ = ( flags & 2 );
+  TDState::get(is,emin_);
+  TDState::get(is,emax_);
+  if ( have_potential_ )
+    previous_potential_.read(is);
+}
@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// ChebyshevWavefunctionStepper.h
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#ifndef CHEBYSHEVWAVEFUNCTIONSTEPPER_H
+#define CHEBYSHEVWAVEFUNCTIONSTEPPER_H
+
+#include "ExponentialWavefunctionStepper.h"
+#include "SelfConsistentPotential.h"
+using namespace std;
+
+// Propagation with a Chebyshev expansion of exp(-i dt H(t)) over a full
+// time step while the self-consistent potential is nearly constant.
+// Steps in which the potential changed by more than dvmax since the
+// previous step are done with ETRS, as are all steps with a vector
+// potential, an electric field or moving ions, which change H in ways
+// the potential difference does not measure.
+// The norm of the states is checked after each expansion: states that
+// grew show that the spectral interval was too narrow, and the step is
+// redone from psi(t), kept in startwf_, with a wider interval.
+class ChebyshevWavefunctionStepper : public ExponentialWavefunctionStepper
+{
+  private:
+
+  double tol_;
+  double dvmax_;
+  bool have_potential_;
+  bool have_bounds_;
+  bool chebyshev_step_;
+  bool ions_move_;
+  double emin_, emax_;
+  SelfConsistentPotential previous_potential_;
+  Wavefunction* startwf_;
+
+  void lanczos(int nstep, double& emin, double& emax);
+  void spectral_bounds(void);
+  void chebyshev(double dt);
+  double norm_change(const Wavefunction& wf0) const;
+  int nwf_allocated(void) const;
+
+  public:
+
+  void preupdate();
+  void update(Wavefunction& dwf);
+  void write_state(std::ostream& os) const;
+  void read_state(std::istream& is);
+
+  ChebyshevWavefunctionStepper(Wavefunction& wf, double tddt, TimerMap& tmap, EnergyFunctional & ef, Sample & s, double tol, double dvmax, bool ions_move, Wavefunction* workwf = 0);
+  ~ChebyshevWavefunctionStepper();
+};
+#endif
+
+// Local Variables:
+// mode: c++
+// coding: utf-8
+// End:
@@ -0,0 +1,323 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// CheckpointCompressor.cc
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#include "CheckpointCompressor.h"
+#include "Timer.h"
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <iostream>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+using namespace std;
+
+namespace {
+const char block_magic[4] = { 'Q', 'B', 'Z', '1' };
+enum { method_lossless = 1, method_lossy = 2 };
+enum { coder_raw = 0, coder_rle = 1, coder_zlib = 2 };
+
+template <class T> void put(string& s, const T& v)
+{ s.append((const char*) &v, sizeof(T)); }
+template <class T> bool get(const string& s, size_t& pos, T& v)
+{
+  if ( pos + sizeof(T) > s.size() ) return false;
+  memcpy(&v, s.data()+pos, sizeof(T));
+  pos += sizeof(T);
+  return true;
+}
+
+// PackBits: a control byte c < 128 is followed by c+1 literal bytes,
+// c >= 128 by one byte repeated c-126 times
+void rle_encode(const string& in, string& out)
+{
+  const size_t n = in.size();
+  size_t i = 0;
+  while ( i < n )
+  {
+    size_t run = 1;
+    while ( i + run < n && run < 129 && in[i+run] == in[i] ) run++;
+    if ( run >= 2 )
+    {
+      out.push_back((char)(run + 126));
+      out.push_back(in[i]);
+      i += run;
+    }
+    else
+    {
+      size_t lit = 1;
+      while ( i + lit < n && lit < 128 &&
+              !( i + lit + 1 < n && in[i+lit] == in[i+lit+1] ) ) lit++;
+      out.push_back((char)(lit - 1));
+      out.append(in, i, lit);
+      i += lit;
+    }
+  }
+}
+
+bool rle_decode(const string& in, size_t pos, string& out, size_t size)
+{
+  out.clear();
+  out.reserve(size);
+  while ( pos < in.size() )
+  {
+    const unsigned char c = in[pos++];
+    if ( c < 128 )
+    {
+      if ( pos + c + 1 > in.size() ) return false;
+      out.append(in, pos, c + 1);
+      pos += c + 1;
+    }
+    else
+    {
+      if ( pos >= in.size() ) return false;
+      out.append(c - 126, in[pos++]);
+    }
+  }
+  return out.size() == size;
+}
+
+// entropy code the bytes in, appending the coder id and the data to out
+void encode(const string& in, string& out)
+{
+  string coded;
+  unsigned char coder = coder_rle;
+#ifdef HAVE_ZLIB
+  uLongf len = compressBound(in.size());
+  coded.resize(len);
+  if ( compress2((Bytef*) &coded[0], &len, (const Bytef*) in.data(),
+                 in.size(), 1) == Z_OK )
+  {
+    coded.resize(len);
+    coder = coder_zlib;
+  }
+  else
+    coded.clear();
+#endif
+  if ( coder == coder_rle )
+    rle_encode(in, coded);
+  if ( coded.size() >= in.size() )
+  {
+    coder = coder_raw;
+    coded = in;
+  }
+  put(out, coder);
+  put(out, (int64_t) in.size());
+  out.append(coded);
+}
+
+bool decode(const string& in, size_t pos, string& out)
+{
+  unsigned char coder;
+  int64_t size;
+  if ( !get(in, pos, coder) || !get(in, pos, size) ) return false;
+  if ( coder == coder_raw )
+  {
+    out.assign(in, pos, string::npos);
+    return out.size() == (size_t) size;
+  }
+  if ( coder == coder_rle )
+    return rle_decode(in, pos, out, size);
+  if ( coder == coder_zlib )
+  {
+#ifdef HAVE_ZLIB
+    out.resize(size);
+    uLongf len = size;
+    if ( uncompress((Bytef*) &out[0], &len, (const Bytef*) in.data()+pos,
+                    in.size()-pos) != Z_OK )
+      return false;
+    return len == (uLongf) size;
+#else
+    cout << "<ERROR> CheckpointCompressor: block compressed with zlib, "
+         << "qball was built without zlib </ERROR>" << endl;
+    return false;
+#endif
+  }
+  return false;
+}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void CheckpointCompressor::compress(const double* x, long long int n, int ncol,
+  const int* bin, int nbins, string& out)
+{
+  Timer tm;
+  tm.start();
+  const bool lossy = ( mode_ == "lossy" );
+  if ( !lossy || bin == 0 )
+    nbins = 1;
+  const long long int m = ( ncol > 0 ) ? n / ncol : 0;
+
+  out.clear();
+  out.append(block_magic, 4);
+  put(out, (unsigned char)( lossy ? method_lossy : method_lossless ));
+  put(out, (int64_t) n);
+  put(out, (int32_t) ncol);
+  put(out, (int32_t) nbins);
+
+  string bytes;
+  if ( lossy )
+  {
+    // quantization step of each column and bin
+    vector<double> step(ncol*nbins, 0.0);
+    vector<long long int> count(nbins);
+    for ( int j = 0; j < ncol; j++ )
+    {
+      double* st = &step[j*nbins];
+      fill(count.begin(), count.end(), 0);
+      for ( long long int i = 0; i < m; i++ )
+      {
+        const int b = ( nbins > 1 ) ? bin[i] : 0;
+        st[b] += x[j*m+i] * x[j*m+i];
+        count[b]++;
+      }
+      for ( int b = 0; b < nbins; b++ )
+        st[b] = ( count[b] > 0 ) ? tol_ * sqrt(st[b] / count[b]) : 0.0;
+    }
+    put(out, tol_);
+    out.append((const char*) &step[0], step.size()*sizeof(double));
+
+    // zigzag variable-length integers
+    bytes.reserve(2*n);
+    for ( int j = 0; j < ncol; j++ )
+      for ( long long int i = 0; i < m; i++ )
+      {
+        const double st = step[j*nbins + ( ( nbins > 1 ) ? bin[i] : 0 )];
+        const int64_t q = ( st > 0.0 ) ? llround(x[j*m+i] / st) : 0;
+        uint64_t z = ( (uint64_t) q << 1 ) ^ (uint64_t)( q >> 63 );
+        while ( z >= 0x80 )
+        {
+          bytes.push_back((char)( z | 0x80 ));
+          z >>= 7;
+        }
+        bytes.push_back((char) z);
+      }
+  }
+  else
+  {
+    // byte shuffle: byte k of all values, then byte k+1, ...
+    bytes.resize(n*sizeof(double));
+    const unsigned char* p = (const unsigned char*) x;
+    for ( int k = 0; k < sizeof(double); k++ )
+    {
+      char* plane = &bytes[k*n];
+      for ( long long int i = 0; i < n; i++ )
+        plane[i] = p[i*sizeof(double)+k];
+    }
+  }
+  encode(bytes, out);
+
+  tm.stop();
+  time_ += tm.real();
+  raw_bytes_ += n*sizeof(double);
+  packed_bytes_ += out.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool CheckpointCompressor::decompress(const string& in, double* x,
+  long long int n, const int* bin)
+{
+  Timer tm;
+  tm.start();
+  size_t pos = 4;
+  if ( in.size() < 4 || memcmp(in.data(), block_magic, 4) != 0 )
+    return false;
+  unsigned char method;
+  int64_t nblock;
+  int32_t ncol, nbins;
+  if ( !get(in, pos, method) || !get(in, pos, nblock) ||
+       !get(in, pos, ncol) || !get(in, pos, nbins) )
+    return false;
+  if ( nblock != n )
+    return false;
+  const long long int m = ( ncol > 0 ) ? n / ncol : 0;
+
+  vector<double> step;
+  if ( method == method_lossy )
+  {
+    double tol;
+    if ( !get(in, pos, tol) ) return false;
+    decoded_tol_ = max(decoded_tol_, tol);
+    step.resize(ncol*nbins);
+    if ( pos + step.size()*sizeof(double) > in.size() ) return false;
+    if ( step.size() > 0 )
+      memcpy(&step[0], in.data()+pos, step.size()*sizeof(double));
+    pos += step.size()*sizeof(double);
+  }
+  else if ( method != method_lossless )
+    return false;
+
+  string bytes;
+  if ( !decode(in, pos, bytes) )
+    return false;
+
+  if ( method == method_lossy )
+  {
+    // the bins must be the ones used to compress the block
+    if ( nbins > 1 && bin == 0 )
+      return false;
+    size_t ib = 0;
+    for ( int j = 0; j < ncol; j++ )
+      for ( long long int i = 0; i < m; i++ )
+      {
+        uint64_t z = 0;
+        int shift = 0;
+        unsigned char c;
+        do
+        {
+          if ( ib >= bytes.size() ) return false;
+          c = bytes[ib++];
+          z |= (uint64_t)( c & 0x7f ) << shift;
+          shift += 7;
+        } while ( c & 0x80 );
+        const int64_t q = (int64_t)( z >> 1 ) ^ -(int64_t)( z & 1 );
+        x[j*m+i] = q * step[j*nbins + ( ( nbins > 1 ) ? bin[i] : 0 )];
+      }
+  }
+  else
+  {
+    if ( bytes.size() != n*sizeof(double) ) return false;
+    unsigned char* p = (unsigned char*) x;
+    for ( int k = 0; k < sizeof(double); k++ )
+    {
+      const char* plane = &bytes[k*n];
+      for ( long long int i = 0; i < n; i++ )
+        p[i*sizeof(double)+k] = plane[i];
+    }
+  }
+
+  tm.stop();
+  time_ += tm.real();
+  raw_bytes_ += n*sizeof(double);
+  packed_bytes_ += in.size();
+  return true;
+}
@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// CheckpointCompressor.h
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#ifndef CHECKPOINTCOMPRESSOR_H
+#define CHECKPOINTCOMPRESSOR_H
+
+#include <string>
+using namespace std;
+
+// Compression of the blocks of doubles written in checkpoints
+// (save_compression).
+//   lossless: the bytes of the doubles are shuffled into eight planes
+//             (sign/exponent bytes together) and entropy coded with zlib,
+//             or run-length coded when qball is built without zlib.
+//   lossy:    each value is quantized with a step tol*rms, where rms is the
+//             root mean square of the values of the same column and bin
+//             (e.g. a state and a shell of |k+G|). The error of each value
+//             is at most tol/2 times the rms of its bin. The integers are
+//             then coded as in the lossless mode.
+// Each block is self-describing, so a block is decoded without knowing
+// the mode it was written with. The compressor keeps statistics of the
+// bytes and time spent for reporting.
+class CheckpointCompressor
+{
+  private:
+
+  string mode_;
+  double tol_;
+  double raw_bytes_, packed_bytes_, time_;
+  double decoded_tol_;
+
+  public:
+
+  const string& mode(void) const { return mode_; }
+  double tol(void) const { return tol_; }
+  bool active(void) const { return mode_ != "OFF"; }
+
+  // compress n doubles stored as ncol columns of n/ncol values; bin[i]
+  // (optional, size n/ncol) is the bin of row i in [0,nbins) for lossy
+  // compression
+  void compress(const double* x, long long int n, int ncol, const int* bin,
+                int nbins, string& out);
+  // decode a block into x, which holds n doubles; bin must be the one
+  // given to compress. Returns false if the block is corrupt or does not
+  // hold n values
+  bool decompress(const string& in, double* x, long long int n,
+                  const int* bin = 0);
+
+  double raw_bytes(void) const { return raw_bytes_; }
+  double packed_bytes(void) const { return packed_bytes_; }
+  double time(void) const { return time_; }
+  // largest tolerance of the lossy blocks decoded, 0 if all were lossless
+  double decoded_tol(void) const { return decoded_tol_; }
+  void reset_stats(void) { raw_bytes_ = packed_bytes_ = time_ = 0.0; }
+
+  CheckpointCompressor(const string& mode, double tol) : mode_(mode),
+    tol_(tol), raw_bytes_(0.0), packed_bytes_(0.0), time_(0.0),
+    decoded_tol_(0.0) {}
+};
+#endif
+
+// Local Variables:
+// mode: c++
+// End:
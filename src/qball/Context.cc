@@ -32,6 +32,9 @@
 #include <cmath>
 #include <cassert>
 #include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
 using namespace std;
 
 #ifdef HAVE_SCALAPACK
@@ -986,6 +989,36 @@ void Context::string_recv(string& s, int rsrc, int csrc) const
 void Context::string_bcast(string& s, int isrc) const
 { (*pimpl_)->string_bcast(s,isrc); }
 
+////////////////////////////////////////////////////////////////////////////////
+bool Context::file_bcast(const string& filename, string& contents) const
+{
+  long long len = -1;
+  if ( oncoutpe() )
+  {
+    ifstream is(filename.c_str(),ios::in|ios::binary);
+    if ( is.is_open() )
+    {
+      ostringstream oss;
+      oss << is.rdbuf();
+      contents = oss.str();
+      len = contents.size();
+    }
+  }
+#if USE_MPI
+  MPI_Bcast(&len,1,MPI_LONG_LONG,coutpe(),comm());
+  if ( len < 0 ) return false;
+  if ( !oncoutpe() ) contents.resize(len);
+  // MPI counts are int, send large files in pieces
+  const long long chunk = 1 << 30;
+  for ( long long off = 0; off < len; off += chunk )
+  {
+    const int n = (int) min(chunk,len-off);
+    MPI_Bcast(&contents[off],n,MPI_CHAR,coutpe(),comm());
+  }
+#endif
+  return len >= 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 bool Context::operator==(const Context& ctxt) const
 { return ( (*pimpl_)->ictxt() == ctxt.ictxt() ); }
@@ -156,6 +156,10 @@ class Context
   void string_send(string& s, int rdest, int cdest) const;
   void string_recv(string& s, int rsrc, int csrc) const;
   void string_bcast(string& s, int isrc) const;
+  // read a whole file on task coutpe and broadcast its contents, so that
+  // a file is opened once however many tasks need it. Returns false on
+  // all tasks if the file cannot be opened.
+  bool file_bcast(const string& filename, string& contents) const;
  
   bool operator==(const Context& ctxt) const;
  
@@ -90,6 +90,13 @@ struct Control
 
   double dt;
   double tddt; // AS: time step for the wave function propagation
+  double tddt_tol; // error tolerance of the adaptive time step (0: fixed step)
+  double tddt_min; // smallest adaptive time step
+  double tddt_max; // largest adaptive time step
+  double krylov_tol; // error tolerance of the Krylov exponential
+  int krylov_maxdim; // maximum dimension of the Krylov space
+  double chebyshev_tol; // truncation threshold of the Chebyshev expansion
+  double chebyshev_dvmax; // largest potential change of a Chebyshev step
   int na_overlap_min; // AS: minimum band index for the calculation of non-adiabatic overlaps
   int na_overlap_max; // AS: maximum band index for the calculation of non-adiabatic overlaps
   int iprint;
@@ -126,8 +133,17 @@ struct Control
 
   int savefreq;     // if > 0, checkpoint within iteration loop
   int savedenfreq;  // if > 0, checkpoint within iteration loop
+  bool save_async;  // write savefreq/savedenfreq files in the background
+  string save_compression;  // OFF, lossless or lossy wavefunction checkpoints
+  double save_compression_tol;  // relative error of lossy checkpoints
   int caldipfreq;  // if > 0, checkpoint within iteration loop
+  int energy_output_freq; // TD energies are only computed every energy_output_freq steps
   string savedenfilebase; // optional subdirectory and filename base for density snapshots
+  string saveden_format;  // cube, binary or float files for savedenfreq
+  int saveden_stride;     // downsampling of binary savedenfreq files
+  string observable_log;  // binary log of the observables of each step, or OFF
+  bool observable_log_quiet; // logged observables are not printed
+  string species_cache;   // directory of initialized species, or OFF
   int savewffreq;  // if > 0, checkpoint within iteration loop
   string savewffilebase; // optional subdirectory and filename base for density snapshots
   int savewfstate;  // if >= 0, only save this state
@@ -170,6 +186,7 @@ struct Control
   int blHF[3];
   double btHF;
   double MLWFDist;
+  double MLWFSubbox; // padding of sub-box Poisson solves, 0: full grid
   double hf;
   double alpha_PBE0;
   double alpha_RSH;
@@ -30,13 +30,14 @@
 #include "Species.h"
 #include <iomanip>
 #include "Base64Transcoder.h"
+#include "GridFile.h"
 
 CurrentDensity::CurrentDensity( Sample& s, const Wavefunction & wf):
   ChargeDensity(s), wf_(wf){
   
 }
 
-void CurrentDensity::update_current(EnergyFunctional & energy_functional, const Wavefunction & dwf){
+void CurrentDensity::update_current(EnergyFunctional & energy_functional, const Wavefunction & dwf, bool print){
 
   Wavefunction rwf(wf_);
   Wavefunction rdwf(wf_);
@@ -100,7 +101,7 @@ void CurrentDensity::update_current(EnergyFunctional & energy_functional, const
   // TODO: Reduce total current over spin
   assert(wf_.nspin() == 1);
 	 
-  if ( wf_.context().onpe0() ){
+  if ( print && wf_.context().onpe0() ){
     std::cout << "  total_electronic_current:\t" << std::fixed << std::setw( 20 ) << std::setprecision( 12 ) << total_current[0] << '\t' << total_current[1] << '\t' << total_current[2] << std::endl;
   }
 
@@ -264,3 +265,20 @@ void CurrentDensity::plot_vtk( Sample * s, const std::string & filename){
   }
 
 }
+
+void CurrentDensity::write_grid( Sample * s, const std::string & filename, int wordsize, int stride){
+
+  GridFileHeader h;
+  h.label = "current density";
+  h.wordsize = wordsize;
+  h.stride = stride;
+  h.mditer = s->ctrl.mditer;
+  h.set_atoms(s->atoms);
+
+  std::vector<const double*> fields(3);
+  for(int idir = 0; idir < 3; idir++) fields[idir] = current[idir][0].data();
+
+  const UnitCell & cell = s->atoms.cell();
+  GridFile::write(filename, h, fields, *vft(), *s->wf.spincontext(0), s->ctxt_, cell.a(0), cell.a(1), cell.a(2));
+
+}
@@ -41,10 +41,13 @@ class CurrentDensity : private ChargeDensity
   ~CurrentDensity (){
   }
 
-  void update_current(EnergyFunctional & energy, const Wavefunction & dwf);
+  void update_current(EnergyFunctional & energy, const Wavefunction & dwf, bool print = true);
 
   void plot( Sample *, const std::string &);
   void plot_vtk( Sample *, const std::string &);
+  // parallel binary output of the three components (GridFile), wordsize
+  // 4 or 8, every stride-th point
+  void write_grid( Sample *, const std::string &, int wordsize, int stride);
 
 };
 
@@ -36,8 +36,12 @@
 #include "SOTDWavefunctionStepper.h"
 #include "SORKTDWavefunctionStepper.h"
 #include "FORKTDWavefunctionStepper.h"
+#include "LSRK4WavefunctionStepper.h"
 #include "TDEULERWavefunctionStepper.h"
 #include "ExponentialWavefunctionStepper.h"
+#include "KrylovWavefunctionStepper.h"
+#include "ChebyshevWavefunctionStepper.h"
+#include "CFM4WavefunctionStepper.h"
 #include "SDIonicStepper.h"
 #include "SDAIonicStepper.h"
 #include "CGIonicStepper.h"
@@ -50,6 +54,12 @@
 #include "SimpleConvergenceDetector.h"
 #include "Hugoniostat.h"
 #include "PrintMem.h"
+#include "AsyncFileWriter.h"
+#include "CheckpointCompressor.h"
+#include "GridFile.h"
+#include "ObservableLog.h"
+#include "TDState.h"
+#include "VectorPotential.h"
 #include "FourierTransform.h"
 #include "profile.h"
 #include <fstream>
@@ -77,17 +87,18 @@ EhrenSampleStepper::EhrenSampleStepper(Sample& s, int nitscf, int nite) :
    const string wf_dyn = s_.ctrl.wf_dyn;
    tddft_involved_ = s_.ctrl.tddft_involved;
 
-   Wavefunction* wf0 = new Wavefunction(dwf);
-   Wavefunction* wf1 = new Wavefunction(s.wf);
-   Wavefunction* wf2 = new Wavefunction(s.wf);
-   Wavefunction* wf3 = new Wavefunction(s.wf);
-   Wavefunction* wf4 = new Wavefunction(s.wf);
-   
-   wfdeque.push_back ( wf0 );
-   wfdeque.push_back ( wf1 );
-   wfdeque.push_back ( wf2 );
-   wfdeque.push_back ( wf3 );
-   wfdeque.push_back ( wf4 );
+   // registers of the multistep and Runge-Kutta propagators:
+   // SOTD cycles through five wave functions, the low-storage forms of
+   // FORKTD and SORKTD keep |psi(t)> and, for FORKTD, the sum of the stages
+   int nreg = 0;
+   if ( wf_dyn == "SOTD" )
+      nreg = 5;
+   else if ( wf_dyn == "FORKTD" )
+      nreg = 2;
+   else if ( wf_dyn == "SORKTD" )
+      nreg = 1;
+   for ( int i = 0; i < nreg; i++ )
+      wfdeque.push_back ( new Wavefunction(s.wf) );
 
 }
 ////////////////////////////////////////////////////////////////////////////////
@@ -201,10 +212,18 @@ void EhrenSampleStepper::step(int niter)
      wf_stepper = new SORKTDWavefunctionStepper(wf,s_.ctrl.tddt,tmap,&wfdeque);
   else if ( wf_dyn == "FORKTD" )
      wf_stepper = new FORKTDWavefunctionStepper(wf,s_.ctrl.tddt,tmap,&wfdeque);
+  else if ( wf_dyn == "LSRK4" )
+     wf_stepper = new LSRK4WavefunctionStepper(wf,s_.ctrl.tddt,tmap,ef_,s_);
   else if ( wf_dyn == "ETRS" )
-     wf_stepper = new ExponentialWavefunctionStepper(wf,s_.ctrl.tddt,tmap,ef_,s_,false);
+     wf_stepper = new ExponentialWavefunctionStepper(wf,s_.ctrl.tddt,tmap,ef_,s_,false,&dwf);
   else if ( wf_dyn == "AETRS" )
-     wf_stepper = new ExponentialWavefunctionStepper(wf,s_.ctrl.tddt,tmap,ef_,s_,true);
+     wf_stepper = new ExponentialWavefunctionStepper(wf,s_.ctrl.tddt,tmap,ef_,s_,true,&dwf);
+  else if ( wf_dyn == "KRYLOV" )
+     wf_stepper = new KrylovWavefunctionStepper(wf,s_.ctrl.tddt,tmap,ef_,s_,false,s_.ctrl.krylov_tol,s_.ctrl.krylov_maxdim,&dwf);
+  else if ( wf_dyn == "CHEBYSHEV" )
+     wf_stepper = new ChebyshevWavefunctionStepper(wf,s_.ctrl.tddt,tmap,ef_,s_,s_.ctrl.chebyshev_tol,s_.ctrl.chebyshev_dvmax,atoms_move || cell_moves,&dwf);
+  else if ( wf_dyn == "CFM4" )
+     wf_stepper = new CFM4WavefunctionStepper(wf,s_.ctrl.tddt,tmap,ef_,s_,&dwf);
   else
   {
      if ( oncoutpe )
@@ -288,31 +307,99 @@ void EhrenSampleStepper::step(int niter)
   { 
       tdnto=new TDNaturalOrbital(s_);
   }
+  // adaptive time step: tddt is the step taken in the current iteration,
+  // tddt_prev the one of the previous iteration and tdtime the time reached
+  // before the current step
+  const bool adapt_tddt = ( s_.ctrl.tddt_tol > 0.0 );
+  double tddt = s_.ctrl.tddt;
+  double tddt_prev = tddt;
+  double tdtime = 0.0;
+  const double tddt_min = ( s_.ctrl.tddt_min > 0.0 ) ? s_.ctrl.tddt_min : 0.1*s_.ctrl.tddt;
+  const double tddt_max = ( s_.ctrl.tddt_max > 0.0 ) ? s_.ctrl.tddt_max : 10.0*s_.ctrl.tddt;
+  if ( adapt_tddt )
+     wf_stepper->enable_error_estimate();
+  // a step whose error exceeds tddt_tol is redone from psi(t) with a
+  // smaller tddt. The start of the step is kept for this, which is only
+  // possible when ions and cell are fixed; otherwise steps are accepted
+  // and only the next tddt is reduced.
+  const bool redo_steps = ( adapt_tddt && !atoms_move && !cell_moves );
+  const int max_redo = 5;
+  Wavefunction* wf_start = 0;
+  Wavefunction* hamwf_start = 0;
+  if ( redo_steps )
+  {
+     wf_start = new Wavefunction(s_.wf);
+     hamwf_start = new Wavefunction(*s_.hamil_wf);
+  }
+
+  // continue the propagation from the history read with the checkpoint
+  int tdstep0 = 0;
+  if ( s_.tdstate != 0 )
+  {
+     if ( s_.tdstate->wf_dyn == wf_dyn )
+     {
+        tdstep0 = s_.tdstate->tdstep;
+        tdtime = s_.tdstate->tdtime;
+        if ( adapt_tddt && s_.tdstate->tddt > 0.0 )
+        {
+           tddt = s_.tdstate->tddt;
+           tddt_prev = s_.tdstate->tddt_prev;
+           wf_stepper->set_tddt(tddt);
+        }
+        istringstream is(s_.tdstate->local);
+        int has_vp;
+        TDState::get(is,has_vp);
+        if ( has_vp && ef_.vp )
+           ef_.vp->read_state(is);
+        else if ( has_vp )
+        {
+           // skip the vector potential record
+           D3vector tmp;
+           for ( int i = 0; i < 4; i++ )
+              TDState::get(is,tmp);
+        }
+        wf_stepper->read_state(is);
+        if ( oncoutpe )
+           cout << "<!-- EhrenSampleStepper: continuing from TD step "
+                << tdstep0 << " -->" << endl;
+     }
+     else if ( oncoutpe )
+        cout << "<WARNING> EhrenSampleStepper: TD restart record was written "
+             << "with wf_dyn " << s_.tdstate->wf_dyn << ", ignored </WARNING>"
+             << endl;
+     delete s_.tdstate;
+     s_.tdstate = 0;
+  }
+
+  // observables of each step go to the binary log (observable_log), which
+  // only exists on the output task; with quiet they are not printed
+  ObservableLog* const obslog = s_.obslog;
+  const bool log_quiet = ( obslog != 0 && s_.ctrl.observable_log_quiet );
+
   for ( int iter = 0; iter < niter; iter++ )
   {
 
+    // the applied fields are evaluated at the time reached by the
+    // propagation when tddt is adapted. Otherwise the sine field follows
+    // dt*iter and the gaussian pulse dt*mditer, as before
+    const double tsine = adapt_tddt ? tdtime : s_.ctrl.dt*iter;
+    const double tgauss = adapt_tddt ? tdtime : s_.ctrl.dt*s_.ctrl.mditer;
+
     if (s_.ctrl.compute_sine_field) //CS  
     {
-         if(s_.ctrl.efield_amp[0] > 0)
-         	s_.ctrl.e_field[0] = s_.ctrl.efield_amp[0]*sin(2*M_PI*s_.ctrl.dt*iter/s_.ctrl.sine_field); 
-         if(s_.ctrl.efield_amp[1] > 0)
-                s_.ctrl.e_field[1] = s_.ctrl.efield_amp[1]*sin(2*M_PI*s_.ctrl.dt*iter/s_.ctrl.sine_field);
-         if(s_.ctrl.efield_amp[2] > 0)
-                s_.ctrl.e_field[2] = s_.ctrl.efield_amp[2]*sin(2*M_PI*s_.ctrl.dt*iter/s_.ctrl.sine_field);
+         for ( int i = 0; i < 3; i++ )
+            if(s_.ctrl.efield_amp[i] > 0)
+               s_.ctrl.e_field[i] = s_.ctrl.efield_amp[i]*sin(2*M_PI*tsine/s_.ctrl.sine_field); 
          if ( s_.ctxt_.oncoutpe() )
          	cout << setprecision(10) << "<sine_field> " << s_.ctrl.e_field[0] << " " << s_.ctrl.e_field[1] << " " << s_.ctrl.e_field[2] << " </Sine_field>" << endl;
     }
 
     if (s_.ctrl.compute_gaussian_field) // field = amp * sin(w(t-t0)) * exp(-(t-t0)^2/(2*s^2))
     {
-         if(s_.ctrl.efield_amp[0] > 0)
-                s_.ctrl.e_field[0] = s_.ctrl.efield_amp[0]*sin(s_.ctrl.gauss_field[2]*(s_.ctrl.dt*s_.ctrl.mditer-s_.ctrl.gauss_field[0]))*exp(-((s_.ctrl.dt*s_.ctrl.mditer-s_.ctrl.gauss_field[0])*(s_.ctrl.dt*s_.ctrl.mditer-s_.ctrl.gauss_field[0])/(2*(s_.ctrl.gauss_field[1]*s_.ctrl.gauss_field[1]))));
-
-         if(s_.ctrl.efield_amp[1] > 0)
-                s_.ctrl.e_field[1] = s_.ctrl.efield_amp[1]*sin(s_.ctrl.gauss_field[2]*(s_.ctrl.dt*s_.ctrl.mditer-s_.ctrl.gauss_field[0]))*exp(-((s_.ctrl.dt*s_.ctrl.mditer-s_.ctrl.gauss_field[0])*(s_.ctrl.dt*s_.ctrl.mditer-s_.ctrl.gauss_field[0])/(2*(s_.ctrl.gauss_field[1]*s_.ctrl.gauss_field[1]))));
-
-         if(s_.ctrl.efield_amp[2] > 0)
-                s_.ctrl.e_field[2] = s_.ctrl.efield_amp[2]*sin(s_.ctrl.gauss_field[2]*(s_.ctrl.dt*s_.ctrl.mditer-s_.ctrl.gauss_field[0]))*exp(-((s_.ctrl.dt*s_.ctrl.mditer-s_.ctrl.gauss_field[0])*(s_.ctrl.dt*s_.ctrl.mditer-s_.ctrl.gauss_field[0])/(2*(s_.ctrl.gauss_field[1]*s_.ctrl.gauss_field[1]))));
+         const double t0 = tgauss - s_.ctrl.gauss_field[0];
+         for ( int i = 0; i < 3; i++ )
+            if(s_.ctrl.efield_amp[i] > 0)
+               s_.ctrl.e_field[i] = s_.ctrl.efield_amp[i]*sin(s_.ctrl.gauss_field[2]*t0)*exp(-(t0*t0/(2*(s_.ctrl.gauss_field[1]*s_.ctrl.gauss_field[1]))));
 
          if ( s_.ctxt_.oncoutpe() )
           	cout << setprecision(10) <<  " <gaussian_efield: " << s_.ctrl.e_field[0] << " " << s_.ctrl.e_field[1] << " " << s_.ctrl.e_field[2] << "</Gaussian_efield" << endl;
@@ -350,9 +437,20 @@ void EhrenSampleStepper::step(int niter)
 #ifdef USE_APC
     ApcStart(1);
 #endif
+
+    // energy terms that do not enter the propagation, and the forces and
+    // stress when ions and cell are fixed, are only evaluated on
+    // iterations where they are printed
+    const bool output_energy = ( iter%s_.ctrl.energy_output_freq == 0 ||
+                                 iter == niter-1 );
+    const bool energy_step = output_energy || atoms_move || cell_moves;
+    ef_.set_compute_energy(output_energy);
       
     if ( oncoutpe )
        cout << "<iteration count=\"" << iter+1 << "\">\n";
+    if ( obslog )
+       obslog->begin_step(s_.ctrl.mditer,
+                          adapt_tddt ? tdtime : s_.ctrl.tddt*(tdstep0 + iter));
 
     if ( ionic_stepper )
        atoms.sync();
@@ -391,20 +489,30 @@ void EhrenSampleStepper::step(int niter)
     }
         
     tmap["efn"].start();
-    double energy =
-        ef_.energy(s_.wf, false,dwf,compute_forces,fion,compute_stress,sigma_eks);
+    double energy = 0.0;
+    if ( energy_step )
+       energy = ef_.energy(s_.wf, false,dwf,compute_forces,fion,
+                           compute_stress && ( output_energy || cell_moves ),sigma_eks);
     tmap["efn"].stop();
 
+    // the current enters the dynamics only through the vector potential
     tmap["current"].start();
-    currd_.update_current(ef_, dwf);
+    if ( ef_.vp || output_energy )
+    {
+       currd_.update_current(ef_, dwf, !log_quiet);
+       if ( obslog )
+          obslog->add("total_current",currd_.total_current);
+    }
     tmap["current"].start();
 
-    if(ef_.vp && oncoutpe){
+    if(ef_.vp && oncoutpe && !log_quiet){
       std::cout << "<!-- vector_potential: " << ef_.vp->value() << " -->\n";
     }
+    if ( ef_.vp && obslog )
+       obslog->add("vector_potential",ef_.vp->value());
     
     // average forces over symmetric atoms
-    if ( compute_forces && s_.symmetries.nsym() > 0) {
+    if ( energy_step && compute_forces && s_.symmetries.nsym() > 0) {
        const int nsym_ = s_.symmetries.nsym();
        for ( int is = 0; is < atoms.atom_list.size(); is++ ) {
           for ( int ia = 0; ia < atoms.atom_list[is].size(); ia++ ) {
@@ -427,7 +535,7 @@ void EhrenSampleStepper::step(int niter)
        }       
     }
 
-    if (compute_forces && atoms.add_fion_ext()) {
+    if (energy_step && compute_forces && atoms.add_fion_ext()) {
        for ( int is = 0; is < atoms.atom_list.size(); is++ ) {
           for ( int ia = 0; ia < atoms.atom_list[is].size(); ia++ ) {
              D3vector ftmp = atoms.get_fion_ext(is,ia);
@@ -438,7 +546,21 @@ void EhrenSampleStepper::step(int niter)
        }
     }
 
-    if ( oncoutpe && iter%s_.ctrl.iprint == 0)
+    if ( obslog && output_energy )
+    {
+       obslog->add("ekin",ef_.ekin());
+       if ( use_confinement )
+          obslog->add("econf",ef_.econf());
+       obslog->add("eps",ef_.eps());
+       obslog->add("enl",ef_.enl());
+       obslog->add("ecoul",ef_.ecoul());
+       obslog->add("exc",ef_.exc());
+       obslog->add("esr",ef_.esr());
+       obslog->add("eself",ef_.eself());
+       obslog->add("ets",ef_.ets());
+       obslog->add("etotal",ef_.etotal());
+    }
+    if ( oncoutpe && output_energy && iter%s_.ctrl.iprint == 0 && !log_quiet)
     {
        cout.setf(ios::fixed,ios::floatfield);
        cout.setf(ios::right,ios::adjustfield);
@@ -479,10 +601,17 @@ void EhrenSampleStepper::step(int niter)
        temp_ion = ionic_stepper->temp();
     }
 
-    if(ef_.vp) ef_.vp->calculate_acceleration(s_.ctrl.tddt, currd_.total_current, cell);
+    string vp_start;
+    if ( redo_steps && ef_.vp )
+    {
+       ostringstream os;
+       ef_.vp->write_state(os);
+       vp_start = os.str();
+    }
+    if(ef_.vp) ef_.vp->calculate_acceleration(tddt_prev, tddt, currd_.total_current, cell);
     
     // print positions, velocities and forces at time t0
-    if ( oncoutpe && iter%s_.ctrl.iprint == 0)
+    if ( oncoutpe && energy_step && iter%s_.ctrl.iprint == 0)
     {
        cout << "<atomset>" << endl;
        cout << atoms.cell();
@@ -508,17 +637,43 @@ void EhrenSampleStepper::step(int niter)
           }
        }
        cout << "</atomset>" << endl;
-       cout << "  <econst> " << energy+ekin_ion << " </econst>\n";
+       if ( output_energy )
+          cout << "  <econst> " << energy+ekin_ion << " </econst>\n";
        cout << "  <ekin_ion> " << ekin_ion << " </ekin_ion>\n";
        cout << "  <temp_ion> " << temp_ion << " </temp_ion>\n";
     }
+    if ( obslog && energy_step && ionic_stepper )
+    {
+       if ( output_energy )
+          obslog->add("econst",energy+ekin_ion);
+       obslog->add("ekin_ion",ekin_ion);
+       obslog->add("temp_ion",temp_ion);
+    }
     tmap["ionic"].stop();
 
+    string stepper_start;
+    if ( redo_steps )
+    {
+       tmap["redo_copy"].start();
+       *wf_start = s_.wf;
+       *hamwf_start = *s_.hamil_wf;
+       ostringstream os;
+       wf_stepper->write_state(os);
+       stepper_start = os.str();
+       tmap["redo_copy"].stop();
+    }
+
     tmap["preupdate"].start();
     wf_stepper->preupdate();
     tmap["preupdate"].stop();
 
-    if(ef_.vp) ef_.vp->propagate(s_.ctrl.tddt*(iter + 1), s_.ctrl.tddt);
+    if(ef_.vp)
+    {
+       if ( adapt_tddt )
+          ef_.vp->propagate(tdtime + tddt, tddt);
+       else
+          ef_.vp->propagate(s_.ctrl.tddt*(tdstep0 + iter + 1), s_.ctrl.tddt);
+    }
     
     tmap["ionic"].start();
     if ( atoms_move )
@@ -531,6 +686,9 @@ void EhrenSampleStepper::step(int niter)
              s_.constraints.list_constraints(cout);
           }
        }
+       // the ionic step follows the electronic one: dt scales with tddt
+       if ( adapt_tddt )
+          ionic_stepper->set_dt(s_.ctrl.dt*tddt/s_.ctrl.tddt);
        // move atoms to new position: r0 <- r0 + v0*dt + dt2/m * fion
        ionic_stepper->compute_r(energy,fion);
        tmap["efn"].start();
@@ -549,7 +707,7 @@ void EhrenSampleStepper::step(int niter)
     }
     tmap["ionic"].stop();
 
-    if ( compute_stress )
+    if ( compute_stress && ( output_energy || cell_moves ) )
     {
        compute_sigma();
        print_stress();
@@ -629,19 +787,6 @@ void EhrenSampleStepper::step(int niter)
        if ( wf_dyn == "SOTD" ) wfv_is_new=false;
     }
              
-    if (wf_dyn=="FORKTD") {
-       // AS: initialize wfdeque[0] with 0, it will be k_1
-       *wfdeque[0]=dwf;
-       // AS: initialize wfdeque[1] with 0, it will be k_2
-       *wfdeque[1]=s_.wf;
-       // AS: initialize wfdeque[2] with 0, it will be k_3
-       *wfdeque[2]=s_.wf;
-       // AS: initialize wfdeque[3] with 0, it will be k_4
-       *wfdeque[3]=s_.wf;
-       // AS: initialize wfdeque[4] with wf, to keep a copy
-       *wfdeque[4]=s_.wf;
-    }
-             
     tmap["efn"].start();
     energy = ef_.energy(s_.wf, true,dwf,false,fion,false,sigma_eks);
     tmap["efn"].stop();
@@ -745,7 +890,8 @@ void EhrenSampleStepper::step(int niter)
 
           if ( onpe0 )
           {
-             cout << "<projections> " << endl;
+             if ( !log_quiet )
+                cout << "<projections> " << endl;
              for (int i=0; i<(wf.sd(ispin,ikp)->c()).n(); i++) {
                occ_current[i]=(wf.sd(ispin,ikp))->occ(i);
              }
@@ -759,7 +905,7 @@ void EhrenSampleStepper::step(int niter)
 
           tmap["sum_ortho"].stop();
 
-          if ( onpe0 )
+          if ( onpe0 && !log_quiet )
           {
             for (int i=0; i<(wf.sd(ispin,ikp)->c()).n(); i++)
             {
@@ -768,6 +914,12 @@ void EhrenSampleStepper::step(int niter)
             }
             cout << "projsum = " << ehp_count << endl;
           }
+          if ( onpe0 && obslog )
+          {
+            ostringstream oss;
+            oss << "projections s" << ispin << "k" << ikp;
+            obslog->add(oss.str(),occ_result);
+          }
           std::string filebase = s_.ctrl.saveprojfilebase;
           std::ostringstream oss;
           oss.width(8);  oss.fill('0');  oss << s_.ctrl.mditer;
@@ -896,26 +1048,18 @@ void EhrenSampleStepper::step(int niter)
     }
 
     if (wf_dyn=="SORKTD") {
-       wfdeque.push_back( s_.wfv );
-       // AS: initialize wfdeque[0] with 0, it will be k_1
-       (*wfdeque[0]).clear();
-
-       wfdeque.push_back( s_.wfv );
-       // AS: initialize wfdeque[1] with 0, it will be k_2
-       (*wfdeque[1]).clear();
-
-       wfdeque.push_back( s_.wfv );
-       // AS: initialize wfdeque[2] with wf, to keep a copy
-       (*wfdeque[2])=s_.wf;
+       // the stages k_i are formed in place in dwf, only |psi(t)> is kept
+       // AS: initialize wfdeque[0] with wf, to keep a copy
+       (*wfdeque[0])=s_.wf;
 
        for ( int ispin = 0; ispin < wf.nspin(); ispin++ )
        {
           for ( int ikp = 0; ikp < wf.nkp(); ikp++ )
           {
-             // AS: here we turn wfdeque[0] into k_1
-             ((*wfdeque[0]).sd(ispin,ikp)->c()).axpy(-1.0*s_.ctrl.tddt*(complex<double>(0,1)), dwf.sd(ispin,ikp)->c() );
+             // AS: here we turn dwf into k_1
+             (dwf.sd(ispin,ikp)->c()) *= -1.0*s_.ctrl.tddt*(complex<double>(0,1));
              // AS: here we turn wf into |psi(t)+0.5*k_1>
-             ((s_.wf).sd(ispin,ikp)->c()).axpy(0.5, (*wfdeque[0]).sd(ispin,ikp)->c() );
+             ((s_.wf).sd(ispin,ikp)->c()).axpy(0.5, dwf.sd(ispin,ikp)->c() );
           }
        }
                    
@@ -940,41 +1084,31 @@ void EhrenSampleStepper::step(int niter)
        ef_.update_hamiltonian();
        ef_.update_vhxc();
        // AS: apply the Hamiltonian to |psi(t)+0.5*k_1>
+       // k_2 is formed from dwf by the SORKTD stepper
        ef_.energy(s_.wf, true,dwf,false,fion,false,sigma_eks);
        tmap["efn"].stop();
-
-       for ( int ispin = 0; ispin < wf.nspin(); ispin++ )
-       {
-          for ( int ikp = 0; ikp < wf.nkp(); ikp++ )
-          {
-             // AS: here we turn wfdeque[1] into k_2
-             ((*wfdeque[1]).sd(ispin,ikp)->c()).axpy(-1.0*s_.ctrl.tddt*(complex<double>(0,1)), dwf.sd(ispin,ikp)->c() );
-          }
-       }
     }
 
     if (wf_dyn=="FORKTD") {
        tmap["forktd_tot"].start();
 
-       // AS: initialize wfdeque[0] with 0, it will be k_1
-       (*wfdeque[0]).clear();
-       // AS: initialize wfdeque[1] with 0, it will be k_2
-       (*wfdeque[1]).clear();
-       // AS: initialize wfdeque[2] with 0, it will be k_3
-       (*wfdeque[2]).clear();
-       // AS: initialize wfdeque[3] with 0, it will be k_4
-       (*wfdeque[3]).clear();
-       // AS: initialize wfdeque[4] with wf, to keep a copy
-       (*wfdeque[4])=s_.wf;
+       // Low-storage form: the stages k_i are formed in place in dwf and
+       // added to |psi(t+dt)> as soon as they are known, in the same order
+       // as the classical sum
+       // AS: initialize wfdeque[0] with wf, to keep a copy
+       (*wfdeque[0])=s_.wf;
+       // wfdeque[1] accumulates |psi(t)> + 1/6 * k_1 + 1/3 * k_2 + ...
+       (*wfdeque[1])=s_.wf;
 
        for ( int ispin = 0; ispin < wf.nspin(); ispin++ )
        {
           for ( int ikp = 0; ikp < wf.nkp(); ikp++ )
           {
-             // AS: here we turn wfdeque[0] into k_1
-             ((*wfdeque[0]).sd(ispin,ikp)->c()).axpy(-1.0*s_.ctrl.tddt*(complex<double>(0,1)), dwf.sd(ispin,ikp)->c() );
+             // AS: here we turn dwf into k_1
+             (dwf.sd(ispin,ikp)->c()) *= -1.0*s_.ctrl.tddt*(complex<double>(0,1));
+             ((*wfdeque[1]).sd(ispin,ikp)->c()).axpy(1.0/6.0, dwf.sd(ispin,ikp)->c() );
              // AS: here we turn wf into |psi(t)+0.5*k_1>
-             ((s_.wf).sd(ispin,ikp)->c()).axpy(0.5, (*wfdeque[0]).sd(ispin,ikp)->c() );
+             ((s_.wf).sd(ispin,ikp)->c()).axpy(0.5, dwf.sd(ispin,ikp)->c() );
           }
        }
 
@@ -1006,16 +1140,17 @@ void EhrenSampleStepper::step(int niter)
        tmap["efn"].stop();
 
        // AS: setting wf back to |psi(t)>
-       s_.wf=(*wfdeque[4]);
+       s_.wf=(*wfdeque[0]);
 
        for ( int ispin = 0; ispin < wf.nspin(); ispin++ )
        {
           for ( int ikp = 0; ikp < wf.nkp(); ikp++ )
           {
-             // AS: here we turn wfdeque[1] into k_2
-             ((*wfdeque[1]).sd(ispin,ikp)->c()).axpy(-1.0*s_.ctrl.tddt*(complex<double>(0,1)), dwf.sd(ispin,ikp)->c() );
+             // AS: here we turn dwf into k_2
+             (dwf.sd(ispin,ikp)->c()) *= -1.0*s_.ctrl.tddt*(complex<double>(0,1));
+             ((*wfdeque[1]).sd(ispin,ikp)->c()).axpy(1.0/3.0, dwf.sd(ispin,ikp)->c() );
              // AS: here we turn wf into |psi(t)+0.5*k_2>
-             ((s_.wf).sd(ispin,ikp)->c()).axpy(0.5, (*wfdeque[1]).sd(ispin,ikp)->c() );
+             ((s_.wf).sd(ispin,ikp)->c()).axpy(0.5, dwf.sd(ispin,ikp)->c() );
           }
        }
        
@@ -1047,16 +1182,17 @@ void EhrenSampleStepper::step(int niter)
        tmap["efn"].stop();
 
        // AS: setting wf back to |psi(t)>
-       s_.wf=(*wfdeque[4]);
+       s_.wf=(*wfdeque[0]);
 
        for ( int ispin = 0; ispin < wf.nspin(); ispin++ )
        {
           for ( int ikp = 0; ikp < wf.nkp(); ikp++ )
           {
-             // AS: here we turn wfdeque[2] into k_3
-             ((*wfdeque[2]).sd(ispin,ikp)->c()).axpy(-1.0*s_.ctrl.tddt*(complex<double>(0,1)), dwf.sd(ispin,ikp)->c() );
+             // AS: here we turn dwf into k_3
+             (dwf.sd(ispin,ikp)->c()) *= -1.0*s_.ctrl.tddt*(complex<double>(0,1));
+             ((*wfdeque[1]).sd(ispin,ikp)->c()).axpy(1.0/3.0, dwf.sd(ispin,ikp)->c() );
              // AS: here we turn wf into |psi(t)+k_3>
-             ((s_.wf).sd(ispin,ikp)->c()).axpy(1.0, (*wfdeque[2]).sd(ispin,ikp)->c() );
+             ((s_.wf).sd(ispin,ikp)->c()).axpy(1.0, dwf.sd(ispin,ikp)->c() );
           }
        }
        
@@ -1083,17 +1219,9 @@ void EhrenSampleStepper::step(int niter)
        ef_.update_hamiltonian();
        ef_.update_vhxc();
        // AS: apply the Hamiltonian to |psi(t)+k_3>
+       // k_4 is formed from dwf by the FORKTD stepper
        ef_.energy(s_.wf, true,dwf,false,fion,false,sigma_eks);
        tmap["efn"].stop();
-
-       for ( int ispin = 0; ispin < wf.nspin(); ispin++ )
-       {
-          for ( int ikp = 0; ikp < wf.nkp(); ikp++ )
-          {
-             // AS: here we turn wfdeque[3] into k_4
-             ((*wfdeque[3]).sd(ispin,ikp)->c()).axpy(-1.0*s_.ctrl.tddt*(complex<double>(0,1)), dwf.sd(ispin,ikp)->c() );
-          }
-       }
        tmap["forktd_tot"].stop();
     }
 
@@ -1115,6 +1243,85 @@ void EhrenSampleStepper::step(int niter)
     wf_stepper->update(dwf);
     tmap["wfupdate"].stop();
 
+    if ( adapt_tddt )
+    {
+       double err = wf_stepper->error_estimate();
+       int nredo = 0;
+       while ( redo_steps && err > s_.ctrl.tddt_tol && tddt > tddt_min &&
+               nredo < max_redo )
+       {
+          // reject the step and take it again from psi(t), H(t) and A(t)
+          if ( oncoutpe && !log_quiet )
+             cout << "  <tddt_rejected> " << setprecision(8) << tddt << " "
+                  << err << " </tddt_rejected>" << endl;
+          tddt = max(tddt_min, max(0.2, 0.9*sqrt(s_.ctrl.tddt_tol/err))*tddt);
+          wf_stepper->set_tddt(tddt);
+
+          tmap["redo_copy"].start();
+          s_.wf = *wf_start;
+          *s_.hamil_wf = *hamwf_start;
+          istringstream sis(stepper_start);
+          wf_stepper->read_state(sis);
+          tmap["redo_copy"].stop();
+
+          tmap["charge"].start();
+          cd_.update_density();
+          ( ef_.hamil_cd() )->update_density();
+          tmap["charge"].stop();
+          tmap["efn"].start();
+          if ( ef_.vp )
+          {
+             istringstream vis(vp_start);
+             ef_.vp->read_state(vis);
+             ef_.vector_potential_changed(compute_stress);
+          }
+          ef_.update_hamiltonian();
+          ef_.update_vhxc();
+          tmap["efn"].stop();
+
+          if(ef_.vp) ef_.vp->calculate_acceleration(tddt_prev, tddt, currd_.total_current, cell);
+          tmap["preupdate"].start();
+          wf_stepper->preupdate();
+          tmap["preupdate"].stop();
+          if(ef_.vp) ef_.vp->propagate(tdtime + tddt, tddt);
+          wf_stepper->preprocess();
+
+          tmap["efn"].start();
+          if(ef_.vp) ef_.vector_potential_changed(compute_stress);
+          ef_.update_hamiltonian();
+          ef_.update_vhxc();
+          ef_.energy(s_.wf, true,dwf,false,fion,false,sigma_eks);
+          tmap["efn"].stop();
+
+          tmap["wfupdate"].start();
+          wf_stepper->update(dwf);
+          tmap["wfupdate"].stop();
+          err = wf_stepper->error_estimate();
+          nredo++;
+       }
+
+       // rescale the next step from the error estimate of the accepted one
+       if ( obslog )
+       {
+          obslog->add("tddt",tddt);
+          obslog->add("tddt_error",err);
+       }
+       if ( oncoutpe && !log_quiet )
+          cout << "  <tddt> " << setprecision(8) << tddt << " </tddt>"
+               << "  <tddt_error> " << err << " </tddt_error>" << endl;
+       tdtime += tddt;
+       tddt_prev = tddt;
+       if ( err >= 0.0 )
+       {
+          double fac = 2.0;
+          if ( err > 0.0 )
+             fac = 0.9*sqrt(s_.ctrl.tddt_tol/err);
+          fac = min(2.0, max(0.5, fac));
+          tddt = min(tddt_max, max(tddt_min, fac*tddt));
+          wf_stepper->set_tddt(tddt);
+       }
+    }
+
 
     // update ultrasoft functions if needed, call gram
     //ewd:  take this out?
@@ -1156,7 +1363,7 @@ void EhrenSampleStepper::step(int niter)
        tmap["phase"].stop();
     }
     
-    if ( oncoutpe )
+    if ( oncoutpe && output_energy )
     {
        cout.setf(ios::fixed,ios::floatfield);
        cout.setf(ios::right,ios::adjustfield);
@@ -1176,7 +1383,7 @@ void EhrenSampleStepper::step(int niter)
        s_.wf.printocc(); 
     
     // AS: for the correct output of the energy
-    if ( s_.ctrl.non_selfc_energy && (wf_dyn!="SORKTD") && (wf_dyn!="FORKTD") )
+    if ( output_energy && s_.ctrl.non_selfc_energy && (wf_dyn!="SORKTD") && (wf_dyn!="FORKTD") )
     {
        // AS: the wave functions used in the Hamiltonian are NOT updated here
        tmap["charge"].start();
@@ -1407,15 +1614,24 @@ void EhrenSampleStepper::step(int niter)
 
              D3vector edipole = tdmlwft->dipole();
              cell.fold_in_ws(edipole);
-             cout << " <electronic_dipole> " << edipole
-                  << " </electronic_dipole>" << endl;
              D3vector idipole = atoms.dipole();
-             cout << " <ionic_dipole> " << idipole
-                  << " </ionic_dipole>" << endl;
-             cout << " <total_dipole> " << idipole + edipole
-                  << " </total_dipole>" << endl;
-             cout << " <total_dipole_length> " << length(idipole + edipole)
-                  << " </total_dipole_length>" << endl;
+             if ( obslog )
+             {
+                obslog->add("electronic_dipole",edipole);
+                obslog->add("ionic_dipole",idipole);
+                obslog->add("total_dipole",idipole + edipole);
+             }
+             if ( !log_quiet )
+             {
+                cout << " <electronic_dipole> " << edipole
+                     << " </electronic_dipole>" << endl;
+                cout << " <ionic_dipole> " << idipole
+                     << " </ionic_dipole>" << endl;
+                cout << " <total_dipole> " << idipole + edipole
+                     << " </total_dipole>" << endl;
+                cout << " <total_dipole_length> " << length(idipole + edipole)
+                     << " </total_dipole_length>" << endl;
+             }
           }
     }
 
@@ -1458,7 +1674,23 @@ void EhrenSampleStepper::step(int niter)
 
           const Context* wfctxt = s_.wf.spincontext(0);
           FourierTransform* ft_ = cd_.vft();
-          if (wfctxt->mycol() == 0) {
+          if ( s_.ctrl.saveden_format != "cube" ) {
+             // all tasks write their slab of the grid, see GridFile.h
+             GridFileHeader h;
+             h.label = "electron density";
+             h.wordsize = ( s_.ctrl.saveden_format == "float" ) ? 4 : 8;
+             h.stride = s_.ctrl.saveden_stride;
+             h.mditer = s_.ctrl.mditer;
+             h.set_atoms(s_.atoms);
+             vector<const double*> fields(1,cd_.rhor[0].data());
+             const UnitCell& cell = s_.wf.cell();
+             GridFile::write(filebase + "." + oss.str() + ".grid",h,fields,*ft_,*wfctxt,
+                             s_.ctxt_,cell.a(0),cell.a(1),cell.a(2));
+             // the current is only up to date with a vector potential
+             if ( ef_.vp )
+                currd_.write_grid(&s_,curfilename + ".grid",h.wordsize,h.stride);
+          }
+          else if (wfctxt->mycol() == 0) {
              vector<double> rhortmp(ft_->np012loc());
              for (int j = 0; j < ft_->np012loc(); j++)
                 rhortmp[j] = cd_.rhor[0][j];
@@ -1471,8 +1703,7 @@ void EhrenSampleStepper::step(int niter)
                 }
              }
              if ( wfctxt->oncoutpe() ) {
-                ofstream os;
-                os.open(denfilename.c_str(),ofstream::out);    // text output
+                ostringstream os;    // cube header
                 os.setf(ios::fixed,ios::floatfield);
                 os << setprecision(8);
                 vector<double> tmprecv(ft_->np012());
@@ -1527,29 +1758,27 @@ void EhrenSampleStepper::step(int niter)
                 }
 
                 // write density data to file
-                int cnt = 0;
-                for (int ii = 0; ii < np0; ii++) {
-		   const int ip = (ii + np0/2) % np0;
-                   ostringstream oss;
-                   oss.setf(ios::scientific,ios::floatfield);
-                   oss << setprecision(5);
-                   for (int jj = 0; jj < np1; jj++) {
-		      const int jp = (jj + np1/2) % np1;
-                      for (int kk = 0; kk < np2; kk++) {
-			 const int kp = (kk + np2/2) % np2;
-                         int index = ip + jp*np0 + kp*np0*np1;
-                         oss << tmprecv[index] << " ";
-                         cnt++;
-                         if (cnt >= 6) {
-                            cnt = 0;
-                            oss << endl;
-                         }
-                      }
-                   }
-                   string tos = oss.str();
-                   os.write(tos.c_str(),tos.length());
+                if ( s_.ctrl.save_async ) {
+                   // format and write the file in the background
+                   if ( s_.ckpt_writer == 0 )
+                      s_.ckpt_writer = new AsyncFileWriter();
+                   const string header = os.str();
+                   std::shared_ptr<vector<double> > rho = std::make_shared<vector<double> >();
+                   rho->swap(tmprecv);
+                   s_.ckpt_writer->add([denfilename,header,rho,np0,np1,np2]() {
+                      ofstream dos(denfilename.c_str(),ofstream::out);
+                      dos << header;
+                      ChargeDensity::write_cube_data(dos,*rho,np0,np1,np2);
+                      dos.close();
+                   });
+                   s_.ckpt_writer->flush();
+                }
+                else {
+                   ofstream dos(denfilename.c_str(),ofstream::out);    // text output
+                   dos << os.str();
+                   ChargeDensity::write_cube_data(dos,tmprecv,np0,np1,np2);
+                   dos.close();
                 }
-                os.close();
              }
           }
 
@@ -1628,8 +1857,16 @@ void EhrenSampleStepper::step(int niter)
                 }
                 total_charge *= omega / ft_->np012(); 
                 total_dipole *= omega / ft_->np012();
-                cout << setprecision(10) << "total_charge: " << total_charge << endl;
-                cout << setprecision(10) << "total_dipole: " << total_dipole << endl;
+                if ( s_.obslog )
+                {
+                   s_.obslog->add("total_charge",total_charge);
+                   s_.obslog->add("density_dipole",total_dipole);
+                }
+                if ( !log_quiet )
+                {
+                   cout << setprecision(10) << "total_charge: " << total_charge << endl;
+                   cout << setprecision(10) << "total_dipole: " << total_dipole << endl;
+                }
              }
           }
        }
@@ -1666,7 +1903,15 @@ void EhrenSampleStepper::step(int niter)
              }
           }
           string filestr = dirstr + "/" + filebase;
-          s_.wf.write_states(filestr,format);
+          AsyncFileWriter* writer = 0;
+          if ( s_.ctrl.save_async )
+          {
+             if ( s_.ckpt_writer == 0 )
+                s_.ckpt_writer = new AsyncFileWriter();
+             writer = s_.ckpt_writer;
+          }
+          CheckpointCompressor cmp(s_.ctrl.save_compression,s_.ctrl.save_compression_tol);
+          s_.wf.write_states(filestr,format,writer,&cmp);
           s_.wf.write_mditer(filestr,s_.ctrl.mditer);
           
           // write .sys file
@@ -1706,9 +1951,36 @@ void EhrenSampleStepper::step(int niter)
              string hamwffile = filestr + "hamwf";
              if ( s_.ctxt_.mype()==0 )
                 cout << "<!-- MDSaveCmd:  wf write finished, writing hamil_wf to " << hamwffile << "... -->" << endl;
-             s_.hamil_wf->write_states(hamwffile,format);
+             s_.hamil_wf->write_states(hamwffile,format,writer,&cmp);
+
+             // propagator history for an exact continuation
+             TDState tdstate;
+             tdstate.wf_dyn = wf_dyn;
+             tdstate.mditer = s_.ctrl.mditer;
+             tdstate.tdstep = tdstep0 + iter + 1;
+             tdstate.tdtime = adapt_tddt ? tdtime : s_.ctrl.tddt*tdstate.tdstep;
+             tdstate.tddt = tddt;
+             tdstate.tddt_prev = tddt_prev;
+             ostringstream los;
+             const int has_vp = ( ef_.vp != 0 );
+             TDState::put(los,has_vp);
+             if ( has_vp )
+                ef_.vp->write_state(los);
+             wf_stepper->write_state(los);
+             tdstate.local = los.str();
+             if ( wf_dyn == "SOTD" && s_.wfv != 0 )
+             {
+                tdstate.has_wfv = true;
+                // the velocities are not orthonormal, keep them exact
+                CheckpointCompressor wfvcmp(cmp.active() ? "lossless" : "OFF",0.0);
+                s_.wfv->write_states(filestr + "wfv",format,writer,&wfvcmp);
+             }
+             tdstate.write(filestr + ".tdstate",s_.wf.context(),s_.wf.layout());
           }
-          
+
+          // the staged states are written while the run continues
+          if ( writer != 0 )
+             writer->flush();
        }
     }
 
@@ -1717,6 +1989,9 @@ void EhrenSampleStepper::step(int niter)
        s_.constraints.update_constraints(dt);
 
   } // for iter
+  ef_.set_compute_energy(true);
+  if ( obslog )
+     obslog->flush();
 
   tmap["total_niter"].stop();
 #ifdef TAU  
@@ -1736,6 +2011,7 @@ void EhrenSampleStepper::step(int niter)
     int kmultloc = s_.wf.nkptloc();
     ef_.print_memory(cout,memtot,loctot);
     s_.wf.sd(0,0)->print_memory(cout,kmult,kmultloc,memtot,loctot);
+    wf_stepper->print_memory(cout,memtot,loctot);
 
     cd_.print_memory(cout,memtot,loctot);
     
@@ -1885,6 +2161,8 @@ void EhrenSampleStepper::step(int niter)
 
   // delete steppers
   delete wf_stepper;
+  delete wf_start;
+  delete hamwf_start;
   if(ionic_stepper) delete ionic_stepper;
   delete cell_stepper;
 
@@ -55,6 +55,7 @@ using namespace std;
 EnergyFunctional::EnergyFunctional( Sample& s, const Wavefunction& wf, ChargeDensity& cd)
     : s_(s), wf_(wf), cd_(cd) {   // remove const from Sample
   const AtomSet& atoms = s_.atoms;
+  compute_energy_ = true;
   
   const bool compute_stress = ( s_.ctrl.stress == "ON" );  // if stress off, don't store dtwnl
 
@@ -399,6 +400,7 @@ void EnergyFunctional::print_timing() {
            nlp[ispin][i]->print_timing();
      }
 
+  if (s_.ctrl.xc=="HF" || s_.ctrl.xc=="PBE0" || s_.ctrl.xc=="RSH" || s_.ctrl.xc=="BHLYP" || s_.ctrl.xc=="B3LYP") xop_->print_timing();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -439,7 +441,7 @@ void EnergyFunctional::update_vhxc(void) {
       vxc_tau[ispin][i] = 0.0; //YY
   
   //fill(v_r[ispin].begin(),v_r[ispin].end(),0.0);
-  if (not_hartree_fock)  xcp_->update(v_r, vxc_tau); //YY
+  if (not_hartree_fock)  xcp_->update(v_r, vxc_tau, compute_energy_); //YY
   if (s_.ctrl.has_absorbing_potential && s_.ctrl.tddft_involved) {
   abp_->update(vabs_r); } // YY
   if (not_hartree_fock) exc_ = xcp_->exc();
@@ -565,9 +567,11 @@ void EnergyFunctional::update_vhxc(void) {
      tsum[1] = vfact * omega * fpi * ehsum;
      // tsum[1] contains ehart
   
-     vbasis_->context().dsum(2,1,&tsum[0],2);
-     eps_   = tsum[0];
-     ehart_ = tsum[1];
+     if ( compute_energy_ ) {
+       vbasis_->context().dsum(2,1,&tsum[0],2);
+       eps_   = tsum[0];
+       ehart_ = tsum[1];
+     }
   
      // compute vlocal_g = vion_local_g + vhart_g
      // where vhart_g = 4 * pi * (rhoelg + rhopst) * g2i  
@@ -1249,7 +1253,8 @@ double EnergyFunctional::energy(Wavefunction& psi, bool compute_hpsi, Wavefuncti
   sigma_ekin = 0.0;
   sigma_econf = 0.0;
   valarray<double> sum(0.0,14), tsum(0.0,14);
-  for ( int ispin = 0; ispin < psi.nspin(); ispin++ ) {
+  const bool ekin_terms = compute_energy_ || compute_stress;
+  for ( int ispin = 0; ekin_terms && ispin < psi.nspin(); ispin++ ) {
      if (psi.spinactive(ispin)) {
         for ( int ikp=0; ikp<psi.nkp(); ikp++) {
            if (psi.kptactive(ikp)) {
@@ -1375,7 +1380,8 @@ double EnergyFunctional::energy(Wavefunction& psi, bool compute_hpsi, Wavefuncti
   sum /= psi.weightsum();
 
   // sum contains the contributions to ekin, etc.. from this task
-  psi.wfcontext()->dsum(14,1,&sum[0],14);
+  if ( ekin_terms )
+    psi.wfcontext()->dsum(14,1,&sum[0],14);
  
   ekin_  = sum[0];
   econf_ = sum[7];
@@ -1602,11 +1608,15 @@ double EnergyFunctional::energy(Wavefunction& psi, bool compute_hpsi, Wavefuncti
       }
     }
   }
-  dwf.wfcontext()->dsum('r',2,1,&enlsum[0],2);     // weighted average over all kpoints
-  assert(enlsum[1] != 0.0);
-  if (psi.nspin() == 2)
-    enlsum[1] *= 0.5;
-  enl_ = enlsum[0]/enlsum[1];
+  // without energy, forces or stress the sums are not reduced: a task
+  // without local k-points has no weight, and enl_ is not updated
+  if ( compute_energy_ || compute_forces || compute_stress ) {
+    dwf.wfcontext()->dsum('r',2,1,&enlsum[0],2);     // weighted average over all kpoints
+    assert(enlsum[1] != 0.0);
+    if (psi.nspin() == 2)
+      enlsum[1] *= 0.5;
+    enl_ = enlsum[0]/enlsum[1];
+  }
 
   if (compute_forces) {
     for (int is=0; is<nsp_; is++) 
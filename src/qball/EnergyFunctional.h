@@ -100,6 +100,7 @@ class EnergyFunctional
   double hf_contribution;
   double hf_pbe0; 
   bool not_hartree_fock;
+  bool compute_energy_; // if false, skip the reductions of the energy terms
   //bool not_pbe0;
   vector<double> fion_vdw_;
   
@@ -125,6 +126,11 @@ class EnergyFunctional
     bool compute_forces, vector<vector<double> >& fion,
                 bool compute_stress, valarray<double>& sigma);
   
+  // energy terms that do not enter H*psi, the forces or the stress are only
+  // reduced (and thus valid) if compute_energy is set (default)
+  void set_compute_energy(bool b) { compute_energy_ = b; }
+  bool compute_energy(void) const { return compute_energy_; }
+
   double etotal(void) const { return etotal_; }
   double ekin(void) const { return ekin_; }
   double econf(void) const { return econf_; }
@@ -33,117 +33,133 @@
 #include "SelfConsistentPotential.h"
 #include "SlaterDet.h"
 #include "Sample.h"
+#include "PrintMem.h"
+#include "TDState.h"
 #include <iostream>
+#include <iomanip>
 #include <deque>
+#include <cassert>
 using namespace std;
 
+
 ////////////////////////////////////////////////////////////////////////////////
-ExponentialWavefunctionStepper::ExponentialWavefunctionStepper(Wavefunction& wf, double tddt, TimerMap& tmap, EnergyFunctional & ef, Sample & s, bool approximated)
-    : tddt_(tddt), WavefunctionStepper(wf,tmap), ef_(ef), s_(s), approximated_(approximated), expwf_(s.wf), wfhalf_(s.wf), newwf_(s.wf) 
+ExponentialWavefunctionStepper::ExponentialWavefunctionStepper(Wavefunction& wf, double tddt, TimerMap& tmap, EnergyFunctional & ef, Sample & s, bool approximated, Wavefunction* workwf)
+    : tddt_(tddt), WavefunctionStepper(wf,tmap), ef_(ef), s_(s), approximated_(approximated), newwf_(s.wf), workwf_(workwf), predwf_(0) 
 {
   order_ = 4;
   potential_.resize(3);
   stored_iter_ = 0;
-  merge_exp_ = false;
+  estimate_error_ = false;
+  error_ = -1.0;
+  own_workwf_ = ( workwf_ == 0 );
+  if ( own_workwf_ )
+    workwf_ = new Wavefunction(s.wf);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void ExponentialWavefunctionStepper::exponential(int num_exp, double dt1, double dt2, Wavefunction * dwf){
+ExponentialWavefunctionStepper::~ExponentialWavefunctionStepper()
+{
+  if ( own_workwf_ )
+    delete workwf_;
+  delete predwf_;
+}
 
-  // The first input argument num_exp determines if the current call to 
-  // exponential requires one or two timestep args and exponential calcs 
-  
-  // dummy variables to call ef_.energy
-  std::vector<std::vector<double> > fion;
-  std::valarray<double> sigma;
+////////////////////////////////////////////////////////////////////////////////
+void ExponentialWavefunctionStepper::enable_error_estimate(void)
+{
+  estimate_error_ = true;
+  if ( predwf_ == 0 )
+    predwf_ = new Wavefunction(s_.wf);
+}
 
-  // if dwf is not explicitly passed, recreate the dwf object with the
-  // ef.energy() call
-  if (dwf == 0)
+////////////////////////////////////////////////////////////////////////////////
+int ExponentialWavefunctionStepper::nwf_allocated(void) const
+{
+  int n = 1;
+  if ( own_workwf_ )
+    n++;
+  if ( predwf_ != 0 )
+    n++;
+  return n;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void copy_states(Wavefunction& dst, const Wavefunction& src)
+{
+  for ( int ispin = 0; ispin < src.nspin(); ispin++)
+    for ( int ikp = 0; ikp < src.nkp(); ikp++ )
+      dst.sd(ispin, ikp)->c() = src.sd(ispin, ikp)->c();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void horner_step(Wavefunction& y, complex<double> a, const Wavefunction& x)
+{
+  // y <- x + a*y in one pass over the local coefficients
+  for ( int ispin = 0; ispin < y.nspin(); ispin++)
   {
-    dwf = &wfhalf_;
-    tmap_["expowf_ef"].start();
-    ef_.energy(wf_, true, *dwf, false, fion, false, sigma);
-    tmap_["expowf_ef"].stop();
+    for ( int ikp = 0; ikp < y.nkp(); ikp++ )
+    {
+      ComplexMatrix& cy = y.sd(ispin, ikp)->c();
+      const ComplexMatrix& cx = x.sd(ispin, ikp)->c();
+      complex<double>* py = cy.valptr();
+      const complex<double>* px = cx.cvalptr();
+      const int size = cy.size();
+      for ( int i = 0; i < size; i++ )
+        py[i] = px[i] + a * py[i];
+    }
   }
+}
 
-  // Expand exp(A)x as a 4th order Taylor series
-  // exp(A)x ~= x + Ax + A^2x/2! + A^3x/3! + A^4x/4!
-  //          = x + Ax + A(Ax)/2 + A(A^2x/2)/3 + A(A^3x/6)/4 
-  
-  // order 0
-  // For the 0th order term of the Taylor expansion, simply copy the
-  // wavefunctions from wf_ to expwf_ for the first exponential calculation
-  // and conditionally from wf_ to newwf_ for the second exponential calculation
-  tmap_["expowf_copy"].start();
-  for ( int ispin = 0; ispin < wf_.nspin(); ispin++)
-    for ( int ikp = 0; ikp < wf_.nkp(); ikp++ )
-      expwf_.sd(ispin, ikp)->c() = wf_.sd(ispin, ikp)->c();
-  
-  if (num_exp == 2)
-  {
-    for ( int ispin = 0; ispin < wf_.nspin(); ispin++)
-      for ( int ikp = 0; ikp < wf_.nkp(); ikp++ )
-        newwf_.sd(ispin, ikp)->c() = wf_.sd(ispin, ikp)->c();
-  } 
-  tmap_["expowf_copy"].stop();
+////////////////////////////////////////////////////////////////////////////////
+void ExponentialWavefunctionStepper::exponential(int num_exp, double dt1, double dt2, Wavefunction * dwf){
 
-  // initialize factors by which each additional term in the Taylor expansion
-  // will be multiplied --- factor 1 for the first exponential and factor 2
-  // for the second exponential (only used if a second exp() is requested). 
-  complex<double> factor1 = 1.0;
-  complex<double> factor2 = 1.0;
- 
-  //order N:
-  for(int N = 1; N <= order_; N++)
-  {
-    factor1 *= -complex<double>(0.0, 1.0)*dt1/double(N);
-    if (num_exp == 2)
-      factor2 *= -complex<double>(0.0, 1.0)*dt2/double(N);
+  // Propagates wf_ by exp(-i dt1 H). Only one exponential is computed per
+  // call; dt2 is used by derived classes that compute two at once.
+  assert(num_exp == 1);
+  assert(s_.hamil_wf != &wf_);
+
+  // dummy variables to call ef_.energy
+  std::vector<std::vector<double> > fion;
+  std::valarray<double> sigma;
 
-    if(N != 1)        // for N == 1 this is already done
+  // Expand exp(A)x, A = -i dt H, as a 4th order Taylor series evaluated
+  // with the Horner scheme
+  // exp(A)x ~= x + A(x + A/2(x + A/3(x + A/4 x)))
+  // Each partial sum y_N = x + A/N y_(N+1) is formed in the buffer that
+  // receives H y_(N+1), so no term is copied and x stays in wf_ until the
+  // end. The partial sums alternate between workwf_ and hamil_wf, which is
+  // overwritten with the result anyway; the last one ends in hamil_wf.
+  // If dwf is passed it must contain H wf_ and is used for the first term.
+  Wavefunction* buf[2] = { workwf_, s_.hamil_wf };
+  int ib = ( order_ % 2 == 0 ) ? 0 : 1;
+  Wavefunction* y = &wf_;
+  for ( int N = order_; N >= 1; N-- )
+  {
+    Wavefunction* hy = buf[ib];
+    if ( N == order_ && dwf != 0 )
     {
-       tmap_["expowf_copy"].start();
-       //move dwf to wf
-       for ( int ispin = 0; ispin < wf_.nspin(); ispin++)
-          for ( int ikp = 0; ikp < wf_.nkp(); ikp++ )
-             wf_.sd(ispin, ikp)->c() = dwf->sd(ispin, ikp)->c();
-       tmap_["expowf_copy"].stop();
-      
-       // apply A
-       tmap_["expowf_ef"].start();
-       ef_.energy(wf_, true, *dwf, false, fion, false, sigma);
-       tmap_["expowf_ef"].stop();
+      hy = dwf;
     }
-    
-    // accumulate the result of propagating wf_ by the first 
-    // time step (dt1) in expwf_. If a second time step is provided, 
-    // store the wavefunctions propagated by that time step in newwf_
-    tmap_["expowf_axpy"].start();
-    for ( int ispin = 0; ispin < wf_.nspin(); ispin++)
-       for ( int ikp = 0; ikp < wf_.nkp(); ikp++ )
-          expwf_.sd(ispin, ikp)->c().axpy(factor1, dwf->sd(ispin, ikp)->c());
-    
-    if (num_exp == 2)
+    else
     {
-      for ( int ispin = 0; ispin < wf_.nspin(); ispin++)
-         for ( int ikp = 0; ikp < wf_.nkp(); ikp++ )
-            newwf_.sd(ispin, ikp)->c().axpy(factor2, dwf->sd(ispin, ikp)->c());
+      tmap_["expowf_ef"].start();
+      ef_.energy(*y, true, *hy, false, fion, false, sigma);
+      tmap_["expowf_ef"].stop();
     }
+
+    tmap_["expowf_axpy"].start();
+    horner_step(*hy, -complex<double>(0.0, 1.0)*dt1/double(N), wf_);
     tmap_["expowf_axpy"].stop();
-    
-  } // Note: this bracket terminates the for loop from 1 to order_
-  
-  tmap_["expowf_copy"].start();
-  // copy the result back to THE wavefunction, wf_
-  for ( int ispin = 0; ispin < wf_.nspin(); ispin++)
-  {
-    for ( int ikp = 0; ikp < wf_.nkp(); ikp++ )
-    {
-      wf_.sd(ispin, ikp)->c() = expwf_.sd(ispin, ikp)->c();
-      s_.hamil_wf->sd(ispin, ikp)->c() = wf_.sd(ispin, ikp)->c();
-    }
+
+    y = hy;
+    ib = 1 - ib;
   }
+
+  // copy the result back to THE wavefunction, wf_
+  tmap_["expowf_copy"].start();
+  if ( y != s_.hamil_wf )
+    copy_states(*s_.hamil_wf, *y);
+  copy_states(wf_, *s_.hamil_wf);
   tmap_["expowf_copy"].stop();
   
 }
@@ -152,11 +168,17 @@ void ExponentialWavefunctionStepper::exponential(int num_exp, double dt1, double
 ////////////////////////////////////////////////////////////////////////////////
 void ExponentialWavefunctionStepper::preupdate()
 {
-  // allocate memory for the input args to exponential()
-  int num_exp;
-  double dt1;
-  double dt2; 
- 
+  // no error estimate until the step is completed
+  error_ = -1.0;
+
+  // H psi is applied to the work buffers: they need the projectors of
+  // the current atomic positions
+  if ( s_.ctrl.ultrasoft )
+  {
+    workwf_->update_usfns();
+    s_.hamil_wf->update_usfns();
+  }
+
   if (approximated_)
   {
     // For AETRS, save the potential
@@ -168,44 +190,23 @@ void ExponentialWavefunctionStepper::preupdate()
  
   // The propagator is U(t + dt, t) = exp(-i dt/2 H(t + dt)) exp(-i dt/2 H(t))
   // In preupdate(), we propagate the wavefunctions (wf_) to psi(t + dt/2) using
-  // only part of this propagator, exp(-i dt/2 H(t)). Similarly, an approximation
-  // to the wavefunctions, psi(t + dt) are obtained by using the propagator,
-  // exp(-i dt H(t)). 
-
-  if (merge_exp_) 
-  { 
-    // Propagate the wavefunctions by half a time step and by a full time
-    // step in one exponential() call. At the end of the call, wavefunctions at time
-    // t + dt will be stored in wf_ and wavefunctions at time t + dt/2 will be
-    // stored in newwf_.
-    num_exp = 2;
-    dt1 = tddt_;
-    dt2 = 0.5*tddt_;
-    exponential(num_exp, dt1, dt2);
-  }
-  else 
-  {
-    // Propagate the wavefunctions by half a time step and by a full time step
-    // in two separate exponential calls.
-    num_exp = 1;
-    dt1 = 0.5*tddt_;
-    dt2 = 0.0;
-    // First, propagate to t + dt/2
-    exponential(num_exp, dt1, dt2);
-    // Then, backup the wavefunctions at t + dt/2 in newwf_ 
-    tmap_["expowf_copy"].start();
-    for ( int ispin = 0; ispin < wf_.nspin(); ispin++)
-       for ( int ikp = 0; ikp < wf_.nkp(); ikp++ )
-          newwf_.sd(ispin, ikp)->c() = wf_.sd(ispin, ikp)->c(); 
-    tmap_["expowf_copy"].stop();
-    // Finally, propagate wavefunctions in wf_ from t + dt/2 to t + dt via
-    // a second half step
-    exponential(num_exp, dt1, dt2);
-  }
-
+  // only part of this propagator, exp(-i dt/2 H(t)). For ETRS, an approximation
+  // to the wavefunctions, psi(t + dt), is then obtained by a second half step
+  // with H(t) and psi(t + dt/2) is kept in newwf_.
+  exponential(1, 0.5*tddt_, 0.0);
 
   if( approximated_ && stored_iter_ >= 3 )
   {
+     // AETRS does not need the predictor, except for the error estimate
+     if (estimate_error_)
+     {
+        tmap_["expowf_copy"].start();
+        copy_states(newwf_, wf_);
+        tmap_["expowf_copy"].stop();
+        exponential(1, 0.5*tddt_, 0.0);
+        keep_predictor();
+     }
+
      // If running AETRS, extrapolate the potential using values of the
      // potential from previous stored iterations 
      tmap_["expowf_copy"].start();
@@ -214,37 +215,25 @@ void ExponentialWavefunctionStepper::preupdate()
      ef_.set_self_consistent_potential(future_potential);
      tmap_["expowf_copy"].stop();
 
-     // now do the other half of the propagation with H(t + dt)
-     //
-     // At the time the function call to exponential() is made below, psi(t + dt/2)
-     // --- what you want to propagate forward by another half step -- is stored
-     // in newwf_. Move this version of the wavefunction to wf_ before 
-     // propagation.
-     tmap_["expowf_copy"].start();
-     for ( int ispin = 0; ispin < wf_.nspin(); ispin++)
-         for ( int ikp = 0; ikp < wf_.nkp(); ikp++ )
-            wf_.sd(ispin, ikp)->c() = newwf_.sd(ispin, ikp)->c(); 
-     tmap_["expowf_copy"].stop();
-     
-     // Redefine time step arguments so that only one exponential is calculated
-     // within exponential()
-     num_exp = 1;
-     dt1 = 0.5*tddt_;
-     dt2 = 0.0;
      // Propagate psi(t + dt/2) to psi(t + dt) using H(t + dt)
-     exponential(num_exp, dt1, dt2);
+     exponential(1, 0.5*tddt_, 0.0);
+     compute_error();
   } 
+  else
+  {
+    // backup the wavefunctions at t + dt/2 in newwf_ and propagate wf_
+    // from t + dt/2 to t + dt with H(t)
+    tmap_["expowf_copy"].start();
+    copy_states(newwf_, wf_);
+    tmap_["expowf_copy"].stop();
+    exponential(1, 0.5*tddt_, 0.0);
+  }
 
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void ExponentialWavefunctionStepper::update(Wavefunction& dwf)
 {
-   // Define time step args for both AETRS and ETRS 
-   int num_exp = 1;
-   double dt1 = 0.5*tddt_;
-   double dt2 = 0.0;
-
    if ( !approximated_ || stored_iter_ < 3 )
    {
      // For ETRS, update the Hamiltonian from H(t) to H(t + dt) given
@@ -261,16 +250,101 @@ void ExponentialWavefunctionStepper::update(Wavefunction& dwf)
      ef_.update_vhxc();
      tmap_["expowf_ef"].stop();
 
+     if ( s_.ctrl.ultrasoft )
+     {
+       workwf_->update_usfns();
+       s_.hamil_wf->update_usfns();
+     }
+
      // Copy the wavefunctions at t + dt/2 (currently in newwf_) to wf_
-     tmap_["expowf_copy"].start();
-     for ( int ispin = 0; ispin < wf_.nspin(); ispin++)
-         for ( int ikp = 0; ikp < wf_.nkp(); ikp++ )
-            wf_.sd(ispin, ikp)->c() = newwf_.sd(ispin, ikp)->c();
-     tmap_["expowf_copy"].stop();
+     keep_predictor();
     
      // Propagate the wavefunctions in wf_ from t + dt/2 to t + dt
      // using H(t + dt)
-     exponential(num_exp, dt1, dt2);
+     exponential(1, 0.5*tddt_, 0.0);
+     compute_error();
    }
    
 }
+
+////////////////////////////////////////////////////////////////////////////////
+void ExponentialWavefunctionStepper::keep_predictor()
+{
+   // Move psi(t + dt/2) from newwf_ to wf_. If the error is estimated,
+   // the predictor exp(-i dt/2 H(t)) psi(t + dt/2) in wf_ is kept in
+   // predwf_.
+   tmap_["expowf_copy"].start();
+   if (estimate_error_)
+      copy_states(*predwf_, wf_);
+   copy_states(wf_, newwf_);
+   tmap_["expowf_copy"].stop();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ExponentialWavefunctionStepper::compute_error()
+{
+   // The predictor is first order in the variation of H over the step,
+   // ETRS second order: their difference estimates the local error.
+   // error_ is the rms difference per state.
+   if (!estimate_error_)
+      return;
+   tmap_["expowf_axpy"].start();
+   for ( int ispin = 0; ispin < wf_.nspin(); ispin++)
+      for ( int ikp = 0; ikp < wf_.nkp(); ikp++ )
+         predwf_->sd(ispin, ikp)->c().axpy(-1.0, wf_.sd(ispin, ikp)->c());
+   const double d2 = predwf_->dot(*predwf_);
+   error_ = sqrt(max(d2,0.0) / max(wf_.nst(0),1));
+   tmap_["expowf_axpy"].stop();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ExponentialWavefunctionStepper::print_memory(ostream& os, double& totsum, double& locsum) const
+{
+  os.setf(ios::fixed,ios::floatfield);
+  os.setf(ios::right,ios::adjustfield);
+  os << setprecision(3);
+  PrintMem pm;
+
+  const int kmult = wf_.nspin()*wf_.nkp();
+  const int kmultloc = wf_.nkptloc();
+  const ComplexMatrix& c = wf_.sd(0,0)->c();
+  const double psi_size = c.memsize()*kmult;
+  const double psi_locsize = c.localmemsize()*kmultloc;
+
+  const int nwf = nwf_allocated();
+  double wf_size = nwf*psi_size;
+  double wf_locsize = nwf*psi_locsize;
+  totsum += wf_size;
+  locsum += wf_locsize;
+  string wf_unit = pm.memunit(wf_size);
+  string wf_locunit = pm.memunit(wf_locsize);
+  os << "<!-- memory wf_stepper  :  " << setw(7) << wf_size << wf_unit << "  (" << wf_locsize << wf_locunit << " local) -->" << endl;
+
+  // the stepper used to allocate three wavefunctions and to copy the
+  // Taylor terms through them
+  if ( nwf < 3 )
+  {
+    double saved_size = (3-nwf)*psi_size;
+    double saved_locsize = (3-nwf)*psi_locsize;
+    string saved_unit = pm.memunit(saved_size);
+    string saved_locunit = pm.memunit(saved_locsize);
+    os << "<!-- memory wf_stepper saved:  " << setw(7) << saved_size << saved_unit << "  (" << saved_locsize << saved_locunit << " local) -->" << endl;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ExponentialWavefunctionStepper::write_state(std::ostream& os) const
+{
+  // AETRS extrapolates the potential from the last three steps
+  TDState::put(os,stored_iter_);
+  for ( int i = 0; i < potential_.size(); i++ )
+    potential_[i].write(os);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ExponentialWavefunctionStepper::read_state(std::istream& is)
+{
+  TDState::get(is,stored_iter_);
+  for ( int i = 0; i < potential_.size(); i++ )
+    potential_[i].read(is);
+}
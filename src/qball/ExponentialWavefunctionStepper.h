@@ -42,30 +42,46 @@ using namespace std;
 
 class ExponentialWavefunctionStepper : public WavefunctionStepper
 {
-  private:
+  protected:
 
   double tddt_;
   int order_;
   int stored_iter_;
   bool approximated_;
-  bool merge_exp_;
   std::vector<SelfConsistentPotential> potential_;
-  Wavefunction expwf_;
-  Wavefunction wfhalf_;
+  // psi(t + dt/2) between preupdate and update, the only wavefunction
+  // always allocated by the stepper
   Wavefunction newwf_; 
-
-  protected:
+  // work space for H psi: the caller's dwf if it is passed to the
+  // constructor, otherwise allocated here
+  Wavefunction* workwf_;
+  bool own_workwf_;
+  // predictor psi(t + dt) kept for the error estimate
+  Wavefunction* predwf_;
+  bool estimate_error_;
+  double error_;
 
   EnergyFunctional & ef_;
   Sample & s_;
-  void exponential(int num_exp, double dt1, double dt2, Wavefunction * dwf = 0);
+  virtual void exponential(int num_exp, double dt1, double dt2, Wavefunction * dwf = 0);
+  void keep_predictor(void);
+  void compute_error(void);
+  // number of full wavefunctions allocated by the stepper
+  virtual int nwf_allocated(void) const;
 
   public:
   void preupdate();
   void update(Wavefunction& dwf);
 
-  ExponentialWavefunctionStepper(Wavefunction& wf, double tddt, TimerMap& tmap, EnergyFunctional & ef, Sample & s, bool approximated);
-  ~ExponentialWavefunctionStepper() {};
+  void enable_error_estimate(void);
+  double error_estimate(void) const { return error_; }
+  void set_tddt(double tddt) { tddt_ = tddt; }
+  void print_memory(ostream& os, double& totsum, double& locsum) const;
+  void write_state(std::ostream& os) const;
+  void read_state(std::istream& is);
+
+  ExponentialWavefunctionStepper(Wavefunction& wf, double tddt, TimerMap& tmap, EnergyFunctional & ef, Sample & s, bool approximated, Wavefunction* workwf = 0);
+  virtual ~ExponentialWavefunctionStepper();
 };
 #endif
 
@@ -48,28 +48,25 @@ void ExternalPotential::update(const ChargeDensity& cd, const Context& new_col_c
   const Context* ctxt = s_.wf.spincontext(0);
   bool onpe0 = ctxt->onpe0();
   int nprow = ctxt->nprow();
-  int myrow = ctxt->myrow();
-  int mycol = ctxt->mycol();
   MPI_Comm vcomm = MPI_COMM_WORLD; 
 
   Timer tm_read_vext;
   double time, tmin, tmax;
 
   // In cube mode and xml mode, the external potential is
-  // read by processors on row 0 and stored in vext_read
+  // read by task 0 only, stored in vext_read and scattered below
   vector<double> vext_read, vext_read_loc;
 
   tm_read_vext.start();
   if ( fmt_ == "cube" )
   {
     // read cube file, n_'s are determined by cube file
-    if ( myrow == 0 )
+    if ( onpe0 )
     {
       ifstream vfile(filename_.c_str());
       if (!vfile)
       {
-        if (mycol == 0)
-          cout << "  ExternalPotential::update: file not found: "
+        cout << "  ExternalPotential::update: file not found: "
                << filename_ << endl;
         ctxt->abort(1);
       }
@@ -132,8 +129,7 @@ void ExternalPotential::update(const ChargeDensity& cd, const Context& new_col_c
   FourierTransform ft2(basis,vft->np0(),vft->np1(),vft->np2());
   vext_r_.resize(ft2.np012loc());
 
-  // xml mode or cube mode: processors on row 0 scatter
-  // vext to other rows
+  // xml mode or cube mode: task 0 scatters vext to the rows
   vector<int> scounts(nprow,0);
   vector<int> sdispls(nprow,0);
   int displ = 0;
@@ -46,6 +46,9 @@ using namespace std;
 // AS: k_3 = - dt (i / h) H[psi(t)+0.5*k_2] |psi(t)+0.5*k_2>
 // AS: k_4 = - dt (i / h) H[psi(t)+k_3] |psi(t)+k_3>
 // AS: |psi(t+dt)> = |psi(t)> + 1/6 * k_1 + 1/3 * k_2 + 1/3 * k_3 + 1/6 * k_4
+// The stages are computed in EhrenSampleStepper in place in dwf and summed
+// as soon as they are known: besides dwf only |psi(t)> and the partial sum
+// are stored.
 
 ////////////////////////////////////////////////////////////////////////////////
 FORKTDWavefunctionStepper::FORKTDWavefunctionStepper(Wavefunction& wf, double tddt,
@@ -55,20 +58,21 @@ FORKTDWavefunctionStepper::FORKTDWavefunctionStepper(Wavefunction& wf, double td
 ////////////////////////////////////////////////////////////////////////////////
 void FORKTDWavefunctionStepper::update(Wavefunction& dwf)
 {
-  wf_ = (*(*wfdeque_)[4]);
-
+  // low-storage form: (*wfdeque_)[1] contains |psi(t)> + 1/6 * k_1 +
+  // 1/3 * k_2 + 1/3 * k_3 and dwf contains H[psi(t)+k_3] |psi(t)+k_3>
   for ( int ispin = 0; ispin < wf_.nspin(); ispin++ )
   {
     for ( int ikp = 0; ikp < wf_.nkp(); ikp++ )
     {
       tmap_["sd_update_wf"].start();
 
-      (wf_.sd(ispin,ikp)->c()).axpy( 1.0/6.0, (*(*wfdeque_)[0]).sd(ispin,ikp)->c() );
-      (wf_.sd(ispin,ikp)->c()).axpy( 1.0/3.0, (*(*wfdeque_)[1]).sd(ispin,ikp)->c() );
-      (wf_.sd(ispin,ikp)->c()).axpy( 1.0/3.0, (*(*wfdeque_)[2]).sd(ispin,ikp)->c() );
-      (wf_.sd(ispin,ikp)->c()).axpy( 1.0/6.0, (*(*wfdeque_)[3]).sd(ispin,ikp)->c() );
+      // AS: here we turn dwf into k_4
+      (dwf.sd(ispin,ikp)->c()) *= -1.0*tddt_*(complex<double>(0,1));
+      ((*(*wfdeque_)[1]).sd(ispin,ikp)->c()).axpy( 1.0/6.0, dwf.sd(ispin,ikp)->c() );
 
       tmap_["sd_update_wf"].stop();
     }
   }
+
+  wf_ = (*(*wfdeque_)[1]);
 }
@@ -36,6 +36,7 @@
 #include <algorithm>
 #include <map>
 #include <cassert>
+#include <cstring>
 
 #if _OPENMP
 #include <omp.h>
@@ -690,13 +691,23 @@ void FourierTransform::bwd(complex<double>* val)
 
   // transpose
 #if USE_MPI
-  int status = MPI_Alltoallv((double*)&sbuf[0],&scounts[0],&sdispl[0],
-      MPI_DOUBLE,(double*)&rbuf[0],&rcounts[0],&rdispl[0],MPI_DOUBLE,
-      comm_);
-  if ( status != 0 )
+  // a single task only copies: no MPI call, so that transforms on
+  // different threads can run concurrently
+  if ( nprocs_ == 1 )
   {
-    cout << " FourierTransform: status = " << status << endl;
-    MPI_Abort(MPI_COMM_WORLD,2);
+    assert(scounts[0]==rcounts[0]);
+    memcpy((double*)&rbuf[0],(double*)&sbuf[0],scounts[0]*sizeof(double));
+  }
+  else
+  {
+    int status = MPI_Alltoallv((double*)&sbuf[0],&scounts[0],&sdispl[0],
+        MPI_DOUBLE,(double*)&rbuf[0],&rcounts[0],&rdispl[0],MPI_DOUBLE,
+        comm_);
+    if ( status != 0 )
+    {
+      cout << " FourierTransform: status = " << status << endl;
+      MPI_Abort(MPI_COMM_WORLD,2);
+    }
   }
 #else
   assert(sbuf.size()==rbuf.size());
@@ -1233,10 +1244,18 @@ void FourierTransform::fwd(complex<double>* val)
   tm_f_mpi.start();
 #endif
 #if USE_MPI
-  int status = MPI_Alltoallv((double*)&rbuf[0],&rcounts[0],&rdispl[0],
-      MPI_DOUBLE,(double*)&sbuf[0],&scounts[0],&sdispl[0],MPI_DOUBLE,
-      comm_);
-  assert ( status == 0 );
+  if ( nprocs_ == 1 )
+  {
+    assert(scounts[0]==rcounts[0]);
+    memcpy((double*)&sbuf[0],(double*)&rbuf[0],rcounts[0]*sizeof(double));
+  }
+  else
+  {
+    int status = MPI_Alltoallv((double*)&rbuf[0],&rcounts[0],&rdispl[0],
+        MPI_DOUBLE,(double*)&sbuf[0],&scounts[0],&sdispl[0],MPI_DOUBLE,
+        comm_);
+    assert ( status == 0 );
+  }
 #else
   assert(sbuf.size()==rbuf.size());
   sbuf = rbuf;
@@ -0,0 +1,132 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// GridFile.cc
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#include "GridFile.h"
+#include "AtomSet.h"
+#include "Context.h"
+#include "FourierTransform.h"
+#include <mpi.h>
+
+////////////////////////////////////////////////////////////////////////////////
+void GridFileHeader::set_atoms(const AtomSet& as)
+{
+  vector<vector<double> > rion(as.nsp());
+  for ( int is = 0; is < as.nsp(); is++ )
+    rion[is].resize(3*as.na(is));
+  as.get_positions(rion,true);
+  atoms.clear();
+  for ( int is = 0; is < as.nsp(); is++ )
+    for ( int ia = 0; ia < as.na(is); ia++ )
+    {
+      atoms.push_back(as.atomic_number(is));
+      atoms.push_back(rion[is][3*ia]);
+      atoms.push_back(rion[is][3*ia+1]);
+      atoms.push_back(rion[is][3*ia+2]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool GridFile::write(const string& filename, GridFileHeader& h,
+  const vector<const double*>& fields, const FourierTransform& ft,
+  const Context& ctxt, const Context& ioctxt, const D3vector& a0,
+  const D3vector& a1, const D3vector& a2)
+{
+  MPI_Comm comm = ioctxt.comm();
+  int mype;
+  MPI_Comm_rank(comm,&mype);
+
+  const int np0 = ft.np0();
+  const int np1 = ft.np1();
+  const int np2 = ft.np2();
+  const int st = h.stride > 0 ? h.stride : 1;
+  h.stride = st;
+  h.nfields = fields.size();
+  h.np[0] = (np0+st-1)/st;
+  h.np[1] = (np1+st-1)/st;
+  h.np[2] = (np2+st-1)/st;
+  h.d[0] = a0*((double)st/np0);
+  h.d[1] = a1*((double)st/np1);
+  h.d[2] = a2*((double)st/np2);
+  h.origin = D3vector(0.0,0.0,0.0);
+
+  MPI_File fh;
+  int rc = MPI_File_open(comm,(char*)filename.c_str(),
+                         MPI_MODE_CREATE|MPI_MODE_WRONLY,MPI_INFO_NULL,&fh);
+  if ( rc != MPI_SUCCESS )
+  {
+    if ( mype == 0 )
+      cout << "<ERROR> GridFile::write: cannot open " << filename
+           << " </ERROR>" << endl;
+    return false;
+  }
+  MPI_File_set_size(fh,0);
+
+  const string header = h.pack();
+  if ( mype == 0 )
+    MPI_File_write_at(fh,0,(void*)header.data(),header.size(),MPI_BYTE,
+                      MPI_STATUS_IGNORE);
+
+  // output planes k*st held by this task, packed with x index fastest
+  const bool writer = ctxt.active() && ctxt.mycol() == 0;
+  int kfirst = 0, nk = 0;
+  if ( writer )
+  {
+    const int k0 = ft.np2_first();
+    const int k1 = k0 + ft.np2_loc();
+    kfirst = (k0+st-1)/st;
+    nk = max(0,(k1+st-1)/st - kfirst);
+  }
+  const long long int nxy = (long long int) h.np[0]*h.np[1];
+  const int count = nk*nxy;
+  vector<char> buf(count*h.wordsize);
+  for ( int f = 0; f < h.nfields; f++ )
+  {
+    for ( int kk = 0; kk < nk; kk++ )
+    {
+      const int kloc = (kfirst+kk)*st - ft.np2_first();
+      for ( int j = 0; j < h.np[1]; j++ )
+        for ( int i = 0; i < h.np[0]; i++ )
+        {
+          const double v = fields[f][i*st + np0*(j*st + np1*kloc)];
+          const long long int l = i + h.np[0]*(j + h.np[1]*kk);
+          if ( h.wordsize == 4 )
+            ((float*) &buf[0])[l] = (float) v;
+          else
+            ((double*) &buf[0])[l] = v;
+        }
+    }
+    const MPI_Offset offset = h.size() +
+      ( f*h.npoints() + kfirst*nxy ) * h.wordsize;
+    MPI_File_write_at_all(fh,offset,count > 0 ? &buf[0] : 0,
+                          count*h.wordsize,MPI_BYTE,MPI_STATUS_IGNORE);
+  }
+  MPI_File_close(&fh);
+  return true;
+}
@@ -0,0 +1,152 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// GridFile.h
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#ifndef GRIDFILE_H
+#define GRIDFILE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <math/d3vector.h>
+using namespace std;
+
+class AtomSet;
+class Context;
+class FourierTransform;
+
+// Binary file of real fields (density, current) on the FFT grid, written
+// in parallel with MPI-IO: each task of the first process column writes
+// its z-slab at a fixed offset. Layout, native byte order:
+//   char[16] "qbox-grid-1"
+//   char[32] label
+//   int np0, np1, np2, nfields, wordsize, stride, natoms, mditer
+//   double d0[3], d1[3], d2[3]  grid step vectors (a_i*stride/np_i)
+//   double origin[3]            position of grid point (0,0,0)
+//   double Z, x, y, z           for each atom
+//   nfields blocks of np0*np1*np2 float (wordsize 4) or double (wordsize 8)
+//   values, x index fastest
+// np0, np1, np2 are the dimensions after downsampling by stride.
+// The qball-grid2cube program converts these files to cube or VTK.
+class GridFileHeader
+{
+  public:
+
+  string label;
+  int np[3];
+  int nfields;
+  int wordsize;
+  int stride;
+  int mditer;
+  D3vector d[3];
+  D3vector origin;
+  vector<double> atoms;  // Z, x, y, z for each atom
+
+  int natoms(void) const { return atoms.size()/4; }
+  long long int npoints(void) const
+  { return (long long int) np[0]*np[1]*np[2]; }
+  long long int size(void) const { return 48 + 8*4 + 12*8 + atoms.size()*8; }
+
+  string pack(void) const
+  {
+    char magic[16], lab[32];
+    memset(magic,0,16);
+    memset(lab,0,32);
+    strncpy(magic,"qbox-grid-1",15);
+    strncpy(lab,label.c_str(),31);
+    int ival[8] = { np[0], np[1], np[2], nfields, wordsize, stride,
+                    natoms(), mditer };
+    double dval[12];
+    for ( int i = 0; i < 3; i++ )
+    {
+      dval[3*i] = d[i].x; dval[3*i+1] = d[i].y; dval[3*i+2] = d[i].z;
+    }
+    dval[9] = origin.x; dval[10] = origin.y; dval[11] = origin.z;
+    string s(magic,16);
+    s.append(lab,32);
+    s.append((const char*) ival,sizeof(ival));
+    s.append((const char*) dval,sizeof(dval));
+    if ( !atoms.empty() )
+      s.append((const char*) &atoms[0],atoms.size()*sizeof(double));
+    return s;
+  }
+
+  // fill atoms with the atomic numbers and positions of as
+  void set_atoms(const AtomSet& as);
+
+  // returns false if is does not hold a grid file
+  bool read(istream& is)
+  {
+    char magic[16], lab[32];
+    int ival[8];
+    double dval[12];
+    is.read(magic,16);
+    is.read(lab,32);
+    is.read((char*) ival,sizeof(ival));
+    is.read((char*) dval,sizeof(dval));
+    if ( !is || strncmp(magic,"qbox-grid-1",16) != 0 )
+      return false;
+    lab[31] = '\0';
+    label = lab;
+    np[0] = ival[0]; np[1] = ival[1]; np[2] = ival[2];
+    nfields = ival[3];
+    wordsize = ival[4];
+    stride = ival[5];
+    mditer = ival[7];
+    for ( int i = 0; i < 3; i++ )
+      d[i] = D3vector(dval[3*i],dval[3*i+1],dval[3*i+2]);
+    origin = D3vector(dval[9],dval[10],dval[11]);
+    atoms.resize(4*ival[6]);
+    if ( ival[6] > 0 )
+      is.read((char*) &atoms[0],atoms.size()*sizeof(double));
+    return is && ( wordsize == 4 || wordsize == 8 );
+  }
+
+  GridFileHeader(void) : nfields(1), wordsize(8), stride(1), mditer(0)
+  { np[0] = np[1] = np[2] = 0; }
+};
+
+class GridFile
+{
+  public:
+
+  // Write the fields, distributed as the real-space grid of ft over the
+  // process rows of ctxt. Only the tasks of column 0 contribute data.
+  // h.np, h.d and h.origin are set from ft, cell a0, a1, a2 and h.stride.
+  // Collective on the communicator of ioctxt, which holds all the tasks
+  // calling write (the Sample context); returns false if the file cannot
+  // be written.
+  static bool write(const string& filename, GridFileHeader& h,
+                    const vector<const double*>& fields,
+                    const FourierTransform& ft, const Context& ctxt,
+                    const Context& ioctxt, const D3vector& a0,
+                    const D3vector& a1, const D3vector& a2);
+};
+#endif
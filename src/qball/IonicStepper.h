@@ -88,6 +88,9 @@ class IonicStepper
   }
 
   double r0(int is, int i) const { return r0_[is][i]; }
+  // change the time step before compute_r, the next compute_v then
+  // uses the same step
+  void set_dt(double dt) { dt_ = dt; }
   double v0(int is, int i) const { return v0_[is][i]; }
   const std::vector<std::vector<double> >& r0(void) const { return r0_; }
   const std::vector<std::vector<double> >& v0(void) const { return v0_; }
@@ -0,0 +1,324 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// KrylovWavefunctionStepper.cc
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#include "KrylovWavefunctionStepper.h"
+#include "SlaterDet.h"
+#include "Sample.h"
+#include <math/blas.h>
+#include <iostream>
+#include <iomanip>
+#include <valarray>
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+// list of the Slater determinants held by this task
+static void local_sds(const Wavefunction& wf, vector<SlaterDet*>& sdlist)
+{
+  sdlist.clear();
+  for ( int ispin = 0; ispin < wf.nspin(); ispin++ )
+    if ( wf.spinactive(ispin) )
+      for ( int ikp = 0; ikp < wf.nkp(); ikp++ )
+        if ( wf.kptactive(ikp) )
+          sdlist.push_back(wf.sd(ispin,ikp));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// c = exp(-i dt T) e_0 for the m x m real symmetric tridiagonal matrix T
+// with diagonal a[0..m-1] and off-diagonal b[1..m-1]
+static void tridiag_exp(int m, const double* a, const double* b, double dt,
+  complex<double>* c)
+{
+  valarray<double> t(0.0,m*m);
+  for ( int k = 0; k < m; k++ )
+  {
+    t[k+m*k] = a[k];
+    if ( k > 0 )
+    {
+      t[k+m*(k-1)] = b[k];
+      t[k-1+m*k] = b[k];
+    }
+  }
+  char jobz = 'V';
+  char uplo = 'L';
+  valarray<double> w(m);
+  int lwork = 3*m;
+  valarray<double> work(lwork);
+  int info;
+  dsyev(&jobz,&uplo,&m,&t[0],&m,&w[0],&work[0],&lwork,&info);
+  assert(info == 0);
+  for ( int k = 0; k < m; k++ )
+  {
+    c[k] = 0.0;
+    for ( int l = 0; l < m; l++ )
+      c[k] += t[k+m*l] * t[m*l] * exp(complex<double>(0.0,-dt*w[l]));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+KrylovWavefunctionStepper::KrylovWavefunctionStepper(Wavefunction& wf, double tddt, TimerMap& tmap, EnergyFunctional & ef, Sample & s, bool approximated, double tol, int maxdim, Wavefunction* workwf)
+    : ExponentialWavefunctionStepper(wf,tddt,tmap,ef,s,approximated,workwf), tol_(tol), maxdim_(maxdim)
+{
+  assert(maxdim_ > 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+KrylovWavefunctionStepper::~KrylovWavefunctionStepper()
+{
+  for ( int n = 0; n < basis_.size(); n++ )
+    delete basis_[n];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void KrylovWavefunctionStepper::exponential(int num_exp, double dt1, double dt2, Wavefunction * dwf){
+
+  // Short iterative Lanczos: for each state psi, build the Krylov space
+  // K_m = span{ q_0, H q_0, ..., H^(m-1) q_0 }, q_0 = psi/|psi|, in which
+  // H is the tridiagonal matrix T_m. Then
+  // exp(-i dt H) psi ~= |psi| Q_m exp(-i dt T_m) e_0
+  // with the error estimate |psi| beta_m |(exp(-i dt T_m) e_0)_(m-1)|.
+  // All states are iterated together so that each Lanczos step costs
+  // one application of the Hamiltonian.
+
+  // dummy variables to call ef_.energy
+  std::vector<std::vector<double> > fion;
+  std::valarray<double> sigma;
+
+  // H q_n is computed in workwf_ unless dwf is passed
+  Wavefunction& hwf = ( dwf == 0 ) ? *workwf_ : *dwf;
+
+  vector<SlaterDet*> sdw, sdh;
+  local_sds(wf_,sdw);
+  local_sds(hwf,sdh);
+  const int nsd = sdw.size();
+
+  // norms of the states and Lanczos coefficients:
+  // alpha[isd][n*nloc+j] and beta[isd][n*nloc+j] for local state j
+  vector<vector<double> > nrm(nsd), alpha(nsd), beta(nsd);
+
+  tmap_["expowf_axpy"].start();
+  for ( int isd = 0; isd < nsd; isd++ )
+  {
+    ComplexMatrix& c = sdw[isd]->c();
+    const int mloc = c.mloc();
+    const int nloc = c.nloc();
+    nrm[isd].resize(nloc);
+    for ( int j = 0; j < nloc; j++ )
+    {
+      const complex<double>* p = c.cvalptr(j*mloc);
+      double sum = 0.0;
+      for ( int i = 0; i < mloc; i++ )
+        sum += norm(p[i]);
+      nrm[isd][j] = sum;
+    }
+    if ( nloc > 0 )
+      c.context().dsum('c',nloc,1,&nrm[isd][0],nloc);
+    for ( int j = 0; j < nloc; j++ )
+    {
+      nrm[isd][j] = sqrt(nrm[isd][j]);
+      const double fac = nrm[isd][j] > 0.0 ? 1.0 / nrm[isd][j] : 0.0;
+      complex<double>* p = c.valptr(j*mloc);
+      for ( int i = 0; i < mloc; i++ )
+        p[i] *= fac;
+    }
+  }
+  tmap_["expowf_axpy"].stop();
+
+  int dim = 0;
+  double err = 0.0;
+  const double dtmax = max(fabs(dt1), num_exp == 2 ? fabs(dt2) : 0.0);
+  vector<complex<double> > ck(maxdim_);
+  while ( true )
+  {
+    // store q_n
+    tmap_["expowf_copy"].start();
+    if ( basis_.size() <= dim )
+      basis_.push_back(new Wavefunction(s_.wf));
+    {
+      vector<SlaterDet*> sdq;
+      local_sds(*basis_[dim],sdq);
+      for ( int isd = 0; isd < nsd; isd++ )
+        sdq[isd]->c() = sdw[isd]->c();
+    }
+    tmap_["expowf_copy"].stop();
+
+    // apply H to q_n
+    tmap_["expowf_ef"].start();
+    ef_.energy(wf_, true, hwf, false, fion, false, sigma);
+    tmap_["expowf_ef"].stop();
+
+    // w = H q_n - alpha_n q_n - beta_n q_(n-1), beta_(n+1) = |w|
+    tmap_["expowf_axpy"].start();
+    vector<SlaterDet*> sdprev;
+    if ( dim > 0 )
+      local_sds(*basis_[dim-1],sdprev);
+    err = 0.0;
+    for ( int isd = 0; isd < nsd; isd++ )
+    {
+      const ComplexMatrix& q = sdw[isd]->c();
+      ComplexMatrix& w = sdh[isd]->c();
+      const int mloc = q.mloc();
+      const int nloc = q.nloc();
+      alpha[isd].resize((dim+1)*nloc);
+      beta[isd].resize((dim+2)*nloc);
+      if ( dim == 0 )
+        for ( int j = 0; j < nloc; j++ )
+          beta[isd][j] = 0.0;
+      double* an = &alpha[isd][dim*nloc];
+      double* bn = &beta[isd][dim*nloc];
+      double* bn1 = &beta[isd][(dim+1)*nloc];
+      for ( int j = 0; j < nloc; j++ )
+      {
+        const complex<double>* pq = q.cvalptr(j*mloc);
+        const complex<double>* pw = w.cvalptr(j*mloc);
+        double sum = 0.0;
+        for ( int i = 0; i < mloc; i++ )
+          sum += real(conj(pq[i])*pw[i]);
+        an[j] = sum;
+      }
+      if ( nloc > 0 )
+        q.context().dsum('c',nloc,1,an,nloc);
+      for ( int j = 0; j < nloc; j++ )
+      {
+        const complex<double>* pq = q.cvalptr(j*mloc);
+        complex<double>* pw = w.valptr(j*mloc);
+        for ( int i = 0; i < mloc; i++ )
+          pw[i] -= an[j] * pq[i];
+        if ( dim > 0 )
+        {
+          const complex<double>* pp = sdprev[isd]->c().cvalptr(j*mloc);
+          for ( int i = 0; i < mloc; i++ )
+            pw[i] -= bn[j] * pp[i];
+        }
+        double sum = 0.0;
+        for ( int i = 0; i < mloc; i++ )
+          sum += norm(pw[i]);
+        bn1[j] = sum;
+      }
+      if ( nloc > 0 )
+        q.context().dsum('c',nloc,1,bn1,nloc);
+
+      // error estimate of each state
+      vector<double> a(dim+1), b(dim+1);
+      for ( int j = 0; j < nloc; j++ )
+      {
+        bn1[j] = sqrt(bn1[j]);
+        for ( int k = 0; k <= dim; k++ )
+        {
+          a[k] = alpha[isd][k*nloc+j];
+          b[k] = beta[isd][k*nloc+j];
+        }
+        tridiag_exp(dim+1,&a[0],&b[0],dtmax,&ck[0]);
+        err = max(err, nrm[isd][j] * bn1[j] * abs(ck[dim]));
+      }
+    }
+    wf_.context().dmax(1,1,&err,1);
+    dim++;
+
+    if ( err < tol_ || dim == maxdim_ )
+    {
+      tmap_["expowf_axpy"].stop();
+      break;
+    }
+
+    // q_(n+1) = w / beta_(n+1)
+    for ( int isd = 0; isd < nsd; isd++ )
+    {
+      ComplexMatrix& q = sdw[isd]->c();
+      const ComplexMatrix& w = sdh[isd]->c();
+      const int mloc = q.mloc();
+      const int nloc = q.nloc();
+      const double* bn1 = &beta[isd][dim*nloc];
+      for ( int j = 0; j < nloc; j++ )
+      {
+        const double fac = bn1[j] > 0.0 ? 1.0 / bn1[j] : 0.0;
+        const complex<double>* pw = w.cvalptr(j*mloc);
+        complex<double>* pq = q.valptr(j*mloc);
+        for ( int i = 0; i < mloc; i++ )
+          pq[i] = fac * pw[i];
+      }
+    }
+    tmap_["expowf_axpy"].stop();
+  }
+
+  if ( err >= tol_ && wf_.context().oncoutpe() )
+    cout << "<WARNING> KrylovWavefunctionStepper: Krylov space of dimension "
+         << maxdim_ << " not converged, error estimate " << err
+         << " </WARNING>" << endl;
+
+  // psi(t+dt) = |psi| Q_m exp(-i dt T_m) e_0 in wf_ for dt1 and in newwf_
+  // for dt2
+  tmap_["expowf_axpy"].start();
+  vector<SlaterDet*> sdn;
+  local_sds(newwf_,sdn);
+  vector<vector<SlaterDet*> > sdq(dim);
+  for ( int k = 0; k < dim; k++ )
+    local_sds(*basis_[k],sdq[k]);
+  vector<double> a(dim), b(dim);
+  for ( int iexp = 0; iexp < num_exp; iexp++ )
+  {
+    const double dt = ( iexp == 0 ) ? dt1 : dt2;
+    for ( int isd = 0; isd < nsd; isd++ )
+    {
+      ComplexMatrix& c = ( iexp == 0 ) ? sdw[isd]->c() : sdn[isd]->c();
+      const int mloc = c.mloc();
+      const int nloc = c.nloc();
+      for ( int j = 0; j < nloc; j++ )
+      {
+        for ( int k = 0; k < dim; k++ )
+        {
+          a[k] = alpha[isd][k*nloc+j];
+          b[k] = beta[isd][k*nloc+j];
+        }
+        tridiag_exp(dim,&a[0],&b[0],dt,&ck[0]);
+        complex<double>* p = c.valptr(j*mloc);
+        for ( int i = 0; i < mloc; i++ )
+          p[i] = 0.0;
+        for ( int k = 0; k < dim; k++ )
+        {
+          const complex<double> fac = nrm[isd][j] * ck[k];
+          const complex<double>* pq = sdq[k][isd]->c().cvalptr(j*mloc);
+          for ( int i = 0; i < mloc; i++ )
+            p[i] += fac * pq[i];
+        }
+      }
+    }
+  }
+  tmap_["expowf_axpy"].stop();
+
+  tmap_["expowf_copy"].start();
+  for ( int ispin = 0; ispin < wf_.nspin(); ispin++)
+    for ( int ikp = 0; ikp < wf_.nkp(); ikp++ )
+      s_.hamil_wf->sd(ispin, ikp)->c() = wf_.sd(ispin, ikp)->c();
+  tmap_["expowf_copy"].stop();
+
+  if ( wf_.context().oncoutpe() )
+    cout << "<!-- KrylovWavefunctionStepper: dimension " << dim
+         << ", error estimate " << err << " -->" << endl;
+}
@@ -0,0 +1,67 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// KrylovWavefunctionStepper.h
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#ifndef KRYLOVWAVEFUNCTIONSTEPPER_H
+#define KRYLOVWAVEFUNCTIONSTEPPER_H
+
+#include "ExponentialWavefunctionStepper.h"
+#include <vector>
+using namespace std;
+
+class SlaterDet;
+
+// Enforced time-reversal symmetry propagator in which each exponential
+// is evaluated in a Krylov space built by a short Lanczos iteration for
+// each state. The dimension of the space is increased until the
+// a posteriori error estimate of the exponential is below tol.
+class KrylovWavefunctionStepper : public ExponentialWavefunctionStepper
+{
+  private:
+
+  double tol_;
+  int maxdim_;
+  // Lanczos vectors, allocated when first needed
+  std::vector<Wavefunction*> basis_;
+
+  void exponential(int num_exp, double dt1, double dt2, Wavefunction * dwf = 0);
+  int nwf_allocated(void) const
+  { return ExponentialWavefunctionStepper::nwf_allocated() + basis_.size(); }
+
+  public:
+
+  KrylovWavefunctionStepper(Wavefunction& wf, double tddt, TimerMap& tmap, EnergyFunctional & ef, Sample & s, bool approximated, double tol, int maxdim, Wavefunction* workwf = 0);
+  ~KrylovWavefunctionStepper();
+};
+#endif
+
+// Local Variables:
+// mode: c++
+// coding: utf-8
+// End:
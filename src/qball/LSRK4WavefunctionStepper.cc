@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// LSRK4WavefunctionStepper.cc
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#include "LSRK4WavefunctionStepper.h"
+#include "EnergyFunctional.h"
+#include "ChargeDensity.h"
+#include "SlaterDet.h"
+#include "Sample.h"
+#include <iostream>
+#include <complex>
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+LSRK4WavefunctionStepper::LSRK4WavefunctionStepper(Wavefunction& wf, double tddt,
+ TimerMap& tmap, EnergyFunctional& ef, Sample& s) : WavefunctionStepper(wf,tmap),
+ tddt_(tddt), ef_(ef), s_(s), dpsi_(s.wf)
+{ }
+
+////////////////////////////////////////////////////////////////////////////////
+void LSRK4WavefunctionStepper::update(Wavefunction& dwf)
+{
+  // Carpenter-Kennedy coefficients, a_0 = 0
+  const int nstage = 5;
+  const double a[nstage] =
+  {
+     0.0,
+    -567301805773.0 / 1357537059087.0,
+    -2404267990393.0 / 2016746695238.0,
+    -3550918686646.0 / 2091501179385.0,
+    -1275806237668.0 / 842570457699.0
+  };
+  const double b[nstage] =
+  {
+     1432997174477.0 / 9575080441755.0,
+     5161836677717.0 / 13612068292357.0,
+     1720146321549.0 / 2090206949498.0,
+     3134564353537.0 / 4481467310338.0,
+     2277821191437.0 / 14882151754819.0
+  };
+  const complex<double> zdt = -1.0*tddt_*(complex<double>(0,1));
+
+  // dummy variables to call ef_.energy
+  std::vector<std::vector<double> > fion;
+  std::valarray<double> sigma;
+
+  // on entry dwf contains H[psi(t)] |psi(t)>
+  for ( int istage = 0; istage < nstage; istage++ )
+  {
+    if ( istage > 0 )
+    {
+      // set the Hamiltonian with the wave functions of the stage
+      tmap_["lsrk4_ef"].start();
+      (*s_.hamil_wf)=wf_;
+      ( ef_.hamil_cd() )->update_density();
+      ef_.update_hamiltonian();
+      ef_.update_vhxc();
+      ef_.energy(wf_, true, dwf, false, fion, false, sigma);
+      tmap_["lsrk4_ef"].stop();
+    }
+
+    tmap_["sd_update_wf"].start();
+    for ( int ispin = 0; ispin < wf_.nspin(); ispin++ )
+    {
+      for ( int ikp = 0; ikp < wf_.nkp(); ikp++ )
+      {
+        ComplexMatrix& dp = dpsi_.sd(ispin,ikp)->c();
+        if ( istage == 0 )
+        {
+          dp = dwf.sd(ispin,ikp)->c();
+          dp *= zdt;
+        }
+        else
+        {
+          dp *= a[istage];
+          dp.axpy(zdt, dwf.sd(ispin,ikp)->c());
+        }
+        (wf_.sd(ispin,ikp)->c()).axpy(b[istage], dp);
+      }
+    }
+    tmap_["sd_update_wf"].stop();
+  }
+}
@@ -0,0 +1,69 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// LSRK4WavefunctionStepper.h
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#ifndef LSRK4WAVEFUNCTIONSTEPPER_H
+#define LSRK4WAVEFUNCTIONSTEPPER_H
+
+#include "WavefunctionStepper.h"
+#include "Wavefunction.h"
+using namespace std;
+
+class EnergyFunctional;
+class Sample;
+
+// Fourth-order low-storage Runge-Kutta propagation of
+// d |psi(t)> / dt = - (i / h) H[psi(t)] |psi(t)>
+// with the five-stage 2N-storage scheme of Carpenter and Kennedy
+// (NASA TM-109112, 1994) in the form of Williamson:
+// dpsi <- a_i dpsi - dt (i / h) H[psi] |psi>,  psi <- psi + b_i dpsi
+// Only one wave function, dpsi, is stored besides psi and H psi. The
+// Hamiltonian is updated with the wave functions of each stage.
+class LSRK4WavefunctionStepper : public WavefunctionStepper
+{
+  private:
+
+  double tddt_;
+  EnergyFunctional& ef_;
+  Sample& s_;
+  Wavefunction dpsi_;
+
+  public:
+
+  void update(Wavefunction& dwf);
+  void set_tddt(double tddt) { tddt_ = tddt; }
+
+  LSRK4WavefunctionStepper(Wavefunction& wf, double tddt, TimerMap& tmap, EnergyFunctional& ef, Sample& s);
+  ~LSRK4WavefunctionStepper() {};
+};
+#endif
+
+// Local Variables:
+// mode: c++
+// End:
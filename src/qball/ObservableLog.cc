@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// ObservableLog.cc
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#include "ObservableLog.h"
+#include <iostream>
+#include <cstring>
+#include <stdint.h>
+#include <mpi.h>
+
+////////////////////////////////////////////////////////////////////////////////
+ObservableLog::ObservableLog(const string& filename, double flush_interval) :
+  filename_(filename), flush_interval_(flush_interval), tflush_(MPI_Wtime())
+{
+  char magic[16];
+  memset(magic,0,16);
+  strncpy(magic,"qbox-obs-1",15);
+
+  // append to an existing log, e.g. when a run is continued
+  ifstream is(filename.c_str(),ios::binary);
+  char head[16];
+  if ( is.read(head,16) )
+  {
+    is.close();
+    if ( memcmp(head,magic,16) != 0 )
+    {
+      cout << "<ERROR> ObservableLog: " << filename
+           << " exists and is not an observable log </ERROR>" << endl;
+      return;
+    }
+    os_.open(filename.c_str(),ios::binary|ios::app);
+    return;
+  }
+  is.close();
+
+  os_.open(filename.c_str(),ios::binary|ios::out|ios::trunc);
+  if ( !os_.is_open() )
+  {
+    cout << "<ERROR> ObservableLog: cannot open " << filename << " </ERROR>"
+         << endl;
+    return;
+  }
+  const int32_t mark[2] = { 0x01020304, 0 };
+  os_.write(magic,16);
+  os_.write((const char*) mark,sizeof(mark));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ObservableLog::~ObservableLog(void)
+{
+  flush();
+  os_.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ObservableLog::put_record(const string& name, const double* v, int n)
+{
+  map<string,int>::const_iterator it = id_.find(name);
+  int32_t rec[2];
+  if ( it == id_.end() )
+  {
+    rec[0] = id_.size();
+    rec[1] = -(int32_t)name.size();
+    id_[name] = rec[0];
+    buf_.append((const char*) rec,sizeof(rec));
+    buf_.append(name);
+  }
+  else
+    rec[0] = it->second;
+  rec[1] = n;
+  buf_.append((const char*) rec,sizeof(rec));
+  if ( n > 0 )
+    buf_.append((const char*) v,n*sizeof(double));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ObservableLog::begin_step(int mditer, double time)
+{
+  if ( MPI_Wtime() - tflush_ >= flush_interval_ )
+    flush();
+  const double v[2] = { (double) mditer, time };
+  put_record("step",v,2);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ObservableLog::flush(void)
+{
+  if ( os_.is_open() && !buf_.empty() )
+  {
+    os_.write(buf_.data(),buf_.size());
+    os_.flush();
+  }
+  buf_.clear();
+  tflush_ = MPI_Wtime();
+}
@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// ObservableLog.h
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#ifndef OBSERVABLELOG_H
+#define OBSERVABLELOG_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <math/d3vector.h>
+using namespace std;
+
+// Binary stream of the observables of each TD/MD step (observable_log),
+// written by the output task only. Layout, native byte order:
+//   char[16] "qbox-obs-1"
+//   int32 0x01020304 (byte order mark), int32 0
+//   records: int32 id, int32 n
+//     n >= 0: n doubles, the values of column id
+//     n < 0:  definition of column id, followed by its name (-n chars)
+// Every step starts with the column "step" holding mditer and time. A
+// column is defined before its first value and may have a different
+// number of values in each step. A run appending to an existing log
+// defines its columns again; a definition replaces the earlier one.
+// Records are buffered in memory and written every flush_interval seconds.
+// qbox_scripts/qbox_observables prints selected columns as a table.
+class ObservableLog
+{
+  private:
+
+  string filename_;
+  ofstream os_;
+  string buf_;
+  map<string,int> id_;
+  double flush_interval_;
+  double tflush_;
+
+  void put_record(const string& name, const double* v, int n);
+
+  public:
+
+  const string& filename(void) const { return filename_; }
+  void begin_step(int mditer, double time);
+  void add(const string& name, const double* v, int n)
+  { put_record(name,v,n); }
+  void add(const string& name, double v) { put_record(name,&v,1); }
+  void add(const string& name, const D3vector& v)
+  {
+    const double w[3] = { v.x, v.y, v.z };
+    put_record(name,w,3);
+  }
+  void add(const string& name, const vector<double>& v)
+  { put_record(name,v.empty() ? 0 : &v[0],v.size()); }
+  void flush(void);
+
+  ObservableLog(const string& filename, double flush_interval);
+  ~ObservableLog(void);
+};
+#endif
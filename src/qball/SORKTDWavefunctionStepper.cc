@@ -54,7 +54,8 @@ SORKTDWavefunctionStepper::SORKTDWavefunctionStepper(Wavefunction& wf, double td
 ////////////////////////////////////////////////////////////////////////////////
 void SORKTDWavefunctionStepper::update(Wavefunction& dwf)
 {
-  wf_ = (*(*wfdeque_)[2]);
+  // (*wfdeque_)[0] contains |psi(t)> and dwf H[psi(t)+0.5*k_1] |psi(t)+0.5*k_1>
+  wf_ = (*(*wfdeque_)[0]);
 
   for ( int ispin = 0; ispin < wf_.nspin(); ispin++ )
   {
@@ -62,14 +63,11 @@ void SORKTDWavefunctionStepper::update(Wavefunction& dwf)
     {
       tmap_["sd_update_wf"].start();
 
-      (wf_.sd(ispin,ikp)->c()).axpy( 1.0, (*(*wfdeque_)[1]).sd(ispin,ikp)->c() );
+      // AS: here we turn dwf into k_2
+      (dwf.sd(ispin,ikp)->c()) *= -1.0*tddt_*(complex<double>(0,1));
+      (wf_.sd(ispin,ikp)->c()).axpy( 1.0, dwf.sd(ispin,ikp)->c() );
 
       tmap_["sd_update_wf"].stop();
     }
   }
-
-  // AS: trash the old deque
-  (*wfdeque_).pop_front();
-  (*wfdeque_).pop_front();
-  (*wfdeque_).pop_front();
 }
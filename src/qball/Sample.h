@@ -36,6 +36,9 @@
 #include "Control.h"
 #include "ConstraintSet.h"
 #include "SymmetrySet.h"
+#include "TDState.h"
+#include "AsyncFileWriter.h"
+#include "ObservableLog.h"
 #include <vector>
 #include <complex>
 
@@ -66,10 +69,22 @@ class Sample {
   Control ctrl;
   SymmetrySet symmetries;
   vector<vector<complex<double> > > rhog_last; // previous charge density (to avoid discontinuity in restart)
+  TDState* tdstate; // propagator history read with a checkpoint, used by the next run
+  AsyncFileWriter* ckpt_writer; // background writes of checkpoints (save_async ON)
+  ObservableLog* obslog; // observable_log, only on the output task
 
  Sample(const Context& ctxt) : ctxt_(ctxt), atoms(ctxt), constraints(ctxt), wf(ctxt), hamil_wf(0), wfv(0),
-      symmetries(ctxt) { ctrl.sigmas = 0.5; ctrl.facs = 2.0; }
-  ~Sample(void) { delete wfv; }
+      symmetries(ctxt), tdstate(0), ckpt_writer(0), obslog(0) { ctrl.sigmas = 0.5; ctrl.facs = 2.0; }
+  ~Sample(void) { delete obslog; delete ckpt_writer; delete wfv; delete tdstate; }
+  // wait until the checkpoint files written in the background by all
+  // tasks are complete. ckpt_writer may only exist on some tasks (e.g.
+  // the output task for cube files): collective over ctxt_
+  void wait_for_checkpoints(void)
+  {
+    if ( ckpt_writer != 0 )
+      ckpt_writer->wait();
+    ctxt_.barrier();
+  }
   void reset(void)
   {
     atoms.reset();
@@ -77,6 +92,8 @@ class Sample {
     //extforces.reset();
     wf.reset();
     delete wfv;
+    delete tdstate;
+    tdstate = 0;
   }
 
 };
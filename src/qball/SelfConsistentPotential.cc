@@ -30,9 +30,12 @@
 
 #include "SelfConsistentPotential.h"
 #include "EnergyFunctional.h"
+#include "TDState.h"
 #include <complex>
 #include <vector>
 #include <cassert>
+#include <cmath>
+#include <algorithm>
 using namespace std;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -71,3 +74,96 @@ void SelfConsistentPotential::extrapolate(const std::vector<SelfConsistentPotent
    exc_ = 3.0*previous[2].exc_ - 3.0*previous[1].exc_ + 1.0*previous[0].exc_;
    esr_ = 3.0*previous[2].esr_ - 3.0*previous[1].esr_ + 1.0*previous[0].esr_;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+void SelfConsistentPotential::combine(const std::vector<SelfConsistentPotential> & previous, const double * coef)
+{
+   const int n = previous.size();
+   assert(n > 0);
+
+   v_r.resize(previous[0].v_r.size());
+   for(int ispin = 0; ispin < v_r.size(); ispin++)
+   {
+      v_r[ispin].resize(previous[0].v_r[ispin].size());
+      for(int ir = 0; ir < v_r[ispin].size(); ir++)
+      {
+         v_r[ispin][ir] = 0.0;
+         for(int k = 0; k < n; k++)
+            v_r[ispin][ir] += coef[k]*previous[k].v_r[ispin][ir];
+      }
+   }
+
+   hamil_rhoelg.resize(previous[0].hamil_rhoelg.size());
+   for(int ig = 0; ig < hamil_rhoelg.size(); ig++)
+   {
+      hamil_rhoelg[ig] = 0.0;
+      for(int k = 0; k < n; k++)
+         hamil_rhoelg[ig] += coef[k]*previous[k].hamil_rhoelg[ig];
+   }
+
+   rhoelg.resize(previous[0].rhoelg.size());
+   for(int ig = 0; ig < rhoelg.size(); ig++)
+   {
+      rhoelg[ig] = 0.0;
+      for(int k = 0; k < n; k++)
+         rhoelg[ig] += coef[k]*previous[k].rhoelg[ig];
+   }
+
+   eps_ = 0.0;
+   ehart_ = 0.0;
+   exc_ = 0.0;
+   esr_ = 0.0;
+   for(int k = 0; k < n; k++)
+   {
+      eps_ += coef[k]*previous[k].eps_;
+      ehart_ += coef[k]*previous[k].ehart_;
+      exc_ += coef[k]*previous[k].exc_;
+      esr_ += coef[k]*previous[k].esr_;
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double SelfConsistentPotential::max_difference(const SelfConsistentPotential & other) const
+{
+   assert(v_r.size() == other.v_r.size());
+
+   double dv = 0.0;
+   for(int ispin = 0; ispin < v_r.size(); ispin++)
+   {
+      assert(v_r[ispin].size() == other.v_r[ispin].size());
+      for(int ir = 0; ir < v_r[ispin].size(); ir++)
+         dv = max(dv, fabs(v_r[ispin][ir] - other.v_r[ispin][ir]));
+   }
+   return dv;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SelfConsistentPotential::write(std::ostream& os) const
+{
+   const int nspin = v_r.size();
+   TDState::put(os,nspin);
+   for(int ispin = 0; ispin < nspin; ispin++)
+      TDState::put_vector(os,v_r[ispin]);
+   TDState::put_vector(os,hamil_rhoelg);
+   TDState::put_vector(os,rhoelg);
+   TDState::put(os,eps_);
+   TDState::put(os,ehart_);
+   TDState::put(os,exc_);
+   TDState::put(os,esr_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SelfConsistentPotential::read(std::istream& is)
+{
+   int nspin;
+   TDState::get(is,nspin);
+   v_r.resize(nspin);
+   for(int ispin = 0; ispin < nspin; ispin++)
+      TDState::get_vector(is,v_r[ispin]);
+   TDState::get_vector(is,hamil_rhoelg);
+   TDState::get_vector(is,rhoelg);
+   TDState::get(is,eps_);
+   TDState::get(is,ehart_);
+   TDState::get(is,exc_);
+   TDState::get(is,esr_);
+}
@@ -36,6 +36,7 @@
 #include <valarray>
 #include <map>
 #include <string>
+#include <iostream>
 using namespace std;
 
 class EnergyFunctional;
@@ -48,6 +49,13 @@ class SelfConsistentPotential
    SelfConsistentPotential(const EnergyFunctional& ef);
    ~SelfConsistentPotential() {};
    void extrapolate(const std::vector<SelfConsistentPotential> & previous);
+   // linear combination sum_k coef[k] * previous[k]
+   void combine(const std::vector<SelfConsistentPotential> & previous, const double * coef);
+   // largest local change of the potential v_r with respect to other
+   double max_difference(const SelfConsistentPotential & other) const;
+   // binary dump of the local data, used in TD restart records
+   void write(std::ostream& os) const;
+   void read(std::istream& is);
    
   private:
 
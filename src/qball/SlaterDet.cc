@@ -3022,19 +3022,14 @@ void SlaterDet::print(ostream& os, string encoding) {
         #if AIX
         xcdr.byteswap_double(ft.np012(),&wftmpr[0]);
         #endif
-        int nbytes = ft.np012()*sizeof(double);
-        int outlen = xcdr.nchars(nbytes);
-        char* b = new char[outlen];
-        assert(b!=0);
-        xcdr.encode(nbytes,(my_byte*) &wftmpr[0],b);
+        size_t nbytes = ft.np012()*sizeof(double);
         // Note: optional x0,y0,z0 attributes not used, default is zero
         os << "<grid_function type=\"double\""
            << " nx=\"" << ft.np0()
            << "\" ny=\"" << ft.np1() << "\" nz=\"" << ft.np2() << "\""
            << " encoding=\"base64\">" << endl;
-        xcdr.print(outlen,(char*) b, os);
+        xcdr.encode(nbytes,(my_byte*) &wftmpr[0],os);
         os << "</grid_function>\n";
-        delete [] b;
       }
       else {
         // encoding == "text" or unknown encoding
@@ -3282,11 +3277,7 @@ void SlaterDet::write(SharedFilePtr& sfp, string encoding, double weight, int is
       #ifdef WORDS_BIGENDIAN
           xcdr.byteswap_double(tmpr_size,&tmpr[0]);
       #endif
-          int nbytes = tmpr_size*sizeof(double);
-          int outlen = xcdr.nchars(nbytes);
-          char* b = new char[outlen];
-          assert(b!=0);
-          xcdr.encode(nbytes,(my_byte*) &tmpr[0],b);
+          size_t nbytes = tmpr_size*sizeof(double);
           // Note: optional x0,y0,z0 attributes not used, default is zero
           if ( ctxt_.myrow() == 0 )
             {
@@ -3296,10 +3287,9 @@ void SlaterDet::write(SharedFilePtr& sfp, string encoding, double weight, int is
                    << "\" ny=\"" << ft.np1() << "\" nz=\"" << ft.np2() << "\""
                    << " encoding=\"base64\">" << endl;
             }
-          xcdr.print(outlen,(char*) b, ostr);
+          xcdr.encode(nbytes,(my_byte*) &tmpr[0],ostr);
           if ( ctxt_.myrow() == lastproc )
             ostr << "</grid_function>\n";
-          delete [] b;
         }
       else
         {
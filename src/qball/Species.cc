@@ -32,6 +32,7 @@
 #include "Species.h"
 #include "sinft.h"
 #include "SphericalIntegration.h"
+#include "SpeciesCache.h"
 #include <cmath>
 #include <cassert>
 #include <string>
@@ -76,6 +77,20 @@ bool Species::initialize(double rcpsval)
   // initialize the Species
   rcps_ = rcpsval;
 
+  // reuse a previous initialization with the same input and rcps
+  unsigned long long cache_key = 0;
+  if ( !cache_dir_.empty() )
+  {
+    cache_key = SpeciesCache::key(*this);
+    if ( SpeciesCache::load(*this,cache_dir_,cache_key) )
+    {
+      if (ctxt_.oncoutpe())
+        cout << "<!-- Species " << name_ << ": loaded from species_cache "
+             << cache_dir_ << " -->" << endl;
+      return true;
+    }
+  }
+
   assert(description_ != "undefined");
   
   const double fpi = 4.0 * M_PI;
@@ -668,6 +683,13 @@ bool Species::initialize(double rcpsval)
       }
     }
   }
+
+  if ( !cache_dir_.empty() && ctxt_.oncoutpe() )
+  {
+    if ( !SpeciesCache::save(*this,cache_dir_,cache_key) )
+      cout << "<WARNING> Species " << name_ << ": cannot write species_cache "
+           << cache_dir_ << " </WARNING>" << endl;
+  }
   return true;
 }
 ////////////////////////////////////////////////////////////////////////////////
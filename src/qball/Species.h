@@ -58,6 +58,7 @@ class Species {
   vector<double> rps_;  // radial linear mesh (same for all l)
   
   string name_;         // name used to refer to species in current application
+  string cache_dir_;    // species_cache directory, empty if not used
   string uri_;          // uri of the resource defining the pseudopotential
 
   string symbol_;
@@ -198,12 +199,14 @@ class Species {
   const vector<vector<double> >& vps(void) const { return vps_; }
   const vector<vector<double> >& phi(void) const { return phi_; }
   
+  void set_cache_dir(const string& dir) { cache_dir_ = dir; }
   bool initialize(double rcps);
   void info(ostream& os);
   void printsys(ostream& os) const;
   
   friend class SpeciesReader;
   friend class SpeciesHandler;
+  friend class SpeciesCache;
   
 };
 ostream& operator << ( ostream &os, Species &a );
@@ -0,0 +1,327 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// SpeciesCache.cc
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#include "SpeciesCache.h"
+#include "Species.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace
+{
+const char magic[16] = "qbox-species-1";
+// bump when the layout of serialize changes, so that old entries are
+// ignored instead of misread
+const int cache_version = 1;
+
+struct CacheHeader
+{
+  char magic[16];
+  unsigned long long key;
+  unsigned long long size;
+  unsigned long long checksum;
+};
+
+// FNV-1a 64 bit hash
+unsigned long long fnv1a(const char* p, size_t n,
+                         unsigned long long h = 14695981039346656037ULL)
+{
+  for ( size_t i = 0; i < n; i++ )
+  {
+    h ^= (unsigned char) p[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+// serialization archives: Packer appends to a buffer, Unpacker reads from
+// a (memory-mapped) buffer and turns ok() false on truncated data
+class Packer
+{
+  public:
+  vector<char> buf;
+  bool ok(void) const { return true; }
+  void bytes(void* p, size_t n)
+  {
+    const char* c = (const char*) p;
+    buf.insert(buf.end(),c,c+n);
+  }
+  bool count(int n) const { return true; }
+};
+
+class Unpacker
+{
+  const char* p_;
+  const char* end_;
+  bool ok_;
+  public:
+  Unpacker(const char* p, size_t n) : p_(p), end_(p+n), ok_(true) {}
+  bool ok(void) const { return ok_; }
+  bool done(void) const { return ok_ && p_ == end_; }
+  void bytes(void* p, size_t n)
+  {
+    if ( !ok_ || (size_t)(end_-p_) < n )
+    {
+      ok_ = false;
+      return;
+    }
+    memcpy(p,p_,n);
+    p_ += n;
+  }
+  // each element takes at least one byte, reject counts that cannot fit
+  bool count(int n)
+  {
+    if ( n < 0 || n > end_-p_ ) ok_ = false;
+    return ok_;
+  }
+};
+
+template <class Ar> void io(Ar& ar, int& x) { ar.bytes(&x,sizeof(x)); }
+template <class Ar> void io(Ar& ar, double& x) { ar.bytes(&x,sizeof(x)); }
+template <class Ar> void io(Ar& ar, bool& x)
+{
+  char c = x;
+  ar.bytes(&c,1);
+  x = c;
+}
+
+template <class Ar> void io(Ar& ar, string& s)
+{
+  int n = s.size();
+  io(ar,n);
+  if ( !ar.count(n) ) return;
+  s.resize(n);
+  if ( n > 0 ) ar.bytes(&s[0],n);
+}
+
+// vectors of plain numbers are stored in one block
+template <class Ar, class T> void io_block(Ar& ar, vector<T>& v)
+{
+  int n = v.size();
+  io(ar,n);
+  if ( !ar.count(n) ) return;
+  v.resize(n);
+  if ( n > 0 ) ar.bytes(&v[0],n*sizeof(T));
+}
+template <class Ar> void io(Ar& ar, vector<double>& v) { io_block(ar,v); }
+template <class Ar> void io(Ar& ar, vector<int>& v) { io_block(ar,v); }
+
+template <class Ar> void io(Ar& ar, Spline& s)
+{
+  vector<double> x = s.x(), y = s.y(), y2 = s.y2();
+  io(ar,x);
+  io(ar,y);
+  io(ar,y2);
+  if ( ar.ok() ) s.set(x,y,y2);
+}
+
+template <class Ar, class T> void io(Ar& ar, vector<T>& v)
+{
+  int n = v.size();
+  io(ar,n);
+  if ( !ar.count(n) ) return;
+  v.resize(n);
+  for ( int i = 0; i < n && ar.ok(); i++ )
+    io(ar,v[i]);
+}
+
+string cache_file(const Species& sp, const string& dir,
+                  unsigned long long key)
+{
+  char hex[17];
+  snprintf(hex,sizeof(hex),"%016llx",key);
+  return dir + "/" + sp.symbol() + "." + hex + ".spc";
+}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// all members of Species that are read from the pseudopotential file or
+// computed by Species::initialize, in file order
+template <class Ar>
+void SpeciesCache::serialize(Ar& ar, Species& sp)
+{
+  io(ar,sp.symbol_);
+  io(ar,sp.description_);
+  io(ar,sp.atomic_number_);
+  io(ar,sp.mass_);
+  io(ar,sp.zval_);
+  io(ar,sp.lmax_);
+  io(ar,sp.llocal_);
+  io(ar,sp.nquad_);
+  io(ar,sp.rquad_);
+  io(ar,sp.deltar_);
+  io(ar,sp.rcps_);
+  io(ar,sp.initsize_);
+  io(ar,sp.nlm_);
+  io(ar,sp.ndft_);
+  io(ar,sp.hubbard_u_);
+  io(ar,sp.hubbard_l_);
+  io(ar,sp.hubbard_alpha_);
+  io(ar,sp.nlcc_);
+  io(ar,sp.oncv_);
+  io(ar,sp.nchannels_);
+  io(ar,sp.usoft_);
+  io(ar,sp.nbeta_);
+  io(ar,sp.nbetalm_);
+  io(ar,sp.betalmax_);
+  io(ar,sp.nqfun_);
+  io(ar,sp.betarsize_);
+  io(ar,sp.nqtot_);
+
+  io(ar,sp.rps_);
+  io(ar,sp.vps_);
+  io(ar,sp.phi_);
+  io(ar,sp.vloc_);
+  io(ar,sp.projectors_);
+  io(ar,sp.dij_);
+  io(ar,sp.potentials_r_);
+  io(ar,sp.orbitals_r_);
+  io(ar,sp.gspl_);
+  io(ar,sp.local_potential_g_);
+  io(ar,sp.projectors_g_);
+  io(ar,sp.wsg_);
+  io(ar,sp.phir_);
+  io(ar,sp.phig_);
+  io(ar,sp.phig_spl_);
+  io(ar,sp.rhor_nlcc_);
+  io(ar,sp.rhog_nlcc_);
+  io(ar,sp.rhog_nlcc_spl_);
+
+  io(ar,sp.betalm_l_);
+  io(ar,sp.betalm_m_);
+  io(ar,sp.betaind_);
+  io(ar,sp.dzero_);
+  io(ar,sp.rinner_);
+  io(ar,sp.qfcoeff_);
+  io(ar,sp.qfunind_);
+  io(ar,sp.qfunl1_);
+  io(ar,sp.qfunl2_);
+  io(ar,sp.qfunb1_);
+  io(ar,sp.qfunb2_);
+  io(ar,sp.betal_);
+  io(ar,sp.betar_);
+  io(ar,sp.betag_);
+  io(ar,sp.betag_spl_);
+  io(ar,sp.qfunr_);
+  io(ar,sp.qfung_);
+  io(ar,sp.qfung_spl_);
+  io(ar,sp.dmat_);
+  io(ar,sp.qnm_lm1_);
+  io(ar,sp.qnm_lm2_);
+  io(ar,sp.ncgcoeff_);
+  io(ar,sp.cgcoeff_);
+  io(ar,sp.cgltot_);
+  io(ar,sp.cgmtot_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+unsigned long long SpeciesCache::key(const Species& sp)
+{
+  Packer pk;
+  int version = cache_version;
+  io(pk,version);
+  serialize(pk,const_cast<Species&>(sp));
+  return fnv1a(&pk.buf[0],pk.buf.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool SpeciesCache::load(Species& sp, const string& dir, unsigned long long key)
+{
+  const string filename = cache_file(sp,dir,key);
+  int fd = open(filename.c_str(),O_RDONLY);
+  if ( fd < 0 ) return false;
+
+  struct stat st;
+  if ( fstat(fd,&st) != 0 || st.st_size < (off_t) sizeof(CacheHeader) )
+  {
+    close(fd);
+    return false;
+  }
+  const size_t len = st.st_size;
+  void* map = mmap(0,len,PROT_READ,MAP_PRIVATE,fd,0);
+  close(fd);
+  if ( map == MAP_FAILED ) return false;
+
+  const char* p = (const char*) map;
+  CacheHeader h;
+  memcpy(&h,p,sizeof(h));
+  bool ok = memcmp(h.magic,magic,sizeof(magic)) == 0 && h.key == key &&
+            h.size == len - sizeof(h) &&
+            h.checksum == fnv1a(p+sizeof(h),h.size);
+  if ( ok )
+  {
+    // keep the current state so that a bad entry leaves sp unchanged
+    Packer saved;
+    serialize(saved,sp);
+    Unpacker up(p+sizeof(h),h.size);
+    serialize(up,sp);
+    ok = up.done();
+    if ( !ok )
+    {
+      Unpacker restore(&saved.buf[0],saved.buf.size());
+      serialize(restore,sp);
+    }
+  }
+  munmap(map,len);
+  return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool SpeciesCache::save(const Species& sp, const string& dir,
+                        unsigned long long key)
+{
+  Packer pk;
+  serialize(pk,const_cast<Species&>(sp));
+
+  CacheHeader h;
+  memset(&h,0,sizeof(h));
+  memcpy(h.magic,magic,sizeof(magic));
+  h.key = key;
+  h.size = pk.buf.size();
+  h.checksum = fnv1a(&pk.buf[0],pk.buf.size());
+
+  // write to a private name and rename, readers see all or nothing
+  const string filename = cache_file(sp,dir,key);
+  ostringstream tmp;
+  tmp << filename << ".tmp" << getpid();
+  FILE* f = fopen(tmp.str().c_str(),"wb");
+  if ( f == 0 ) return false;
+  bool ok = fwrite(&h,sizeof(h),1,f) == 1 &&
+            fwrite(&pk.buf[0],1,pk.buf.size(),f) == pk.buf.size();
+  ok = (fclose(f) == 0) && ok;
+  if ( ok ) ok = rename(tmp.str().c_str(),filename.c_str()) == 0;
+  if ( !ok ) remove(tmp.str().c_str());
+  return ok;
+}
@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// SpeciesCache.h
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#ifndef SPECIESCACHE_H
+#define SPECIESCACHE_H
+
+#include <string>
+using namespace std;
+
+class Species;
+
+// Binary cache of initialized species (species_cache). Species::initialize
+// looks for a file <dir>/<symbol>.<key>.spc, where key is a hash of the
+// pseudopotential data read from file, the Ewald width rcps and the
+// cache version. If found, the file is memory-mapped and the radial
+// meshes, splines and projectors in G space are restored from it instead
+// of being recomputed; otherwise the output task writes it after
+// initialization. Files are written to a temporary name and renamed, so a
+// reader never sees a partial file. Layout, native byte order:
+//   char[16] "qbox-species-1", uint64 key, uint64 size, uint64 checksum
+//   size bytes of Species data
+class SpeciesCache
+{
+  public:
+
+  // hash of the current state of sp, computed before initialization
+  static unsigned long long key(const Species& sp);
+  // restore sp from dir, returns false if there is no valid cache entry
+  static bool load(Species& sp, const string& dir, unsigned long long key);
+  // write the initialized sp to dir, returns false on error
+  static bool save(const Species& sp, const string& dir,
+                   unsigned long long key);
+
+  private:
+
+  template <class Ar> static void serialize(Ar& ar, Species& sp);
+};
+#endif
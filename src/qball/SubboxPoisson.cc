@@ -0,0 +1,366 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// SubboxPoisson.cc
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+#include "SubboxPoisson.h"
+#include "Basis.h"
+#include "Context.h"
+#include "FourierTransform.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+SubboxPoisson::SubboxPoisson(const Basis& vbasis, const FourierTransform& vft,
+  double alpha, double beta, double mu, double vint0, double pad) :
+  shape_(0), vbasis_(vbasis), vft_(vft), cell_(vbasis.cell()),
+  alpha_(alpha), beta_(beta), mu_(mu), pad_(pad)
+{
+  np_[0] = vft.np0();
+  np_[1] = vft.np1();
+  np_[2] = vft.np2();
+  np2_first_ = vft.np2_first();
+  np2_loc_ = vft.np2_loc();
+
+  // the isolated potential includes the G=0 limit of the erfc part,
+  // the periodic potential uses vint(0) instead
+  vg0_ = vint0;
+  if ( alpha_ != beta_ )
+    vg0_ += ( alpha_ - beta_ ) * 0.25 / ( mu_ * mu_ );
+
+  compute_ewald_expansion();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SubboxPoisson::~SubboxPoisson()
+{
+  for ( map<long long int,Shape*>::iterator i = shapes_.begin();
+        i != shapes_.end(); i++ )
+  {
+    delete (*i).second->ft;
+    delete (*i).second->basis;
+    delete (*i).second->ctxt;
+    delete (*i).second;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SubboxPoisson::compute_ewald_expansion(void)
+{
+  // Ewald sum of the periodic potential of a unit point charge in a
+  // neutralizing background, expanded to second order around the charge:
+  // phi(r) = 1/r + c0 + 0.5 * r^T h r + O(r^4)
+  const double omega = cell_.volume();
+  const double eta = sqrt(M_PI) / pow(omega,1.0/3.0);
+  const double rmax = 6.0 / eta;
+  const double gmax = 12.0 * eta;
+
+  c0_ = - 2.0 * eta / sqrt(M_PI) - M_PI / ( omega * eta * eta );
+  for ( int k = 0; k < 9; k++ )
+    h_[k] = 0.0;
+  const double hdiag = 4.0 * eta * eta * eta / ( 3.0 * sqrt(M_PI) );
+  h_[0] = h_[4] = h_[8] = hdiag;
+
+  // real space sum
+  int nr[3];
+  for ( int k = 0; k < 3; k++ )
+    nr[k] = (int) ( rmax * length(cell_.b(k)) / ( 2.0 * M_PI ) ) + 1;
+  for ( int i0 = -nr[0]; i0 <= nr[0]; i0++ )
+    for ( int i1 = -nr[1]; i1 <= nr[1]; i1++ )
+      for ( int i2 = -nr[2]; i2 <= nr[2]; i2++ )
+      {
+        if ( i0 == 0 && i1 == 0 && i2 == 0 ) continue;
+        const D3vector r = i0 * cell_.a(0) + i1 * cell_.a(1) + i2 * cell_.a(2);
+        const double rl = length(r);
+        if ( rl > rmax ) continue;
+        const double erfc_r = erfc(eta*rl);
+        const double gauss = 2.0 * eta / sqrt(M_PI) * exp(-eta*eta*rl*rl);
+        // f(r) = erfc(eta*r)/r and its radial derivatives
+        const double f = erfc_r / rl;
+        const double f1 = - gauss / rl - erfc_r / ( rl * rl );
+        const double f2 = gauss * ( 2.0 * eta * eta + 2.0 / ( rl * rl ) ) +
+                          2.0 * erfc_r / ( rl * rl * rl );
+        c0_ += f;
+        const double x[3] = { r.x, r.y, r.z };
+        for ( int a = 0; a < 3; a++ )
+          for ( int b = 0; b < 3; b++ )
+          {
+            const double xx = x[a] * x[b] / ( rl * rl );
+            const double d = ( a == b ) ? 1.0 : 0.0;
+            h_[3*a+b] += f2 * xx + f1 * ( d - xx ) / rl;
+          }
+      }
+
+  // reciprocal space sum
+  int ng[3];
+  for ( int k = 0; k < 3; k++ )
+    ng[k] = (int) ( gmax * length(cell_.a(k)) / ( 2.0 * M_PI ) ) + 1;
+  const double fac = 4.0 * M_PI / omega;
+  for ( int i0 = -ng[0]; i0 <= ng[0]; i0++ )
+    for ( int i1 = -ng[1]; i1 <= ng[1]; i1++ )
+      for ( int i2 = -ng[2]; i2 <= ng[2]; i2++ )
+      {
+        if ( i0 == 0 && i1 == 0 && i2 == 0 ) continue;
+        const D3vector g = i0 * cell_.b(0) + i1 * cell_.b(1) + i2 * cell_.b(2);
+        const double g2 = norm(g);
+        if ( g2 > gmax * gmax ) continue;
+        const double t = fac * exp( -0.25 * g2 / ( eta * eta ) ) / g2;
+        c0_ += t;
+        const double x[3] = { g.x, g.y, g.z };
+        for ( int a = 0; a < 3; a++ )
+          for ( int b = 0; b < 3; b++ )
+            h_[3*a+b] -= t * x[a] * x[b];
+      }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SubboxPoisson::Shape* SubboxPoisson::shape(const int n[3])
+{
+  const long long int key = ( (long long int) n[0] * 65536 + n[1] ) * 65536
+                            + n[2];
+  map<long long int,Shape*>::iterator it = shapes_.find(key);
+  if ( it != shapes_.end() )
+    return (*it).second;
+
+  Shape* sh = new Shape;
+  for ( int k = 0; k < 3; k++ )
+    sh->n[k] = n[k];
+
+  // sub-box cell with the same grid spacing as the full grid
+  const D3vector a0 = cell_.a(0) * ( ( (double) n[0] ) / np_[0] );
+  const D3vector a1 = cell_.a(1) * ( ( (double) n[1] ) / np_[1] );
+  const D3vector a2 = cell_.a(2) * ( ( (double) n[2] ) / np_[2] );
+  UnitCell subcell(a0,a1,a2);
+  sh->omega = subcell.volume();
+
+  // each task solves the same sub-box problem: single task context
+  sh->ctxt = new Context(MPI_COMM_SELF,1,1);
+  // complex basis at gamma, as for the full grid pair densities
+  sh->basis = new Basis(*sh->ctxt,D3vector(0.00000001,0.00000001,0.00000001));
+  sh->basis->resize(subcell,subcell,vbasis_.ecut());
+  for ( int k = 0; k < 3; k++ )
+    assert(sh->basis->np(k) <= n[k]);
+  sh->ft = new FourierTransform(*sh->basis,n[0],n[1],n[2]);
+
+  // truncated interaction kernel. The truncation radius is half of the
+  // smallest width of the box so that the density and its images do not
+  // interact.
+  double rc = 0.0;
+  for ( int k = 0; k < 3; k++ )
+  {
+    const double width = 2.0 * M_PI / length(subcell.b(k));
+    rc = ( k == 0 ) ? 0.5 * width : min(rc,0.5*width);
+  }
+  const int ngloc = sh->basis->localsize();
+  const double *g2 = sh->basis->g2_ptr();
+  sh->kernel.resize(ngloc);
+  for ( int ig = 0; ig < ngloc; ig++ )
+  {
+    double v = 0.0;
+    if ( g2[ig] == 0.0 )
+    {
+      v = alpha_ * 0.5 * rc * rc;
+      if ( alpha_ != beta_ )
+        v -= ( alpha_ - beta_ ) * 0.25 / ( mu_ * mu_ );
+    }
+    else
+    {
+      const double g = sqrt(g2[ig]);
+      v = alpha_ * ( 1.0 - cos(g*rc) ) / g2[ig];
+      if ( alpha_ != beta_ )
+        v -= ( alpha_ - beta_ ) *
+             ( 1.0 - exp( -0.25 * g2[ig] / ( mu_ * mu_ ) ) ) / g2[ig];
+    }
+    sh->kernel[ig] = v;
+  }
+
+  shapes_[key] = sh;
+  return sh;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool SubboxPoisson::setup(const D3vector& r0, double radius)
+{
+  // the box must hold the density (diameter 2r) and the truncation
+  // sphere of the kernel (radius 2r) in every direction
+  const double r = radius + pad_;
+  int n[3];
+  for ( int k = 0; k < 3; k++ )
+  {
+    const double width = 2.0 * M_PI / length(cell_.b(k));
+    const double h = width / np_[k];
+    n[k] = 2 * ( (int) ceil( 2.0 * r / h ) );
+    while ( !vbasis_.factorizable(n[k]) ) n[k] += 2;
+    if ( n[k] >= np_[k] )
+      return false;
+  }
+  shape_ = shape(n);
+
+  // box origin on the full grid, box centered on r0
+  D3vector s = cell_.cart_to_crystal(r0);
+  s.x -= floor(s.x);
+  s.y -= floor(s.y);
+  s.z -= floor(s.z);
+  scenter_ = s;
+  origin_[0] = (int) floor( s.x * np_[0] + 0.5 ) - n[0] / 2;
+  origin_[1] = (int) floor( s.y * np_[1] + 0.5 ) - n[1] / 2;
+  origin_[2] = (int) floor( s.z * np_[2] + 0.5 ) - n[2] / 2;
+
+  // local points of the box
+  iloc_.clear();
+  ibox_.clear();
+  for ( int c = 0; c < n[2]; c++ )
+  {
+    int k = ( origin_[2] + c ) % np_[2];
+    if ( k < 0 ) k += np_[2];
+    if ( k < np2_first_ || k >= np2_first_ + np2_loc_ ) continue;
+    for ( int b = 0; b < n[1]; b++ )
+    {
+      int j = ( origin_[1] + b ) % np_[1];
+      if ( j < 0 ) j += np_[1];
+      for ( int a = 0; a < n[0]; a++ )
+      {
+        int i = ( origin_[0] + a ) % np_[0];
+        if ( i < 0 ) i += np_[0];
+        iloc_.push_back( i + np_[0] * ( j + np_[1] * ( k - np2_first_ ) ) );
+        ibox_.push_back( a + n[0] * ( b + n[1] * c ) );
+      }
+    }
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+D3vector SubboxPoisson::position(int ibox) const
+{
+  // position of box point ibox relative to the box center
+  const int* n = shape_->n;
+  const int a = ibox % n[0];
+  const int b = ( ibox / n[0] ) % n[1];
+  const int c = ( ibox / n[0] ) / n[1];
+  const D3vector s( ( (double) ( origin_[0] + a ) ) / np_[0] - scenter_.x,
+                    ( (double) ( origin_[1] + b ) ) / np_[1] - scenter_.y,
+                    ( (double) ( origin_[2] + c ) ) / np_[2] - scenter_.z );
+  return cell_.crystal_to_cart(s);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double SubboxPoisson::solve(const complex<double>* rloc,
+  complex<double>* vloc)
+{
+  assert(shape_ != 0);
+  const int* n = shape_->n;
+  const int n012 = n[0] * n[1] * n[2];
+  const int nloc = iloc_.size();
+
+  // gather the density on the box from all tasks of the grid
+  rbox_.assign(n012,0.0);
+  for ( int k = 0; k < nloc; k++ )
+    rbox_[ibox_[k]] = rloc[k];
+  MPI_Allreduce(MPI_IN_PLACE,(double*) &rbox_[0],2*n012,MPI_DOUBLE,MPI_SUM,
+                vft_.comm());
+
+  // multipoles of the density relative to the box center
+  const double omega = cell_.volume();
+  const double dv = omega / ( ((double) np_[0]) * np_[1] * np_[2] );
+  complex<double> q = 0.0;
+  complex<double> p[3] = { 0.0, 0.0, 0.0 };
+  complex<double> m[9];
+  for ( int k = 0; k < 9; k++ )
+    m[k] = 0.0;
+  if ( alpha_ != 0.0 || vg0_ != 0.0 )
+  {
+    for ( int ib = 0; ib < n012; ib++ )
+    {
+      const complex<double> rho = rbox_[ib] * dv;
+      if ( rho == 0.0 ) continue;
+      const D3vector r = position(ib);
+      const double x[3] = { r.x, r.y, r.z };
+      q += rho;
+      for ( int a = 0; a < 3; a++ )
+      {
+        p[a] += rho * x[a];
+        for ( int b = 0; b < 3; b++ )
+          m[3*a+b] += rho * x[a] * x[b];
+      }
+    }
+  }
+
+  // isolated potential
+  const int ngloc = shape_->basis->localsize();
+  rhog_.resize(ngloc);
+  shape_->ft->forward(&rbox_[0],&rhog_[0]);
+  double ex = 0.0;
+  for ( int ig = 0; ig < ngloc; ig++ )
+  {
+    ex += norm(rhog_[ig]) * shape_->kernel[ig];
+    rhog_[ig] *= shape_->kernel[ig];
+  }
+  ex *= shape_->omega / omega;
+  shape_->ft->backward(&rhog_[0],&rbox_[0]);
+
+  // periodic correction from the multipoles of the density
+  complex<double> hp[3], trhm = 0.0;
+  for ( int a = 0; a < 3; a++ )
+  {
+    hp[a] = 0.0;
+    for ( int b = 0; b < 3; b++ )
+    {
+      hp[a] += h_[3*a+b] * p[b];
+      trhm += h_[3*a+b] * m[3*b+a];
+    }
+  }
+  const double fac = alpha_ / ( 4.0 * M_PI );
+  const complex<double> v0 = fac * ( c0_ * q + 0.5 * trhm ) + vg0_ * q / omega;
+  for ( int k = 0; k < nloc; k++ )
+  {
+    const D3vector r = position(ibox_[k]);
+    const double x[3] = { r.x, r.y, r.z };
+    complex<double> xhx = 0.0, xhp = 0.0;
+    for ( int a = 0; a < 3; a++ )
+    {
+      xhp += x[a] * hp[a];
+      for ( int b = 0; b < 3; b++ )
+        xhx += x[a] * h_[3*a+b] * x[b];
+    }
+    vloc[k] = rbox_[ibox_[k]] + v0 + fac * ( 0.5 * q * xhx - xhp );
+  }
+
+  // energy of the correction
+  complex<double> phq = 0.0;
+  for ( int a = 0; a < 3; a++ )
+    phq += conj(p[a]) * hp[a];
+  const double w = c0_ * norm(q) + real( q * conj(trhm) ) - real(phq);
+  ex += fac * w / omega + vg0_ * norm(q) / ( omega * omega );
+
+  return ex;
+}
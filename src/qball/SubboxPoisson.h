@@ -0,0 +1,128 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// SubboxPoisson.h
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Poisson solver for localized pair densities on a sub-box of the pair
+// density grid. The pair density is gathered on a padded box centered on
+// the pair, the isolated potential is computed with a truncated interaction
+// kernel using a small serial FFT, and the difference between the periodic
+// and the isolated potential is added from the multipoles (charge, dipole,
+// second moment) of the density.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SUBBOXPOISSON_H
+#define SUBBOXPOISSON_H
+
+#include <complex>
+#include <vector>
+#include <valarray>
+#include <map>
+
+#include <math/d3vector.h>
+#include "UnitCell.h"
+
+class Basis;
+class Context;
+class FourierTransform;
+
+class SubboxPoisson
+{
+  private:
+
+  // sub-box FFT, cached by shape
+  struct Shape
+  {
+    int n[3];
+    Context* ctxt;
+    Basis* basis;
+    FourierTransform* ft;
+    std::valarray<double> kernel;
+    double omega;
+  };
+  std::map<long long int,Shape*> shapes_;
+  Shape* shape_;
+
+  const Basis& vbasis_;
+  const FourierTransform& vft_;
+  UnitCell cell_;
+
+  // interaction potential alpha*erf(mu*r)/r + beta*erfc(mu*r)/r
+  double alpha_, beta_, mu_;
+  // G=0 contribution of the periodic potential that is not present
+  // in the isolated potential
+  double vg0_;
+  // padding added to the support radius of the pair density
+  double pad_;
+
+  // expansion of the periodic Coulomb potential of a unit point charge
+  // near the origin: 1/r + c0_ + 0.5 * r^T h_ r
+  double c0_;
+  double h_[9];
+
+  // full grid size and local z slab
+  int np_[3];
+  int np2_first_, np2_loc_;
+
+  // current box: origin on the full grid, center in crystal coordinates
+  int origin_[3];
+  D3vector scenter_;
+  // local full grid points inside the box and their index in the box
+  std::vector<int> iloc_;
+  std::vector<int> ibox_;
+
+  std::vector<std::complex<double> > rbox_;
+  std::vector<std::complex<double> > rhog_;
+
+  Shape* shape(const int n[3]);
+  void compute_ewald_expansion(void);
+  D3vector position(int ibox) const;
+
+  public:
+
+  // vint0: value of the full grid interaction kernel at G=0
+  SubboxPoisson(const Basis& vbasis, const FourierTransform& vft,
+    double alpha, double beta, double mu, double vint0, double pad);
+  ~SubboxPoisson();
+
+  // set up a box around r0 containing a sphere of radius (radius + pad)
+  // return false if the box is not smaller than the full grid
+  bool setup(const D3vector& r0, double radius);
+
+  // number of local grid points in the current box and their indices
+  // in the local full grid
+  int size(void) const { return iloc_.size(); }
+  const int* iloc(void) const { return &iloc_[0]; }
+
+  // compute the potential vloc[k] at local points iloc[k] from the
+  // density rloc[k], using the same normalization as a full grid solve:
+  // v(r) = sum_G rho(G) vint(G) exp(iGr). Return sum_G |rho(G)|^2 vint(G).
+  double solve(const std::complex<double>* rloc, std::complex<double>* vloc);
+
+  int nshapes(void) const { return shapes_.size(); }
+};
+#endif
@@ -48,6 +48,7 @@
 #include "TDExchangeOperator.h"
 #include "Bisection.h"
 #include "TDMLWFTransform.h"
+#include "SubboxPoisson.h"
 
 using namespace std;
 //#define TIMING 
@@ -59,6 +60,21 @@ using namespace std;
 #define Tag_Forces 4
 #define Tag_States 5
 
+////////////////////////////////////////////////////////////////////////////////
+// use the chess board condition to optimize the distribution of work on
+// each process:
+// - if i and j have different parity, use the condition i<j
+// - if i and j have same parity, use the condition i>=j
+static inline bool pair_is_local(int iGlobI, int iGlobJ)
+{
+  int parity_i = iGlobI & 1;
+  int parity_j = iGlobJ & 1;
+  if ( parity_i == parity_j )
+    return iGlobI >= iGlobJ;
+  else
+    return iGlobI < iGlobJ;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ExchangeOperator::ExchangeOperator( Sample& s, double alpha_sx,
   double beta_sx, double mu_sx ) :
@@ -194,6 +210,40 @@ ExchangeOperator::ExchangeOperator( Sample& s, double alpha_sx,
 
   use_bisection_ = s.ctrl.btHF > 0.0;
   compute_mlwf = s.ctrl.MLWFDist > 0.0;
+  npair_computed_ = 0.0;
+  npair_total_ = 0.0;
+  npair_subbox_ = 0.0;
+
+  // sub-box Poisson solves for localized pair densities
+  subbox_ = 0;
+  if ( gamma_only_ && compute_mlwf && s.ctrl.MLWFSubbox > 0.0 )
+    subbox_ = new SubboxPoisson(*vbasis_,*vft_,alpha_sx_,beta_sx_,mu_sx_,
+                                vint(0.0),s.ctrl.MLWFSubbox);
+
+  // threaded pair loop: only used at the gamma point when the density
+  // grid of a column is not distributed. The FFTs of the threads then make
+  // no MPI call, which MPI_Init does not allow from several threads
+  nthreads_ = 1;
+  if ( gamma_only_ && vbasis_->context().size() == 1 )
+    nthreads_ = omp_get_max_threads();
+  if ( nthreads_ > 1 )
+  {
+    // FFT plans are not created concurrently: set up all transforms here
+    vft_thread_.resize(nthreads_);
+    rhor_thread_.resize(nthreads_);
+    rhog_thread_.resize(nthreads_);
+    vft_thread_[0] = vft_;
+    for ( int ith = 1; ith < nthreads_; ith++ )
+      vft_thread_[ith] = new FourierTransform(*vbasis_,np0v_,np1v_,np2v_);
+    for ( int ith = 0; ith < nthreads_; ith++ )
+    {
+      rhor_thread_[ith].resize(np012loc_);
+      rhog_thread_[ith].resize(ngloc);
+    }
+    dstatej_lock_.resize(nMaxLocalStates_);
+    for ( int i = 0; i < nMaxLocalStates_; i++ )
+      omp_init_lock(&dstatej_lock_[i]);
+  }
 
   // if only at gamma
   if ( gamma_only_ )
@@ -242,6 +292,11 @@ ExchangeOperator::~ExchangeOperator()
     delete wft_;
   }
   // delete Fourier transform and basis for pair densities
+  delete subbox_;
+  for ( int ith = 1; ith < vft_thread_.size(); ith++ )
+    delete vft_thread_[ith];
+  for ( int i = 0; i < dstatej_lock_.size(); i++ )
+    omp_destroy_lock(&dstatej_lock_[i]);
   delete vft_;
   delete vbasis_;
   if ( use_bisection_ )
@@ -341,6 +396,126 @@ void ExchangeOperator::add_stress(valarray<double>& sigma_exc)
 void ExchangeOperator::cell_moved(void)
 {
   vbasis_->resize( s_.wf.cell(),s_.wf.refcell(),4.0*s_.wf.ecut());
+  if ( subbox_ != 0 )
+  {
+    delete subbox_;
+    subbox_ = new SubboxPoisson(*vbasis_,*vft_,alpha_sx_,beta_sx_,mu_sx_,
+                                vint(0.0),s_.ctrl.MLWFSubbox);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ExchangeOperator::print_timing(void)
+{
+  for ( TimerMap::iterator i = tmap.begin(); i != tmap.end(); i++ )
+  {
+    double time = (*i).second.real();
+    double tmin = time;
+    double tmax = time;
+    gcontext_.dmin(1,1,&tmin,1);
+    gcontext_.dmax(1,1,&tmax,1);
+    uint64_t count = (*i).second.counts();
+    if ( gcontext_.mype()==0 )
+    {
+       cout << left << setw(34) << "<timing where=\"exchange\""
+            << setw(8) << " name=\""
+            << setw(15) << (*i).first << "\""
+            << " min=\"" << setprecision(3) << setw(9) << tmin << "\""
+            << " max=\"" << setprecision(3) << setw(9) << tmax << "\""
+            << " count=\"" << setw(9) << count << "\"/>"
+            << endl;
+    }
+  }
+  if ( compute_mlwf )
+  {
+    // pairs are only counted on process row 0
+    double npair[2] = { npair_computed_, npair_subbox_ };
+    gcontext_.dsum(2,1,&npair[0],2);
+    if ( gcontext_.mype()==0 )
+    {
+       cout << left << setw(34) << "<exchange_pairs where=\"exchange\""
+            << " computed=\"" << setprecision(15) << npair[0] << "\""
+            << " skipped=\"" << setprecision(15) << npair_total_ - npair[0]
+            << "\"";
+       if ( subbox_ != 0 )
+         cout << " subbox=\"" << setprecision(15) << npair[1] << "\""
+              << " subbox_shapes=\"" << subbox_->nshapes() << "\"";
+       cout << "/>" << endl;
+    }
+    // distribution of the computed pairs over the columns of row 0
+    double nmin = npair_computed_;
+    double nmax = npair_computed_;
+    gcontext_.dmin('R',1,1,&nmin,1);
+    gcontext_.dmax('R',1,1,&nmax,1);
+    if ( gcontext_.mype()==0 )
+    {
+       cout << left << setw(34) << "<exchange_pairs where=\"exchange\""
+            << " column_min=\"" << setprecision(15) << nmin << "\""
+            << " column_max=\"" << setprecision(15) << nmax << "\"/>"
+            << endl;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ExchangeOperator::assign_pairs_(TDMLWFTransform& tdmlwft,
+  const ComplexMatrix& c)
+{
+  // Distribute the screened pairs over the steps of the ring permutation.
+  // A pair (i,j) with i and j on different columns A and B can be computed
+  // either by column B at step (B-A) or by column A at step (A-B) (mod npcol).
+  // Since all columns synchronize at each step, pairs are assigned greedily
+  // to the least loaded (step,column) slot. Pairs on the same column are
+  // assigned with the chess board condition.
+  // All tasks know all Wannier centers, so the assignment is computed
+  // redundantly and needs no communication.
+  const int nst = c.n();
+  const int npcol = gcontext_.npcol();
+  vector<double> load(npcol*npcol,0.0);
+  assigned_pairs_.resize(nst);
+  for ( int i = 0; i < nst; i++ )
+    assigned_pairs_[i].clear();
+
+  for ( int i = 0; i < nst; i++ )
+  {
+    const vector<int>& nbr = tdmlwft.neighbors(i);
+    const int icol = c.pc(i);
+    for ( int k = 0; k < nbr.size(); k++ )
+    {
+      const int j = nbr[k];
+      // consider each unordered pair once
+      if ( j < i ) continue;
+      const int jcol = c.pc(j);
+      if ( icol == jcol )
+      {
+        if ( pair_is_local(i,j) )
+          assigned_pairs_[j].push_back(i);
+        else
+          assigned_pairs_[i].push_back(j);
+        load[icol] += 1.0;
+      }
+      else
+      {
+        // slot 1: j fixed on jcol, i circulating; slot 2: reverse
+        const int step1 = ( jcol - icol + npcol ) % npcol;
+        const int step2 = ( icol - jcol + npcol ) % npcol;
+        double& load1 = load[step1*npcol+jcol];
+        double& load2 = load[step2*npcol+icol];
+        if ( load1 <= load2 )
+        {
+          assigned_pairs_[j].push_back(i);
+          load1 += 1.0;
+        }
+        else
+        {
+          assigned_pairs_[i].push_back(j);
+          load2 += 1.0;
+        }
+      }
+    }
+  }
+  for ( int i = 0; i < nst; i++ )
+    sort(assigned_pairs_[i].begin(),assigned_pairs_[i].end());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -995,6 +1170,7 @@ double ExchangeOperator::compute_exchange_at_gamma_(const Wavefunction &wf,
     if ( compute_mlwf && !tddft_involved_)
     { 
       assert(s_.wf.nspin()==1); //TDMLWF pair selection only works with spin unpolarized systems
+      tmap["mlwf"].start();
       tdmlwft = new TDMLWFTransform(*wf.sd(0,0));
       SlaterDet& sd = *(wf.sd(0,0));
       tdmlwft->update();
@@ -1002,39 +1178,38 @@ double ExchangeOperator::compute_exchange_at_gamma_(const Wavefunction &wf,
 
       //if ( !tddft_involved_ )  // for non-tddft, apply transfrom so wavefxn remains in wannier gauage 
         tdmlwft->apply_transform(sd);
+      tmap["mlwf"].stop();
+      tmap["neighbors"].start();
+      tdmlwft->update_neighbors(s_.ctrl.MLWFDist);
+      assign_pairs_(*tdmlwft,sd.c());
+      tmap["neighbors"].stop();
+      // number of pairs (i,j), j<=i, without screening
+      npair_total_ += 0.5 * nst * ( nst + 1 );
         if ( oncoutpe ) {
           cout << "pair fraction: " << tdmlwft->pair_fraction(s_.ctrl.MLWFDist) << endl;
           tdmlwft->total_overlaps(s_.ctrl.MLWFDist);
-	   for ( int i = 0; i < sd.nst(); i++ )
-           {
-	    for ( int j = 0; j < sd.nst(); j++ )
-            {
-              bool overlap = tdmlwft -> overlap(s_.ctrl.MLWFDist,i,j);
-              //cout << i << " " << j << " " << overlap << " <overlap/> " << tdmlwft->distance(i,j) << " distance " <<  endl;
-            } 
-           }
         }
      }
 
     else if ( compute_mlwf )   // transform is applied with TDMLWF diagonalization for TDDFT 
     {
       assert(wfc_.nspin()==1); //TDMLWF pair selection only works with spin unpolarized systems
+      tmap["mlwf"].start();
       tdmlwft = new TDMLWFTransform(*wfc_.sd(0,0));
       SlaterDet& sd = *(wfc_.sd(0,0));
       tdmlwft->update();
       tdmlwft->compute_transform();
         //tdmlwft->apply_transform(sd);
+      tmap["mlwf"].stop();
+      tmap["neighbors"].start();
+      tdmlwft->update_neighbors(s_.ctrl.MLWFDist);
+      assign_pairs_(*tdmlwft,sd.c());
+      tmap["neighbors"].stop();
+      // number of pairs (i,j), j<=i, without screening
+      npair_total_ += 0.5 * nst * ( nst + 1 );
         if ( oncoutpe ) {
           cout << "pair fraction: " << tdmlwft->pair_fraction(s_.ctrl.MLWFDist) << endl;
           tdmlwft->total_overlaps(s_.ctrl.MLWFDist);
-           for ( int i = 0; i < sd.nst(); i++ )
-           {
-            for ( int j = 0; j < sd.nst(); j++ )
-            {
-              bool overlap = tdmlwft -> overlap(s_.ctrl.MLWFDist,i,j);
-              //cout << i << " " << j << " " << overlap << " <overlap/> " << tdmlwft->distance(i,j) << " distance " <<  endl;
-            }
-           }
         } 
     }
 
@@ -1164,57 +1339,64 @@ double ExchangeOperator::compute_exchange_at_gamma_(const Wavefunction &wf,
 
       // finish receiving occupations in occ_ki_[]
       CompleteReceivingOccupations(iRotationStep);
-      // loop over circulating states
-      for ( int i = 0; i < nStatesKpi_; i++ )
-      {
-        // original column index of circulating state i
-        int iColI = gcontext_.mycol() - iRotationStep;
-        iColI = ( iColI < 0 ) ? iColI + gcontext_.npcol() : iColI;
 
-        // global index of circulating state i
-        int iGlobI = c.jglobal(iColI,i);
+      // original column index of circulating states
+      int iColI = gcontext_.mycol() - iRotationStep;
+      iColI = ( iColI < 0 ) ? iColI + gcontext_.npcol() : iColI;
 
-        // loop over fixed states
+      tmap["pair_list"].start();
+      if ( compute_mlwf )
+      {
+        // visit only the pairs assigned to each fixed state j and keep
+        // those that belong to the circulating column iColI
+        vector<pair<int,int> > pairs;
         for ( int j = 0; j < sd.nstloc(); j++ )
         {
-          // check if there is something to compute for this pair
-          if ( occ_ki_[i]!=0.0 || occ_kj_[j]!=0.0 )
+          // global index of fixed state j
+          int iGlobJ = c.jglobal(j);
+          const vector<int>& assigned = assigned_pairs_[iGlobJ];
+          for ( int k = 0; k < assigned.size(); k++ )
           {
-            // global index of fixed state j
-            int iGlobJ = c.jglobal(j);
-        
-            // determine the overlap between those two states
-            //bool overlap_ij = ( !use_bisection_ ||
-              //bisection_[ispin]->overlap(localization_,iGlobI,iGlobJ) );
-            bool overlap_ij = ( !compute_mlwf  ||  
-	      tdmlwft -> overlap(s_.ctrl.MLWFDist,iGlobI,iGlobJ) );
-
-            // use the chess board condition to
-            // optimize the distribution of work on
-            // each process:
-            // - if i and j have different parity, use
-            // the condition i<j
-            // - if i and j have same parity, use
-            // the condition i>=j
-            int parity_i = iGlobI & 1;
-            int parity_j = iGlobJ & 1;
-            if ( parity_i == parity_j )
-            {
-              //if ( iGlobI >= iGlobJ )
-              if ( iGlobI >= iGlobJ && overlap_ij )
-              {
-                first_member_of_pair.push_back( i );
-                second_member_of_pair.push_back( j );
-                nPair++;
+            const int iGlobI = assigned[k];
+            if ( c.pc(iGlobI) != iColI )
+              continue;
+            // local index of state iGlobI in column iColI
+            const int i = c.m(iGlobI) * c.nb() + c.y(iGlobI);
+            assert(i < nStatesKpi_);
+            if ( occ_ki_[i]!=0.0 || occ_kj_[j]!=0.0 )
+              pairs.push_back(pair<int,int>(i,j));
+          }
+        }
+        // process pairs in the same order as the unscreened loop
+        sort(pairs.begin(),pairs.end());
+        for ( int k = 0; k < pairs.size(); k++ )
+        {
+          first_member_of_pair.push_back( pairs[k].first );
+          second_member_of_pair.push_back( pairs[k].second );
+          useState[pairs[k].first] = 1;
+        }
+        nPair = pairs.size();
+        if ( gcontext_.myrow() == 0 )
+          npair_computed_ += nPair;
+      }
+      else
+      {
+        // loop over circulating states
+        for ( int i = 0; i < nStatesKpi_; i++ )
+        {
+          // global index of circulating state i
+          int iGlobI = c.jglobal(iColI,i);
 
-                // circulating state i is used
-                useState[i] = 1;
-              }
-            }
-            else
+          // loop over fixed states
+          for ( int j = 0; j < sd.nstloc(); j++ )
+          {
+            // check if there is something to compute for this pair
+            if ( occ_ki_[i]!=0.0 || occ_kj_[j]!=0.0 )
             {
-              //if ( iGlobI < iGlobJ)
-              if ( iGlobI < iGlobJ && overlap_ij )
+              // global index of fixed state j
+              int iGlobJ = c.jglobal(j);
+
+              if ( pair_is_local(iGlobI,iGlobJ) )
               {
                 first_member_of_pair.push_back( i );
                 second_member_of_pair.push_back( j );
@@ -1222,11 +1404,12 @@ double ExchangeOperator::compute_exchange_at_gamma_(const Wavefunction &wf,
 
                 // circulating state i is used
                 useState[i] = 1;
-             }
+              }
             }
           }
         }
       }
+      tmap["pair_list"].stop();
       // pair list is complete
       //cout<<"This is "<< gcontext_.myrow()<<"\t" << gcontext_.mycol()<<endl;
 #ifdef LOAD_MATRIX
@@ -1237,7 +1420,9 @@ double ExchangeOperator::compute_exchange_at_gamma_(const Wavefunction &wf,
 
       // complete receiving states
       // note: this does nothing if iRotationStep == 0
+      tmap["ring_wait"].start();
       CompleteReceivingStates(iRotationStep);
+      tmap["ring_wait"].stop();
       // circulating states in state_kpi_[i+j*mloc] can now be used
       // compute real space circulating states
       if ( nPair > 0 )
@@ -1259,7 +1444,9 @@ double ExchangeOperator::compute_exchange_at_gamma_(const Wavefunction &wf,
         }
       }
       // finish sending states in send_buf_states_
+      tmap["ring_wait"].start();
       CompleteSendingStates(iRotationStep);
+      tmap["ring_wait"].stop();
       // send_buf_states_ can now be reused
 
       // copy the states to be sent in the send buffer
@@ -1276,11 +1463,117 @@ double ExchangeOperator::compute_exchange_at_gamma_(const Wavefunction &wf,
       //cout<<"This is "<< gcontext_.myrow()<<"\t" << gcontext_.mycol()<<endl;
 
       // nNextStatesKpi: number of states of next permutation step
+      tmap["ring_wait"].start();
       SetNextPermutationStateNumber();
+      tmap["ring_wait"].stop();
       // start sending states in send_buf_states_
       StartStatesPermutation(c.mloc());
       // loop over pairs 1 by 1 
-      if ( nPair > 0 )
+      tmap["pair_work"].start();
+      if ( nPair > 0 && nthreads_ > 1 && subbox_ == 0 )
+      {
+        // threaded pair loop: pairs are sorted by circulating state i and
+        // split into contiguous chunks on boundaries of i, so that each
+        // thread owns the derivatives dstatei_[i] of its pairs.
+        // Contributions to dstatej_[j] are protected by per-state locks.
+        vector<int> chunk(nthreads_+1,nPair);
+        chunk[0] = 0;
+        for ( int ith = 1; ith < nthreads_; ith++ )
+        {
+          int k = max(chunk[ith-1],(int)(((long int) nPair*ith)/nthreads_));
+          while ( k > 0 && k < nPair &&
+                  first_member_of_pair[k] == first_member_of_pair[k-1] )
+            k++;
+          chunk[ith] = k;
+        }
+
+        // per-thread partial sums of the energy and stress
+        vector<double> partial(7*nthreads_,0.0);
+#pragma omp parallel num_threads(nthreads_)
+        {
+          const int ith = omp_get_thread_num();
+          FourierTransform& ft = *vft_thread_[ith];
+          valarray<complex<double> >& rhor = rhor_thread_[ith];
+          vector<complex<double> >& rhog = rhog_thread_[ith];
+          double* psum = &partial[7*ith];
+
+          for ( int iPair = chunk[ith]; iPair < chunk[ith+1]; iPair++ )
+          {
+            const int i = first_member_of_pair[iPair];
+            const int j = second_member_of_pair[iPair];
+
+            // pair density rhor = conjg(statei_(r)) * statej_(r)
+            for ( int ip = 0; ip < np012loc_; ip++ )
+              rhor[ip] = conj(statei_[i][ip]) * statej_[j][ip];
+
+            ft.forward(&rhor[0],&rhog[0]);
+
+            double ex_sum_1 = 0.0;
+            double sigma_sum_1[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+            for ( int ig = 0; ig < ngloc; ig++ )
+            {
+              const double int_pot = vint(g2[ig]);
+              ex_sum_1 += norm(rhog[ig]) * int_pot;
+              if ( compute_stress )
+              {
+                const double fac = -2.0 * norm(rhog[ig]) * dvint(g2[ig]);
+                sigma_sum_1[0] += fac * g_x[ig] * g_x[ig];
+                sigma_sum_1[1] += fac * g_y[ig] * g_y[ig];
+                sigma_sum_1[2] += fac * g_z[ig] * g_z[ig];
+                sigma_sum_1[3] += fac * g_x[ig] * g_y[ig];
+                sigma_sum_1[4] += fac * g_y[ig] * g_z[ig];
+                sigma_sum_1[5] += fac * g_z[ig] * g_x[ig];
+              }
+              if (dwf)
+                rhog[ig] *= int_pot;
+            }
+            if (dwf)
+              ft.backward(&rhog[0],&rhor[0]);
+
+            // self pairs are counted once, other pairs twice
+            const bool self_pair = ( i==j ) && ( iRotationStep==0 );
+            const double fac1 = ( self_pair ? 0.5 : 1.0 ) *
+                                exfac * occ_ki_[i] * occ_kj_[j];
+            psum[0] += fac1 * ex_sum_1;
+            if ( compute_stress )
+            {
+              psum[1] += fac1 * (ex_sum_1 - sigma_sum_1[0]) / omega;
+              psum[2] += fac1 * (ex_sum_1 - sigma_sum_1[1]) / omega;
+              psum[3] += fac1 * (ex_sum_1 - sigma_sum_1[2]) / omega;
+              psum[4] += fac1 * ( -sigma_sum_1[3] ) / omega;
+              psum[5] += fac1 * ( -sigma_sum_1[4] ) / omega;
+              psum[6] += fac1 * ( -sigma_sum_1[5] ) / omega;
+            }
+
+            if ( dwf && self_pair )
+            {
+              const double weight = exfac * occ_kj_[j];
+              for ( int ip = 0; ip < np012loc_; ip++ )
+                dstatei_[i][ip] += statej_[j][ip] * rhor[ip] * weight;
+            }
+            else if (dwf)
+            {
+              const double weighti = exfac * occ_ki_[i];
+              const double weightj = exfac * occ_kj_[j];
+              for ( int ip = 0; ip < np012loc_; ip++ )
+                dstatei_[i][ip] += statej_[j][ip] * conj(rhor[ip]) * weightj;
+              omp_set_lock(&dstatej_lock_[j]);
+              for ( int ip = 0; ip < np012loc_; ip++ )
+                dstatej_[j][ip] += statei_[i][ip] * rhor[ip] * weighti;
+              omp_unset_lock(&dstatej_lock_[j]);
+            }
+          } // iPair
+        } // omp parallel
+
+        // reduce the per-thread partial sums
+        for ( int ith = 0; ith < nthreads_; ith++ )
+        {
+          exchange_sum += partial[7*ith];
+          for ( int k = 0; k < 6; k++ )
+            sigma_exhf_[k] += partial[7*ith+1+k];
+        }
+      }
+      else if ( nPair > 0 )
       {
         double ex_sum_1, ex_sum_2;
         double sigma_sum_1[6], sigma_sum_2[6];
@@ -1290,71 +1583,109 @@ double ExchangeOperator::compute_exchange_at_gamma_(const Wavefunction &wf,
           int i = first_member_of_pair[iPair];
           int j = second_member_of_pair[iPair];
 
-          // compute the pair densities
-          // rhor = conjg(statei_(r)) * statej_(r)
-          // note: gamma point, densities are real
+          // localized pairs: solve the Poisson equation on a sub-box
+          bool subbox_pair = false;
+          if ( subbox_ != 0 && !compute_stress )
           {
-            // rhor1_ = psi_i1 * psi_j1 + i * psi_i2 * psi_j2
-
-#pragma omp parallel for
-            for ( int ip = 0; ip < np012loc_; ip+=1 )
-            {
-              rhor1_[ip]   = conj(statei_[i][ip])* statej_[j][ip];
-            }
+            tmap["subbox"].start();
+            const int iGlobI = c.jglobal(iColI,i);
+            const int iGlobJ = c.jglobal(j);
+            const D3vector ctr_j = tdmlwft->center(iGlobJ);
+            D3vector d = tdmlwft->center(iGlobI) - ctr_j;
+            wfc_.cell().fold_in_ws(d);
+            const double radius = 0.5 * length(d) +
+              max(tdmlwft->spread(iGlobI),tdmlwft->spread(iGlobJ));
+            subbox_pair = subbox_->setup(ctr_j + 0.5 * d, radius);
+            tmap["subbox"].stop();
           }
 
-          // Fourier transform the pair density
-          vft_->forward(&rhor1_[0], &rhog1_[0] );
-
-          // compute contributions to the exchange energy and forces on wfs
-          ex_sum_1 = 0.0;
-          if ( compute_stress )
+          if ( subbox_pair )
           {
-            for ( int i = 0; i < 6; i++ )
+            tmap["subbox"].start();
+            const int nloc = subbox_->size();
+            const int* iloc = subbox_->iloc();
+            rbox_.resize(nloc);
+            vbox_.resize(nloc);
+            for ( int k = 0; k < nloc; k++ )
+              rbox_[k] = conj(statei_[i][iloc[k]]) * statej_[j][iloc[k]];
+            const double ex = subbox_->solve(&rbox_[0],&vbox_[0]);
+            // the sub-box problem is solved on all tasks of the column:
+            // count its energy once
+            ex_sum_1 = ( vbasis_->context().myrow() == 0 ) ? ex : 0.0;
+            for ( int k = 0; k < 6; k++ )
+              sigma_sum_1[k] = 0.0;
+            if ( vbasis_->context().myrow() == 0 )
+              npair_subbox_++;
+            tmap["subbox"].stop();
+          }
+          else
+          {
+            // compute the pair densities
+            // rhor = conjg(statei_(r)) * statej_(r)
+            // note: gamma point, densities are real
             {
-              sigma_sum_1[i] = 0.0;
+              // rhor1_ = psi_i1 * psi_j1 + i * psi_i2 * psi_j2
+
+#pragma omp parallel for
+              for ( int ip = 0; ip < np012loc_; ip+=1 )
+              {
+                rhor1_[ip]   = conj(statei_[i][ip])* statej_[j][ip];
+              }
             }
-          }
 
-          for ( int ig = 0; ig < ngloc; ig++ )
-          {
-            // Add the values of |rho1(G)|^2*V(|G+q1|)
-            // and |rho2(G)|^2*V(|G+q2|) to the exchange energy.
-            // factor 2.0: real basis
-            const double int_pot = vint(g2[ig]);
-            const double t1 =   norm(rhog1_[ig]) * int_pot;
-            ex_sum_1 += t1;
+            // Fourier transform the pair density
+            vft_->forward(&rhor1_[0], &rhog1_[0] );
 
+            // compute contributions to the exchange energy and forces on wfs
+            ex_sum_1 = 0.0;
             if ( compute_stress )
             {
-              // dvint(g2) = d vint(g2)/d g2
-              const double d_int_pot = dvint(g2[ig]);
-              const double tgx = g_x[ig];
-              const double tgy = g_y[ig];
-              const double tgz = g_z[ig];
-              // factor 4.0: derivative of G^2 and real basis
-              const double fac1 = -2.0 *  norm(rhog1_[ig]) * d_int_pot;
-              sigma_sum_1[0] += fac1 * tgx * tgx;
-              sigma_sum_1[1] += fac1 * tgy * tgy;
-              sigma_sum_1[2] += fac1 * tgz * tgz;
-              sigma_sum_1[3] += fac1 * tgx * tgy;
-              sigma_sum_1[4] += fac1 * tgy * tgz;
-              sigma_sum_1[5] += fac1 * tgz * tgx;
+              for ( int i = 0; i < 6; i++ )
+              {
+                sigma_sum_1[i] = 0.0;
+              }
+            }
+
+            for ( int ig = 0; ig < ngloc; ig++ )
+            {
+              // Add the values of |rho1(G)|^2*V(|G+q1|)
+              // and |rho2(G)|^2*V(|G+q2|) to the exchange energy.
+              // factor 2.0: real basis
+              const double int_pot = vint(g2[ig]);
+              const double t1 =   norm(rhog1_[ig]) * int_pot;
+              ex_sum_1 += t1;
 
+              if ( compute_stress )
+              {
+                // dvint(g2) = d vint(g2)/d g2
+                const double d_int_pot = dvint(g2[ig]);
+                const double tgx = g_x[ig];
+                const double tgy = g_y[ig];
+                const double tgz = g_z[ig];
+                // factor 4.0: derivative of G^2 and real basis
+                const double fac1 = -2.0 *  norm(rhog1_[ig]) * d_int_pot;
+                sigma_sum_1[0] += fac1 * tgx * tgx;
+                sigma_sum_1[1] += fac1 * tgy * tgy;
+                sigma_sum_1[2] += fac1 * tgz * tgz;
+                sigma_sum_1[3] += fac1 * tgx * tgy;
+                sigma_sum_1[4] += fac1 * tgy * tgz;
+                sigma_sum_1[5] += fac1 * tgz * tgx;
+
+              }
+
+              if (dwf)
+              {
+                // compute rhog1_[G]*V(G) and rhog2_[G]*V(G)
+                rhog1_[ig] *= int_pot;
+              }
             }
 
             if (dwf)
             {
-              // compute rhog1_[G]*V(G) and rhog2_[G]*V(G)
-              rhog1_[ig] *= int_pot;
+              // Backtransform rhog[G]/|q+G|^2
+              vft_->backward(&rhog1_[0],  &rhor1_[0]);
             }
           }
-
-          if (dwf)
-          {
-            // Backtransform rhog[G]/|q+G|^2
-            vft_->backward(&rhog1_[0],  &rhor1_[0]);
-          }
           // accumulate contributions to the exchange energy
           // first pair: (i1,j1)
           const double fac1 = 0.5 * exfac * occ_ki_[i] * occ_kj_[j];
@@ -1372,7 +1703,18 @@ double ExchangeOperator::compute_exchange_at_gamma_(const Wavefunction &wf,
               sigma_exhf_[5] += fac1 * ( -sigma_sum_1[5] ) / omega;
             }
 
-            if (dwf)
+            if ( dwf && subbox_pair )
+            {
+              const double weight = exfac * occ_kj_[j];
+              const int nloc = subbox_->size();
+              const int* iloc = subbox_->iloc();
+              for ( int k = 0; k < nloc; k++ )
+              {
+                const int ip = iloc[k];
+                dstatei_[i][ip] += statej_[j][ip] * vbox_[k] * weight;
+              }
+            }
+            else if (dwf)
             {
               const double weight = exfac * occ_kj_[j];
               double *pj = (double *) &statej_[j][0];
@@ -1393,7 +1735,20 @@ double ExchangeOperator::compute_exchange_at_gamma_(const Wavefunction &wf,
             sigma_exhf_[4] += 2.0 * fac1 * ( -sigma_sum_1[4] ) / omega;
             sigma_exhf_[5] += 2.0 * fac1 * ( -sigma_sum_1[5] ) / omega;
 
-            if (dwf)
+            if ( dwf && subbox_pair )
+            {
+              double weighti = exfac * occ_ki_[i];
+              double weightj = exfac * occ_kj_[j];
+              const int nloc = subbox_->size();
+              const int* iloc = subbox_->iloc();
+              for ( int k = 0; k < nloc; k++ )
+              {
+                const int ip = iloc[k];
+                dstatei_[i][ip] += statej_[j][ip] * conj(vbox_[k]) * weightj;
+                dstatej_[j][ip] += statei_[i][ip] * vbox_[k] * weighti;
+              }
+            }
+            else if (dwf)
             {
               double weighti = exfac * occ_ki_[i];
               double weightj = exfac * occ_kj_[j];
@@ -1410,13 +1765,16 @@ double ExchangeOperator::compute_exchange_at_gamma_(const Wavefunction &wf,
         } // iPair
 
       } // if nPair > 0
+      tmap["pair_work"].stop();
       // End of loop over pairs
       if (dwf)
       {
+        tmap["ring_wait"].start();
         // finish receiving forces in force_kpi_[]
         CompleteReceivingForces(iRotationStep);
         // finish sending forces in send_buf_forces_[]
         CompleteSendingForces(iRotationStep);
+        tmap["ring_wait"].stop();
 
         // add locally computed contributions to circulated forces
         {
@@ -1625,9 +1983,10 @@ double ExchangeOperator::compute_exchange_at_gamma_(const Wavefunction &wf,
   if ( compute_stress )
     gcontext_.dsum(6,1,&sigma_exhf_[0],6);
 
+  delete tdmlwft;
+
   tm.stop();
   return exchange_sum;
-  delete tdmlwft;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -30,10 +30,17 @@
 #include "SlaterDet.h"
 #include "FourierTransform.h"
 #include "Context.h"
+#include "Timer.h"
+#include <map>
+#include "omp.h"
 #ifndef TDEXCHANGEOPERATOR_H
 #define TDEXCHANGEOPERATOR_H
 
+typedef map<string,Timer> TimerMap;
+
 class Bisection;
+class SubboxPoisson;
+class TDMLWFTransform;
 class ExchangeOperator
 {
   private:
@@ -181,6 +188,33 @@ class ExchangeOperator
   vector<ComplexMatrix*> uc_;
   vector<long int> localization_;
 
+  // pair statistics of the MLWF screening
+  // npair_computed_ is counted on process row 0 only
+  double npair_computed_;
+  double npair_total_;
+  double npair_subbox_;
+
+  // screened pairs assigned to each fixed state:
+  // assigned_pairs_[j] holds the global indices i of the pairs (i,j)
+  // computed by the column of j when the states of i circulate there
+  vector<vector<int> > assigned_pairs_;
+  void assign_pairs_(TDMLWFTransform& tdmlwft, const ComplexMatrix& c);
+
+  // sub-box Poisson solver for localized pair densities
+  SubboxPoisson* subbox_;
+  vector<complex<double> > rbox_;
+  vector<complex<double> > vbox_;
+
+  // threaded pair loop: one Fourier transform and pair density buffer
+  // per thread, locks on the derivatives of the fixed states
+  int nthreads_;
+  vector<FourierTransform*> vft_thread_;
+  vector<valarray<complex<double> > > rhor_thread_;
+  vector<vector<complex<double> > > rhog_thread_;
+  vector<omp_lock_t> dstatej_lock_;
+
+  mutable TimerMap tmap;
+
   // screened interaction potential paramters
   double alpha_sx_, beta_sx_, mu_sx_;
   // interaction potential. g2 is the wave vector squared.
@@ -205,6 +239,7 @@ class ExchangeOperator
   void apply_operator(Wavefunction& dwf);
   void add_stress (std::valarray<double> & sigma_exc);
   void cell_moved(void);
+  void print_timing(void);
 };
 
 class ExchangeOperatorException
@@ -31,6 +31,7 @@
 #include <complex>
 #include <cassert>
 #include <math.h>
+#include <algorithm>
 
 #include "TDMLWFTransform.h"
 #include <math/d3vector.h>
@@ -48,7 +49,8 @@ using namespace std;
 
 ////////////////////////////////////////////////////////////////////////////////
 TDMLWFTransform::TDMLWFTransform(const SlaterDet& sd) : sd_(sd),  
-cell_(sd.basis().cell()), ctxt_(sd.context()),  bm_(BasisMapping(sd.basis())) 
+cell_(sd.basis().cell()), ctxt_(sd.context()),  bm_(BasisMapping(sd.basis())),
+neighbors_eps_(-1.0)
 {
   a_.resize(6);
   adiag_.resize(6);
@@ -225,6 +227,8 @@ void TDMLWFTransform::compute_transform(void)
   int nsweep = jade_complex(maxsweep,tol,a_,*u_,adiag_); 
   //int nsweep = jade_complex(maxsweep,tol,a_,*u_,*tmpmat_,adiag_); 
   // Joint approximate diagonalization step.
+  // centers have moved: neighbor lists must be rebuilt
+  neighbors_eps_ = -1.0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -285,58 +289,129 @@ D3vector TDMLWFTransform::center(int i)
 ////////////////////////////////////////////////////////////////////////////////
 double TDMLWFTransform::distance(int i, int j)
 {
-  // distannce between all pairs for exchange
-  D3vector distance(0.0,0.0,0.0);
+  // minimum image distance between the centers of states i and j
   assert(i>=0 && i<sd_.nst());
   assert(j>=0 && j<sd_.nst());    
-      //if (i !=j)
-     // {
-  D3vector ctr_i = center(i);
-  D3vector ctr_j = center(j);
-  //distance = center(i) - center(j);
-  //double square = distance.x*distance.x + distance.y*distance.y + distance.z*distance.z;     
-  //double square = ctr_i.x - ctr_j.x;
-  double x_dist = ctr_i.x - ctr_j.x;
-  double y_dist = ctr_i.y - ctr_j.y;
-  double z_dist = ctr_i.z - ctr_j.z; 
-  double total_dist = x_dist*x_dist + y_dist*y_dist + z_dist*z_dist;
-  double root = sqrt(total_dist);
-  return abs(root);
-  //return sqrt(square);
-     // }
+  D3vector d = center(i) - center(j);
+  cell_.fold_in_ws(d);
+  return length(d);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 bool TDMLWFTransform::overlap(double epsilon, int i, int j) 
 {
   // overlap: return true if the functions i and j overlap according to distance 
-  if ( distance(i,j) <= epsilon || distance(i,j) >= (sqrt(length(cell_.a(0))*length(cell_.a(0)) + length(cell_.a(1))*length(cell_.a(1)) + length(cell_.a(2))*length(cell_.a(2))) - epsilon)) 
- //(length(cell_.a(0)) - epsilon)) 
-      return true;  //need sqrt(a0^2 + a1^2 + a2^2) for cell diagonal distance. Diagonal dist - epsilon for pbc  
-
-  // return false if the states don't overlap
-  return false;
+  return distance(i,j) <= epsilon;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-double TDMLWFTransform::total_overlaps(double epsilon)
+void TDMLWFTransform::update_neighbors(double epsilon)
 {
-  int sum = 0;
-  for ( int i = 0; i < sd_.nst(); i++ )
+  // build the lists of states whose centers lie within epsilon of each other
+  // using a periodic cell list in crystal coordinates. Bins are at least
+  // epsilon wide in the direction normal to each pair of cell faces so that
+  // all neighbors of a center are found in the 27 surrounding bins.
+  if ( epsilon == neighbors_eps_ ) return;
+
+  const int nst = sd_.nst();
+  neighbors_.resize(nst);
+  for ( int i = 0; i < nst; i++ )
+    neighbors_[i].clear();
+
+  // centers in crystal coordinates folded into [0,1)
+  vector<D3vector> ctr(nst);
+  vector<D3vector> sctr(nst);
+  for ( int i = 0; i < nst; i++ )
+  {
+    ctr[i] = center(i);
+    D3vector s = cell_.cart_to_crystal(ctr[i]);
+    s.x -= floor(s.x);
+    s.y -= floor(s.y);
+    s.z -= floor(s.z);
+    sctr[i] = s;
+  }
+
+  int nbin[3];
+  for ( int k = 0; k < 3; k++ )
   {
-    int count = 0;
-    for ( int j = 0; j < sd_.nst(); j++ )
+    // distance between the two faces of the cell normal to b(k)
+    const double width = 2.0 * M_PI / length(cell_.b(k));
+    nbin[k] = ( epsilon > 0.0 ) ? (int) (width / epsilon) : 1;
+    nbin[k] = max(1,min(nbin[k],nst));
+  }
+
+  // bin index of each center and linked list of centers in each bin
+  vector<int> head(nbin[0]*nbin[1]*nbin[2],-1);
+  vector<int> next(nst,-1);
+  vector<int> ib(3*nst);
+  for ( int i = 0; i < nst; i++ )
+  {
+    ib[3*i]   = min((int) (sctr[i].x * nbin[0]),nbin[0]-1);
+    ib[3*i+1] = min((int) (sctr[i].y * nbin[1]),nbin[1]-1);
+    ib[3*i+2] = min((int) (sctr[i].z * nbin[2]),nbin[2]-1);
+    const int ibin = ib[3*i] + nbin[0] * ( ib[3*i+1] + nbin[1] * ib[3*i+2] );
+    next[i] = head[ibin];
+    head[ibin] = i;
+  }
+
+  // neighboring bin offsets in each direction, without duplicates
+  // when there are fewer than three bins
+  vector<int> offsets[3];
+  for ( int k = 0; k < 3; k++ )
+  {
+    if ( nbin[k] == 1 )
+      offsets[k].push_back(0);
+    else if ( nbin[k] == 2 )
     {
-      if ( overlap(epsilon,i,j) )
-        count++;
+      offsets[k].push_back(0);
+      offsets[k].push_back(1);
+    }
+    else
+    {
+      offsets[k].push_back(-1);
+      offsets[k].push_back(0);
+      offsets[k].push_back(1);
     }
-    sum += count;
   }
-       cout << "total overlaps: " << sum << " / " << sd_.nst()*sd_.nst()
+
+  const double eps2 = epsilon * epsilon;
+  for ( int i = 0; i < nst; i++ )
+  {
+    for ( int o2 = 0; o2 < offsets[2].size(); o2++ )
+    {
+      const int b2 = ( ib[3*i+2] + offsets[2][o2] + nbin[2] ) % nbin[2];
+      for ( int o1 = 0; o1 < offsets[1].size(); o1++ )
+      {
+        const int b1 = ( ib[3*i+1] + offsets[1][o1] + nbin[1] ) % nbin[1];
+        for ( int o0 = 0; o0 < offsets[0].size(); o0++ )
+        {
+          const int b0 = ( ib[3*i] + offsets[0][o0] + nbin[0] ) % nbin[0];
+          for ( int j = head[b0 + nbin[0] * ( b1 + nbin[1] * b2 )]; j >= 0;
+                j = next[j] )
+          {
+            D3vector d = ctr[i] - ctr[j];
+            cell_.fold_in_ws(d);
+            if ( norm(d) <= eps2 )
+              neighbors_[i].push_back(j);
+          }
+        }
+      }
+    }
+    sort(neighbors_[i].begin(),neighbors_[i].end());
+  }
+  neighbors_eps_ = epsilon;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double TDMLWFTransform::total_overlaps(double epsilon)
+{
+  update_neighbors(epsilon);
+  long int sum = 0;
+  for ( int i = 0; i < sd_.nst(); i++ )
+    sum += neighbors_[i].size();
+  cout << "total overlaps: " << sum << " / " << sd_.nst()*sd_.nst()
        << " = " << ((double) sum)/(sd_.nst()*sd_.nst()) << endl;
-       //cout << " Cell paramters " << " length x: " << length(cell_.a(0)) << " length y: " << length(cell_.a(1)) 
-       //<< " length z: " << length(cell_.a(2)) << endl;
-       cout << " pbc condition: " << sqrt(length(cell_.a(0))*length(cell_.a(0)) + length(cell_.a(1))*length(cell_.a(1)) + length(cell_.a(2))*length(cell_.a(2))) - epsilon << endl;
+  return (double) sum;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -344,16 +419,14 @@ double TDMLWFTransform::pair_fraction(double epsilon)
 {
   // pair_fraction: return fraction of pairs having non-zero overlap
   // count pairs (i,j) having non-zero overlap for i != j only
-  int sum = 0;
+  update_neighbors(epsilon);
+  long int sum = 0;
   for ( int i = 0; i < sd_.nst(); i++ )
   {
-    int count = 0;
-    for ( int j = i+1; j < sd_.nst() ; j++ )
-    {
-      if ( overlap(epsilon,i,j) )
-        count++;
-    }
-    sum += count;
+    const vector<int>& nbr = neighbors_[i];
+    for ( int k = 0; k < nbr.size(); k++ )
+      if ( nbr[k] > i )
+        sum++;
   }
   // add overlap with self: (i,i)
   sum += sd_.nst();
@@ -65,6 +65,11 @@ class TDMLWFTransform
             *sdcosy_, *sdsiny_,
             *sdcosz_, *sdsinz_;
 
+  // Wannier neighbor lists built with a periodic cell list over the centers
+  // neighbors_[i]: sorted global indices j with distance(i,j) <= neighbors_eps_
+  std::vector<std::vector<int> > neighbors_;
+  double neighbors_eps_;
+
   public:
   ComplexMatrix* a(int k) { return a_[k]; };
 
@@ -94,6 +99,9 @@ class TDMLWFTransform
   double pair_fraction(double epsilon) ;
   double total_overlaps(double epsilon);
 
+  void update_neighbors(double epsilon);
+  const std::vector<int>& neighbors(int i) const { return neighbors_[i]; }
+
   D3vector center(int i);
   D3vector dipole(void);
 
@@ -0,0 +1,243 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// TDState.cc
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#include "TDState.h"
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cassert>
+#if USE_MPI
+#include <mpi.h>
+#endif
+using namespace std;
+
+namespace {
+const char tdstate_magic[16] = "qbox-tdstate-02";
+const int tdstate_wfdyn_len = 16;
+const int tdstate_layout_len = 16;
+// magic, npes, layout, wf_dyn, mditer, tdstep, has_wfv, tdtime, tddt,
+// tddt_prev
+const int tdstate_header_size = 16 + sizeof(int) +
+    tdstate_layout_len*sizeof(int) + tdstate_wfdyn_len +
+    3*sizeof(int) + 3*sizeof(double);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TDState::write(const string& filename, const Context& ctxt,
+                    const vector<int>& layout) const
+{
+  int mype = 0;
+  int npes = 1;
+#if USE_MPI
+  MPI_Comm comm = ctxt.comm();
+  MPI_Comm_rank(comm,&mype);
+  MPI_Comm_size(comm,&npes);
+#endif
+  assert(layout.size() <= tdstate_layout_len);
+
+  // sizes of the local records of all tasks
+  long long int size = local.size();
+  vector<long long int> sizes(npes,size);
+#if USE_MPI
+  MPI_Allgather(&size,1,MPI_LONG_LONG,&sizes[0],1,MPI_LONG_LONG,comm);
+#endif
+
+  ostringstream hs;
+  hs.write(tdstate_magic,16);
+  put(hs,npes);
+  for ( int i = 0; i < tdstate_layout_len; i++ )
+  {
+    const int v = i < layout.size() ? layout[i] : 0;
+    put(hs,v);
+  }
+  char wfdyn[tdstate_wfdyn_len];
+  memset(wfdyn,0,tdstate_wfdyn_len);
+  strncpy(wfdyn,wf_dyn.c_str(),tdstate_wfdyn_len-1);
+  hs.write(wfdyn,tdstate_wfdyn_len);
+  put(hs,mditer);
+  put(hs,tdstep);
+  const int iwfv = has_wfv ? 1 : 0;
+  put(hs,iwfv);
+  put(hs,tdtime);
+  put(hs,tddt);
+  put(hs,tddt_prev);
+  put_vector(hs,sizes);
+  const string header = hs.str();
+
+  long long int offset = header.size();
+  for ( int i = 0; i < mype; i++ )
+    offset += sizes[i];
+
+#if USE_MPI
+  MPI_File fh;
+  int err = MPI_File_open(comm,(char*) filename.c_str(),
+                          MPI_MODE_WRONLY|MPI_MODE_CREATE,MPI_INFO_NULL,&fh);
+  if ( err != 0 )
+  {
+    if ( mype == 0 )
+      cout << "<ERROR> TDState::write: cannot open " << filename
+           << " </ERROR>" << endl;
+    return;
+  }
+  MPI_File_set_size(fh,0);
+  MPI_Status status;
+  if ( mype == 0 )
+    MPI_File_write_at(fh,0,(void*) header.data(),header.size(),MPI_CHAR,
+                      &status);
+  MPI_File_write_at_all(fh,(MPI_Offset) offset,(void*) local.data(),
+                        local.size(),MPI_CHAR,&status);
+  MPI_File_close(&fh);
+#else
+  ofstream os(filename.c_str(),ofstream::binary);
+  os.write(header.data(),header.size());
+  os.write(local.data(),local.size());
+  os.close();
+#endif
+  if ( mype == 0 )
+    cout << "<!-- TDState: propagator history written to " << filename
+         << " -->" << endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool TDState::read(const string& filename, const Context& ctxt,
+                   const vector<int>& layout)
+{
+  int mype = 0;
+  int npes = 1;
+#if USE_MPI
+  MPI_Comm comm = ctxt.comm();
+  MPI_Comm_rank(comm,&mype);
+  MPI_Comm_size(comm,&npes);
+#endif
+
+  // the fixed part of the header is read by task 0 and broadcast
+  vector<char> buf(tdstate_header_size);
+  int status = 0;
+  if ( mype == 0 )
+  {
+    ifstream is(filename.c_str(),ifstream::binary);
+    if ( is.is_open() )
+    {
+      is.read(&buf[0],tdstate_header_size);
+      if ( is.gcount() == tdstate_header_size &&
+           strncmp(&buf[0],tdstate_magic,16) == 0 )
+        status = 1;
+      else
+        status = -1;
+    }
+  }
+#if USE_MPI
+  MPI_Bcast(&status,1,MPI_INT,0,comm);
+#endif
+  if ( status == 0 )
+    return false;
+  if ( status < 0 )
+  {
+    if ( mype == 0 )
+      cout << "<WARNING> TDState::read: " << filename
+           << " is not a TD state record, ignored </WARNING>" << endl;
+    return false;
+  }
+#if USE_MPI
+  MPI_Bcast(&buf[0],tdstate_header_size,MPI_CHAR,0,comm);
+#endif
+
+  istringstream hs(string(&buf[0],tdstate_header_size));
+  hs.ignore(16);
+  int npes_file;
+  get(hs,npes_file);
+  vector<int> layout_file(tdstate_layout_len);
+  for ( int i = 0; i < tdstate_layout_len; i++ )
+    get(hs,layout_file[i]);
+  bool same_layout = ( npes_file == npes );
+  for ( int i = 0; i < tdstate_layout_len; i++ )
+    if ( layout_file[i] != ( i < layout.size() ? layout[i] : 0 ) )
+      same_layout = false;
+  if ( !same_layout )
+  {
+    if ( mype == 0 )
+    {
+      cout << "<WARNING> TDState::read: " << filename << " was written by "
+           << npes_file << " tasks with layout";
+      for ( int i = 0; i < layout.size(); i++ )
+        cout << " " << layout_file[i];
+      cout << ", current layout";
+      for ( int i = 0; i < layout.size(); i++ )
+        cout << " " << layout[i];
+      cout << ", propagator history ignored </WARNING>" << endl;
+    }
+    return false;
+  }
+  char wfdyn[tdstate_wfdyn_len];
+  hs.read(wfdyn,tdstate_wfdyn_len);
+  wfdyn[tdstate_wfdyn_len-1] = '\0';
+  wf_dyn = wfdyn;
+  get(hs,mditer);
+  get(hs,tdstep);
+  int iwfv;
+  get(hs,iwfv);
+  has_wfv = ( iwfv != 0 );
+  get(hs,tdtime);
+  get(hs,tddt);
+  get(hs,tddt_prev);
+
+  // table of the local sizes, followed by the local records
+  const long long int table_size = sizeof(long long int)*(npes+1);
+  vector<long long int> table(npes+1);
+#if USE_MPI
+  MPI_File fh;
+  int err = MPI_File_open(comm,(char*) filename.c_str(),
+                          MPI_MODE_RDONLY,MPI_INFO_NULL,&fh);
+  assert(err == 0);
+  MPI_Status mstatus;
+  MPI_File_read_at_all(fh,(MPI_Offset) tdstate_header_size,(void*) &table[0],
+                       table_size,MPI_CHAR,&mstatus);
+#else
+  ifstream is(filename.c_str(),ifstream::binary);
+  is.seekg(tdstate_header_size);
+  is.read((char*) &table[0],table_size);
+#endif
+  assert(table[0] == npes);
+  long long int offset = tdstate_header_size + table_size;
+  for ( int i = 0; i < mype; i++ )
+    offset += table[i+1];
+  const long long int size = table[mype+1];
+  local.assign(size,'\0');
+#if USE_MPI
+  MPI_File_read_at_all(fh,(MPI_Offset) offset,(void*) &local[0],size,
+                       MPI_CHAR,&mstatus);
+  MPI_File_close(&fh);
+#else
+  is.seekg(offset);
+  if ( size > 0 )
+    is.read(&local[0],size);
+#endif
+  return true;
+}
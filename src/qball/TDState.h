@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// TDState.h
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#ifndef TDSTATE_H
+#define TDSTATE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Context.h"
+using namespace std;
+
+// Propagator history saved with a TD checkpoint, so that a restarted run
+// continues the trajectory exactly: time and time step, the vector
+// potential and the history kept by the wavefunction stepper (e.g. the
+// potentials of the previous steps used by AETRS).
+// The global part is identical on all tasks. The local part holds the
+// binary data of each task, so a record can only be read back with the
+// same wavefunction layout (Wavefunction::layout: tasks, process grid and
+// block sizes), which is stored in the header.
+class TDState
+{
+  public:
+
+  string wf_dyn;
+  int mditer;
+  int tdstep;     // number of TD steps done, used for the laser time
+  double tdtime;  // time reached with the adaptive time step
+  double tddt;
+  double tddt_prev;
+  bool has_wfv;   // the previous wavefunction (SOTD) is saved in filebase+"wfv"
+  string local;
+
+  // collective over ctxt, the context of the wavefunction; all tasks
+  // write to a single file
+  void write(const string& filename, const Context& ctxt,
+             const vector<int>& layout) const;
+  // collective over ctxt; returns false if there is no usable record in
+  // filename or if it was written with another layout
+  bool read(const string& filename, const Context& ctxt,
+            const vector<int>& layout);
+
+  // binary (de)serialization of the local data
+  template <class T> static void put(ostream& os, const T& v)
+  { os.write((const char*) &v, sizeof(T)); }
+  template <class T> static void get(istream& is, T& v)
+  { is.read((char*) &v, sizeof(T)); }
+  template <class T> static void put_vector(ostream& os, const vector<T>& v)
+  {
+    const long long int n = v.size();
+    put(os,n);
+    if ( n > 0 )
+      os.write((const char*) &v[0], n*sizeof(T));
+  }
+  template <class T> static void get_vector(istream& is, vector<T>& v)
+  {
+    long long int n;
+    get(is,n);
+    v.resize(n);
+    if ( n > 0 )
+      is.read((char*) &v[0], n*sizeof(T));
+  }
+
+  TDState() : mditer(0), tdstep(0), tdtime(0.0), tddt(0.0), tddt_prev(0.0),
+    has_wfv(false) {}
+};
+#endif
+
+// Local Variables:
+// mode: c++
+// End:
@@ -31,6 +31,8 @@
 #include <qball/Basis.h>
 #include "UnitCell.h"
 #include "Messages.h"
+#include "TDState.h"
+#include <iostream>
 
 #ifndef VECTORPOTENTIAL_H
 #define VECTORPOTENTIAL_H
@@ -132,9 +134,20 @@ public:
     return value2_;
   }
 
+  // set the value of the vector potential without changing its dynamics,
+  // used to evaluate the Hamiltonian at intermediate times
+  void set_value(const D3vector & value){
+    value_ = value;
+    value2_ = norm(value_);
+  }
+
   void calculate_acceleration(const double & dt, const D3vector& total_current, const UnitCell & cell){
-    //update the velocity to time t - dt/2
-    velocity_ += 0.5*dt*accel_;
+    calculate_acceleration(dt, dt, total_current, cell);
+  }
+  // dt_prev is the step from t - dt_prev to t, dt the next step
+  void calculate_acceleration(const double & dt_prev, const double & dt, const D3vector& total_current, const UnitCell & cell){
+    //update the velocity to time t - dt_prev/2
+    velocity_ += 0.5*dt_prev*accel_;
 
     if(dynamics_ == Dynamics::POLARIZATION){
       accel_ = -4.0*M_PI*total_current/cell.volume();
@@ -159,6 +172,22 @@ public:
     value2_ = norm(value_);
   }
 
+  // dynamical state, saved in TD restart records
+  void write_state(std::ostream & os) const {
+    TDState::put(os, external_);
+    TDState::put(os, induced_);
+    TDState::put(os, velocity_);
+    TDState::put(os, accel_);
+  }
+
+  void read_state(std::istream & is){
+    TDState::get(is, external_);
+    TDState::get(is, induced_);
+    TDState::get(is, velocity_);
+    TDState::get(is, accel_);
+    value_ = induced_ + external_;
+    value2_ = norm(value_);
+  }
   
 private:
   Dynamics dynamics_;
@@ -35,9 +35,14 @@
 #include "Context.h"
 #include "jacobi.h"
 #include "profile.h"
+#include "AsyncFileWriter.h"
+#include "CheckpointCompressor.h"
 #include <vector>
 #include <iomanip>
 #include <sstream>
+#include <map>
+#include <algorithm>
+#include <cstring>
 #if USE_CSTDIO_LFS
 #include <cstdio>
 #endif
@@ -2259,6 +2264,8 @@ void Wavefunction::write(SharedFilePtr& sfp, string encoding, string tag) const
 ////////////////////////////////////////////////////////////////////////////////
 void Wavefunction::write_dump(string filebase) {
 
+  write_layout(filebase);
+
   // make unique filename for each process by appending process number to filename
 
   int mype;
@@ -2332,11 +2339,82 @@ void Wavefunction::write_dump(string filebase) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void Wavefunction::write_fast(string filebase) {
+namespace {
+// shells of |k+G| used for the lossy compression of the coefficients:
+// bin of each double (real and imaginary part) of a column of c
+const int kpg_nbins = 16;
+void kpg_bins(const SlaterDet& sd, vector<int>& bin)
+{
+  const Basis& basis = sd.basis();
+  const int ngw = basis.localsize();
+  const double* kpg = basis.kpg_ptr();
+  double kpgmax = 0.0;
+  for ( int ig = 0; ig < ngw; ig++ )
+    kpgmax = max(kpgmax,kpg[ig]);
+  bin.assign(2*sd.c().mloc(),0);
+  if ( kpgmax > 0.0 )
+    for ( int ig = 0; ig < ngw; ig++ )
+      bin[2*ig] = bin[2*ig+1] = min(kpg_nbins-1,(int)(kpg_nbins*kpg[ig]/kpgmax));
+}
+
+// print compression ratio and throughput, collective on MPI_COMM_WORLD
+void report_compression(const string& where, const CheckpointCompressor& c)
+{
+  int mype;
+  MPI_Comm_rank(MPI_COMM_WORLD,&mype);
+  double loc[2] = { c.raw_bytes(), c.packed_bytes() };
+  double sum[2];
+  MPI_Allreduce(loc,sum,2,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
+  double tloc = c.time();
+  double tmax;
+  MPI_Allreduce(&tloc,&tmax,1,MPI_DOUBLE,MPI_MAX,MPI_COMM_WORLD);
+  if ( mype == 0 && sum[1] > 0.0 )
+    cout << "<!-- " << where << ": " << setprecision(4) << sum[0]/1.e6
+         << " MB of data in " << sum[1]/1.e6 << " MB, ratio "
+         << sum[0]/sum[1] << ", " << ( tmax > 0.0 ? sum[0]/1.e6/tmax : 0.0 )
+         << " MB/s -->" << endl;
+}
+
+// the coefficients read from lossy blocks must stay orthonormal within the
+// requested tolerance; collective on MPI_COMM_WORLD
+void check_lossy_ortho(Wavefunction& wf, const string& where,
+                       const CheckpointCompressor& dec)
+{
+  int mype;
+  MPI_Comm_rank(MPI_COMM_WORLD,&mype);
+  double tol = dec.decoded_tol();
+  MPI_Allreduce(MPI_IN_PLACE,&tol,1,MPI_DOUBLE,MPI_MAX,MPI_COMM_WORLD);
+  if ( tol <= 0.0 || wf.ultrasoft() )
+    return;
+  double err = 0.0;
+  for ( int ispin = 0; ispin < wf.nspin(); ispin++ )
+    if ( wf.spinactive(ispin) )
+      for ( int ikp = 0; ikp < wf.nkp(); ikp++ )
+        if ( wf.kptactive(ikp) )
+          err = max(err,wf.sd(ispin,ikp)->ortho_error());
+  MPI_Allreduce(MPI_IN_PLACE,&err,1,MPI_DOUBLE,MPI_MAX,MPI_COMM_WORLD);
+  // each overlap changes by at most ~tol, the error is a Frobenius norm
+  const double bound = tol*wf.nst();
+  if ( mype == 0 )
+  {
+    cout << "<!-- " << where << ": lossy checkpoint, ortho_error = " << err
+         << " (bound " << bound << ") -->" << endl;
+    if ( err > bound )
+      cout << "<WARNING> " << where << ": orthogonality error " << err
+           << " exceeds the compression bound " << bound << " </WARNING>"
+           << endl;
+  }
+}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Wavefunction::write_fast(string filebase, CheckpointCompressor* cmp) {
 
    // write_fast uses C fwrite calls to dump checkpoint data to a subset of
    // files (ideal for machines like BG/Q where the number of I/O nodes is << npes)
 
+   write_layout(filebase);
+
    int mype, npes;
 #if USE_MPI
   MPI_Comm_rank(MPI_COMM_WORLD,&mype);
@@ -2374,6 +2452,12 @@ void Wavefunction::write_fast(string filebase) {
   string mypefile = filebase + oss.str(); 
   ofstream os;
   bool ifempty = (nempty_ > 0);
+  // compressed files hold one block per task, spin and k-point
+  const bool packed = ( cmp != 0 && cmp->active() );
+  if (packed) {
+     mypefile = mypefile + ".z";
+     cmp->reset_stats();
+  }
 
   if (mype == writerTask)  // open file
      os.open(mypefile.c_str(),ofstream::binary);
@@ -2386,7 +2470,41 @@ void Wavefunction::write_fast(string filebase) {
         if (kptactive(ikp)) {
           assert(sd_[ispin][ikp] != 0);
 
-          if (mype == writerTask)  // write local data
+          if (packed)
+          {
+             // each task compresses its own coefficients
+             vector<int> bin;
+             kpg_bins(*sd_[ispin][ikp],bin);
+             const ComplexMatrix& c = sd_[ispin][ikp]->c();
+             string block;
+             cmp->compress((const double*)c.cvalptr(),2*(long long int)c.mloc()*c.nloc(),
+                           c.nloc(),bin.empty() ? 0 : &bin[0],kpg_nbins,block);
+             for (int jj=0; jj<nTasksPerFile; jj++)
+             {
+                int dataTask = jj + writerTask;
+                if (mype == writerTask)
+                {
+                   if (dataTask != mype)
+                   {
+                      int nBytes;
+                      MPI_Recv(&nBytes,1,MPI_INT,dataTask,dataTask,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+                      block.assign(nBytes,'\0');
+                      MPI_Recv(&block[0],nBytes,MPI_CHAR,dataTask,dataTask,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+                   }
+                   const long long int bsize = block.size();
+                   os.write((char*)&bsize,sizeof(bsize));
+                   os.write(block.data(),bsize);
+                }
+                else if (mype == dataTask)
+                {
+                   int nBytes = block.size();
+                   MPI_Send(&nBytes,1,MPI_INT,writerTask,dataTask,MPI_COMM_WORLD);
+                   MPI_Send(&block[0],nBytes,MPI_CHAR,writerTask,dataTask,MPI_COMM_WORLD);
+                }
+             }
+          }
+
+          if (mype == writerTask && !packed)  // write local data
           {
           int mloc = sd_[ispin][ikp]->c().mloc();
           int nloc = sd_[ispin][ikp]->c().nloc();
@@ -2398,7 +2516,7 @@ void Wavefunction::write_fast(string filebase) {
           //fopen    fwrite(&p[n*mloc],sizeof(complex<double>),ngwloc,PEFILE);
           }
           
-          for (int jj=1; jj<nTasksPerFile; jj++)
+          for (int jj=1; jj<nTasksPerFile && !packed; jj++)
           {
              int dataTask = jj + writerTask;
              if (mype == dataTask)
@@ -2439,10 +2557,14 @@ void Wavefunction::write_fast(string filebase) {
   if (mype == writerTask)  // close file
      os.close();
   //fopen fclose(PEFILE);
+
+  if (packed)
+     report_compression("Wavefunction::write_fast",*cmp);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void Wavefunction::write_states(string filebase, string format) {
+void Wavefunction::write_states(string filebase, string format, AsyncFileWriter* writer,
+  CheckpointCompressor* cmp) {
 
    int mype, npes;
 #if USE_MPI
@@ -2454,6 +2576,11 @@ void Wavefunction::write_states(string filebase, string format) {
 #endif
 
   bool ifempty = (nempty_ > 0);
+  const bool staged = ( writer != 0 && format == "binary" );
+  // compressed states are written to statefile.z, one block per task row
+  const bool packed = ( cmp != 0 && cmp->active() && format == "binary" );
+  if (packed)
+     cmp->reset_stats();
   for ( int ispin = 0; ispin < nspin_; ispin++ ) {
     if (spinactive(ispin)) {
       for ( int ikp = 0; ikp < sdcontext_[ispin].size(); ikp++ ) {
@@ -2487,24 +2614,29 @@ void Wavefunction::write_states(string filebase, string format) {
                       const int norig = lj*sd_[ispin][kp]->c().nb()+jj;
 
                       ofstream os;
+                      string statefile;
+                      string stage;
                       if (mype == writerTask) {
                          // write out wavefunction for this state and k-point
                          ostringstream oss1,oss2,oss3;
                          oss1.width(5);  oss1.fill('0');  oss1 << nglobal;
                          oss2.width(4);  oss2.fill('0');  oss2 << kp;
                          oss3.width(1);  oss3.fill('0');  oss3 << ispin;
-                         string statefile;
                          if (nspin_ == 1) 
                             statefile = filebase + "k" + oss2.str() + "n" + oss1.str(); 
                          else
                             statefile = filebase + "s" + oss3.str() + "k" + oss2.str() + "n" + oss1.str(); 
                          
-                         if (format == "molmol" || format == "text") 
+                         if (packed)
+                            statefile = statefile + ".z";
+                         else if (format == "molmol" || format == "text") 
                             statefile = statefile + ".iso";
                          else if (format == "gopenmol") 
                             statefile = statefile + ".plt";
                          
-                         if (format == "binary") 
+                         if (staged)
+                            stage.reserve(sizeof(complex<double>)*ft.np012());
+                         else if (format == "binary") 
                             os.open(statefile.c_str(),ofstream::binary);
                          else {
                             os.open(statefile.c_str(),ofstream::out);
@@ -2549,17 +2681,63 @@ void Wavefunction::write_states(string filebase, string format) {
                       ComplexMatrix& c = sd_[ispin][kp]->c();
                       ft.backward(c.cvalptr(mloc*norig),&wftmp[0]);
 
+                      // each task compresses its own part of the grid
+                      string block;
+                      if (packed)
+                         cmp->compress((double*)&wftmp[0],2*(long long int)ft.np012loc(),1,0,1,block);
+
                       // write out wave function
                       if (mype == writerTask)  // write local data
                       {
                          int size = ft.np012loc();
-                         os.write((char*)&wftmp[0],sizeof(complex<double>)*size);
-                         os.flush();
+                         if (packed) {
+                            const long long int bsize = block.size();
+                            if (staged) {
+                               stage.append((char*)&bsize,sizeof(bsize));
+                               stage.append(block);
+                            }
+                            else {
+                               os.write((char*)&bsize,sizeof(bsize));
+                               os.write(block.data(),bsize);
+                            }
+                         }
+                         else if (staged)
+                            stage.append((char*)&wftmp[0],sizeof(complex<double>)*size);
+                         else {
+                            os.write((char*)&wftmp[0],sizeof(complex<double>)*size);
+                            os.flush();
+                         }
                       }
           
                       for (int jj=1; jj<nprow; jj++)
                       {
                          int dataTask = jj + writerTask;
+                         if (packed)
+                         {
+                            if (mype == writerTask)
+                            {
+                               int nBytes;
+                               MPI_Recv(&nBytes,1,MPI_INT,dataTask,dataTask,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+                               string data(nBytes,'\0');
+                               MPI_Recv(&data[0],nBytes,MPI_CHAR,dataTask,dataTask,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+                               const long long int bsize = nBytes;
+                               if (staged) {
+                                  stage.append((char*)&bsize,sizeof(bsize));
+                                  stage.append(data);
+                               }
+                               else {
+                                  os.write((char*)&bsize,sizeof(bsize));
+                                  os.write(data.data(),bsize);
+                               }
+                            }
+                            if (mype == dataTask)
+                            {
+                               int nBytes = block.size();
+                               MPI_Send(&nBytes,1,MPI_INT,writerTask,dataTask,MPI_COMM_WORLD);
+                               MPI_Send(&block[0],nBytes,MPI_CHAR,writerTask,dataTask,MPI_COMM_WORLD);
+                            }
+                            continue;
+                         }
                          if (mype == writerTask)
                          {
                             int nComplex;
@@ -2567,8 +2745,12 @@ void Wavefunction::write_states(string filebase, string format) {
                             vector<complex<double> > data;
                             data.resize(nComplex);
                             MPI_Recv(&data[0],nComplex,MPI_DOUBLE_COMPLEX,dataTask,dataTask,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
-                            os.write((char*)&data[0],sizeof(complex<double>)*nComplex);
-                            os.flush();                
+                            if (staged)
+                               stage.append((char*)&data[0],sizeof(complex<double>)*nComplex);
+                            else {
+                               os.write((char*)&data[0],sizeof(complex<double>)*nComplex);
+                               os.flush();
+                            }
                          }
                          if (mype == dataTask)
                          {
@@ -2578,7 +2760,12 @@ void Wavefunction::write_states(string filebase, string format) {
                          }
                       }
                       if (mype == writerTask)  // close file
-                         os.close();
+                      {
+                         if (staged)
+                            writer->add_file(statefile,stage);
+                         else
+                            os.close();
+                      }
                    }
                 }
 
@@ -2594,15 +2781,21 @@ void Wavefunction::write_states(string filebase, string format) {
                       statefile = filebase + "k" + oss2.str() + ".occ"; 
                    else
                       statefile = filebase + "s" + oss3.str() + "k" + oss2.str() + ".occ";
-                   os.open(statefile.c_str(),ofstream::binary);
-                   
                    int nst = sd_[ispin][kp]->nst();
                    const double* peig = sd_[ispin][kp]->eig_ptr();
                    const double* pocc = sd_[ispin][kp]->occ_ptr();
-                   os.write((char*)&peig[0],sizeof(double)*nst);
-                   os.write((char*)&pocc[0],sizeof(double)*nst);
-                   os.flush();
-                   os.close();
+                   if (staged) {
+                      string stage((char*)&peig[0],sizeof(double)*nst);
+                      stage.append((char*)&pocc[0],sizeof(double)*nst);
+                      writer->add_file(statefile,stage);
+                   }
+                   else {
+                      os.open(statefile.c_str(),ofstream::binary);
+                      os.write((char*)&peig[0],sizeof(double)*nst);
+                      os.write((char*)&pocc[0],sizeof(double)*nst);
+                      os.flush();
+                      os.close();
+                   }
                 }
               }
             }
@@ -2611,6 +2804,332 @@ void Wavefunction::write_states(string filebase, string format) {
       }
     }
   }
+  if (packed)
+     report_compression("Wavefunction::write_states",*cmp);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+vector<int> Wavefunction::layout(void) const {
+  // first eight values determine where each coefficient is stored, the
+  // remaining ones are the settings needed to recreate that distribution
+  vector<int> v;
+  int npes = 1;
+#if USE_MPI
+  MPI_Comm_size(ctxt_.comm(),&npes);
+#endif
+  v.push_back(npes);
+  v.push_back(wfcontext_->nprow());
+  v.push_back(wfcontext_->npcol());
+  v.push_back(sdcontext_[0].size());
+  v.push_back(mbset_);
+  v.push_back(nbset_);
+  v.push_back(mblks_);
+  v.push_back(nblks_);
+  v.push_back(nrowmax_);
+  v.push_back(nparallelkpts_);
+  v.push_back(nspin_);
+  v.push_back(nkp());
+  return v;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Wavefunction::write_layout(string filebase) const {
+  if ( wfcontext_->myproc() != 0 )
+    return;
+  vector<int> v = layout();
+  string layoutfile = filebase + "layout";
+  ofstream os(layoutfile.c_str());
+  os << "qbox-wf-layout-1" << endl;
+  os << "npes " << v[0] << endl;
+  os << "context " << v[1] << " " << v[2] << " " << v[3] << endl;
+  os << "local_block " << v[4] << " " << v[5] << endl;
+  os << "nblocks " << v[6] << " " << v[7] << endl;
+  os << "nrowmax " << v[8] << endl;
+  os << "nparallelkpts " << v[9] << endl;
+  os << "nspin " << v[10] << endl;
+  os << "nkpoints " << v[11] << endl;
+  if ( !os )
+    cout << "<WARNING> Wavefunction::write_layout: could not write "
+         << layoutfile << " </WARNING>" << endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool Wavefunction::read_reshaped(string filebase, bool fast) {
+
+  // checkpoints written before the layout file existed, or with the
+  // current layout, are read directly
+  vector<int> cur = layout();
+  const int nv = cur.size();
+  vector<int> saved(nv+1,0);
+  if ( wfcontext_->myproc() == 0 ) {
+    string layoutfile = filebase + "layout";
+    ifstream is(layoutfile.c_str());
+    string tag;
+    if ( is >> tag && tag == "qbox-wf-layout-1" ) {
+      is >> tag >> saved[1];
+      is >> tag >> saved[2] >> saved[3] >> saved[4];
+      is >> tag >> saved[5] >> saved[6];
+      is >> tag >> saved[7] >> saved[8];
+      is >> tag >> saved[9];
+      is >> tag >> saved[10];
+      is >> tag >> saved[11];
+      is >> tag >> saved[12];
+      saved[0] = is ? 1 : 0;
+    }
+    if ( saved[0] == 0 && is.is_open() )
+      cout << "<WARNING> Wavefunction::read_reshaped: cannot parse "
+           << layoutfile << ", assuming current layout </WARNING>" << endl;
+    wfcontext_->ibcast_send(nv+1,1,&saved[0],nv+1);
+  }
+  else
+    wfcontext_->ibcast_recv(nv+1,1,&saved[0],nv+1,0,0);
+
+  if ( saved[0] == 0 )
+    return false;
+  vector<int> old(saved.begin()+1,saved.end());
+  if ( equal(old.begin(),old.begin()+8,cur.begin()) )
+    return false;
+
+  if ( old[0] != cur[0] || old[10] != cur[10] || old[11] != cur[11] ) {
+    if ( ctxt_.oncoutpe() )
+      cout << "<ERROR> Wavefunction::read_reshaped: " << filebase
+           << " was written by " << old[0] << " tasks with nspin = "
+           << old[10] << " and " << old[11] << " k-points, cannot read it on "
+           << cur[0] << " tasks with nspin = " << cur[10] << " and "
+           << cur[11] << " k-points; use the states format to change the"
+           << " task count </ERROR>" << endl;
+    return true;
+  }
+
+  if ( ctxt_.oncoutpe() )
+    cout << "<!-- Wavefunction::read_reshaped: checkpoint layout "
+         << old[1] << "x" << old[2] << " (" << old[3]
+         << " k-point groups) differs from current layout "
+         << cur[1] << "x" << cur[2] << " (" << cur[3]
+         << " k-point groups), redistributing -->" << endl;
+
+  // read into a copy of this wavefunction set up with the stored layout,
+  // then move the coefficients across
+  Wavefunction wf(*this);
+  wf.deallocate();
+  delete wf.wfcontext_;
+  wf.mbset_ = old[4];
+  wf.nbset_ = old[5];
+  wf.mblks_ = old[6];
+  wf.nblks_ = old[7];
+  wf.nrowmax_ = old[8];
+  wf.nparallelkpts_ = old[9];
+  wf.hasdata_ = true;
+  wf.allocate();
+
+  if ( wf.layout()[1] != old[1] || wf.layout()[2] != old[2] ||
+       wf.layout()[3] != old[3] ) {
+    if ( ctxt_.oncoutpe() )
+      cout << "<ERROR> Wavefunction::read_reshaped: could not recreate the "
+           << "layout of " << filebase << " </ERROR>" << endl;
+    return true;
+  }
+
+  if ( fast )
+    wf.read_fast(filebase);
+  else
+    wf.read_dump(filebase);
+  redistribute(wf);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Wavefunction::redistribute(const Wavefunction& wf) {
+
+  // Move the coefficients of wf into this wavefunction. Both hold the same
+  // states and plane waves but may use different process grids, k-point
+  // groups and block sizes. The plane wave distribution only depends on the
+  // number of process rows, so both bases are rebuilt locally on every task
+  // and the data is exchanged rod by rod in a single all-to-all per SlaterDet.
+
+  Timer tm;
+  tm.start();
+  tmap["redistribute"].start();
+
+  int npes = 1;
+#if USE_MPI
+  MPI_Comm_size(ctxt_.comm(),&npes);
+#endif
+  bool ifempty = (nempty_ > 0);
+
+  for ( int ispin = 0; ispin < nspin_; ispin++ ) {
+    for ( int ikp = 0; ikp < nkp(); ikp++ ) {
+
+      SlaterDet* osd = 0;
+      if ( wf.spinactive(ispin) && wf.kptactive(ikp) )
+        osd = wf.sd_[ispin][ikp];
+      if ( osd != 0 && !osd->context().active() )
+        osd = 0;
+      SlaterDet* nsd = 0;
+      if ( spinactive(ispin) && kptactive(ikp) )
+        nsd = sd_[ispin][ikp];
+      if ( nsd != 0 && !nsd->context().active() )
+        nsd = 0;
+
+      // process grid position of every task in the old and new SlaterDet
+      int mine[4] = { -1, -1, -1, -1 };
+      if ( osd != 0 ) {
+        mine[0] = osd->context().myrow();
+        mine[1] = osd->context().mycol();
+      }
+      if ( nsd != 0 ) {
+        mine[2] = nsd->context().myrow();
+        mine[3] = nsd->context().mycol();
+      }
+      vector<int> pos(4*npes);
+#if USE_MPI
+      MPI_Allgather(mine,4,MPI_INT,&pos[0],4,MPI_INT,ctxt_.comm());
+#else
+      for ( int i = 0; i < 4; i++ )
+        pos[i] = mine[i];
+#endif
+
+      // column block sizes and grid widths of both matrices
+      int dims[4] = { 0, 0, 0, 0 };
+      if ( osd != 0 ) {
+        dims[0] = osd->c().nb();
+        dims[1] = osd->context().npcol();
+      }
+      if ( nsd != 0 ) {
+        dims[2] = nsd->c().nb();
+        dims[3] = nsd->context().npcol();
+      }
+      wfcontext_->imax(4,1,dims,4);
+      const int onb = dims[0], onpcol = dims[1];
+      const int nnb = dims[2], nnpcol = dims[3];
+      const int nst = nst_[ispin];
+
+      // rod distribution of the old and new bases
+      const bool fc = ultrasoft_ || force_complex_wf_;
+      Basis obasis(*wf.wfcontext_,kpoint_[ikp],fc);
+      obasis.resize(cell_,refcell_,ecut_);
+      Basis nbasis(*wfcontext_,kpoint_[ikp],fc);
+      nbasis.resize(cell_,refcell_,ecut_);
+      map<pair<int,int>,pair<int,int> > newrod;
+      for ( int irow = 0; irow < wfcontext_->nprow(); irow++ )
+        for ( int irod = 0; irod < nbasis.nrod_loc(irow); irod++ )
+          newrod[make_pair(nbasis.rod_h(irow,irod),nbasis.rod_k(irow,irod))] =
+            make_pair(irow,nbasis.rod_first(irow,irod));
+
+      // destination row and local offset of every rod of old row irow
+      const int onprow = wf.wfcontext_->nprow();
+      vector<vector<int> > odest(onprow), ofirst(onprow);
+      for ( int irow = 0; irow < onprow; irow++ ) {
+        for ( int irod = 0; irod < obasis.nrod_loc(irow); irod++ ) {
+          pair<int,int> d = newrod[make_pair(obasis.rod_h(irow,irod),
+                                             obasis.rod_k(irow,irod))];
+          odest[irow].push_back(d.first);
+          ofirst[irow].push_back(d.second);
+        }
+      }
+
+      // both sides walk states in increasing order and the rods of the old
+      // row in basis order, so no indices need to be sent
+      vector<int> scount(npes,0), sdispl(npes,0);
+      vector<int> rcount(npes,0), rdispl(npes,0);
+      vector<complex<double> > sbuf, rbuf;
+      if ( osd != 0 ) {
+        const int orow = mine[0], ocol = mine[1];
+        const int omloc = osd->c().mloc();
+        const complex<double>* p = osd->c().cvalptr();
+        for ( int ipe = 0; ipe < npes; ipe++ ) {
+          sdispl[ipe] = sbuf.size();
+          const int nrow = pos[4*ipe+2], ncol = pos[4*ipe+3];
+          if ( nrow < 0 ) continue;
+          for ( int n = 0; n < nst; n++ ) {
+            if ( (n/onb)%onpcol != ocol || (n/nnb)%nnpcol != ncol ) continue;
+            const int nl = (n/(onb*onpcol))*onb + n%onb;
+            for ( int irod = 0; irod < obasis.nrod_loc(orow); irod++ ) {
+              if ( odest[orow][irod] != nrow ) continue;
+              const complex<double>* pr =
+                p + nl*omloc + obasis.rod_first(orow,irod);
+              sbuf.insert(sbuf.end(),pr,pr+obasis.rod_size(orow,irod));
+            }
+          }
+          scount[ipe] = sbuf.size() - sdispl[ipe];
+        }
+      }
+      if ( nsd != 0 ) {
+        const int nrow = mine[2], ncol = mine[3];
+        int size = 0;
+        for ( int ipe = 0; ipe < npes; ipe++ ) {
+          rdispl[ipe] = size;
+          const int orow = pos[4*ipe], ocol = pos[4*ipe+1];
+          if ( orow < 0 ) continue;
+          for ( int n = 0; n < nst; n++ ) {
+            if ( (n/onb)%onpcol != ocol || (n/nnb)%nnpcol != ncol ) continue;
+            for ( int irod = 0; irod < obasis.nrod_loc(orow); irod++ )
+              if ( odest[orow][irod] == nrow )
+                size += obasis.rod_size(orow,irod);
+          }
+          rcount[ipe] = size - rdispl[ipe];
+        }
+        rbuf.resize(size);
+      }
+#if USE_MPI
+      MPI_Alltoallv(sbuf.empty() ? 0 : &sbuf[0],&scount[0],&sdispl[0],
+                    MPI_DOUBLE_COMPLEX,rbuf.empty() ? 0 : &rbuf[0],
+                    &rcount[0],&rdispl[0],MPI_DOUBLE_COMPLEX,ctxt_.comm());
+#else
+      rbuf = sbuf;
+#endif
+
+      if ( nsd != 0 ) {
+        const int nrow = mine[2], ncol = mine[3];
+        const int nmloc = nsd->c().mloc();
+        nsd->c().clear();
+        complex<double>* p = nsd->c().valptr();
+        const complex<double>* pr = rbuf.empty() ? 0 : &rbuf[0];
+        for ( int ipe = 0; ipe < npes; ipe++ ) {
+          const int orow = pos[4*ipe], ocol = pos[4*ipe+1];
+          if ( orow < 0 ) continue;
+          for ( int n = 0; n < nst; n++ ) {
+            if ( (n/onb)%onpcol != ocol || (n/nnb)%nnpcol != ncol ) continue;
+            const int nl = (n/(nnb*nnpcol))*nnb + n%nnb;
+            for ( int irod = 0; irod < obasis.nrod_loc(orow); irod++ ) {
+              if ( odest[orow][irod] != nrow ) continue;
+              const int len = obasis.rod_size(orow,irod);
+              memcpy(p + nl*nmloc + ofirst[orow][irod],pr,
+                     len*sizeof(complex<double>));
+              pr += len;
+            }
+          }
+        }
+      }
+
+      // eigenvalues and occupations are replicated within each SlaterDet
+      if ( ifempty ) {
+        vector<double> eo(2*nst,0.0);
+        if ( osd != 0 && mine[0] == 0 && mine[1] == 0 )
+          for ( int n = 0; n < nst; n++ ) {
+            eo[n] = osd->eig(n);
+            eo[nst+n] = osd->occ(n);
+          }
+#if USE_MPI
+        MPI_Allreduce(MPI_IN_PLACE,&eo[0],2*nst,MPI_DOUBLE,MPI_SUM,
+                      ctxt_.comm());
+#endif
+        if ( nsd != 0 ) {
+          vector<double> eig(eo.begin(),eo.begin()+nst);
+          vector<double> occ(eo.begin()+nst,eo.end());
+          nsd->set_eig(eig);
+          nsd->set_occ(occ);
+        }
+      }
+    }
+  }
+
+  tmap["redistribute"].stop();
+  tm.stop();
+  double time = tm.real();
+  ctxt_.dmax(1,1,&time,1);
+  if ( ctxt_.oncoutpe() )
+    cout << "<!-- Wavefunction::redistribute: " << time << " s -->" << endl;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -2620,6 +3139,8 @@ void Wavefunction::read_dump(string filebase) {
     hasdata_ = true;
     allocate();
   }
+  if ( read_reshaped(filebase,false) )
+    return;
 
   // get unique filename for each process by appending process number to filename
 
@@ -2693,6 +3214,8 @@ void Wavefunction::read_fast(string filebase) {
     hasdata_ = true;
     allocate();
   }
+  if ( read_reshaped(filebase,true) )
+    return;
    // read_fast reads checkpoint data written using write_fast, distributes
 
    int mype, npes;
@@ -2731,8 +3254,17 @@ void Wavefunction::read_fast(string filebase) {
   ifstream is;
   bool ifempty = (nempty_ > 0);
 
-  if (mype == readerTask)
-     is.open(mypefile.c_str(),ofstream::binary);
+  // compressed files (save_compression) are used if present
+  CheckpointCompressor dec("OFF",0.0);
+  int packed = 0;
+  if (mype == readerTask) {
+     is.open((mypefile + ".z").c_str(),ofstream::binary);
+     if (is.is_open())
+        packed = 1;
+     else
+        is.open(mypefile.c_str(),ofstream::binary);
+  }
+  MPI_Allreduce(MPI_IN_PLACE,&packed,1,MPI_INT,MPI_MAX,MPI_COMM_WORLD);
 
   // read in wave function
   for ( int ispin = 0; ispin < nspin_; ispin++ ) {
@@ -2742,7 +3274,48 @@ void Wavefunction::read_fast(string filebase) {
               assert(sd_[ispin][ikp] != 0);
               
               int fileFound = -1;
-              if (mype == readerTask)  // read local data
+              if (packed)
+              {
+                 vector<int> bin;
+                 kpg_bins(*sd_[ispin][ikp],bin);
+                 ComplexMatrix& c = sd_[ispin][ikp]->c();
+                 string block;
+                 for (int jj=0; jj<nTasksPerFile; jj++)
+                 {
+                    int dataTask = jj + readerTask;
+                    if (mype == readerTask)
+                    {
+                       long long int bsize = 0;
+                       if (is.is_open())
+                          is.read((char*)&bsize,sizeof(bsize));
+                       block.assign(bsize,'\0');
+                       if (bsize > 0)
+                          is.read(&block[0],bsize);
+                       if (dataTask != mype)
+                       {
+                          int nBytes = bsize;
+                          MPI_Send(&nBytes,1,MPI_INT,dataTask,dataTask,MPI_COMM_WORLD);
+                          MPI_Send(&block[0],nBytes,MPI_CHAR,dataTask,dataTask,MPI_COMM_WORLD);
+                       }
+                    }
+                    else if (mype == dataTask)
+                    {
+                       int nBytes;
+                       MPI_Recv(&nBytes,1,MPI_INT,readerTask,dataTask,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+                       block.assign(nBytes,'\0');
+                       MPI_Recv(&block[0],nBytes,MPI_CHAR,readerTask,dataTask,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+                    }
+                    if (mype == dataTask)
+                       if (!dec.decompress(block,(double*)c.valptr(),2*(long long int)c.mloc()*c.nloc(),bin.empty() ? 0 : &bin[0]))
+                       {
+                          cout << "<ERROR> Wavefunction::read_fast: corrupt block in " << mypefile
+                               << ".z, task " << mype << " </ERROR>" << endl;
+                          MPI_Abort(MPI_COMM_WORLD,1);
+                       }
+                 }
+                 fileFound = 1;
+              }
+              else if (mype == readerTask)  // read local data
               {
                  int mloc = sd_[ispin][ikp]->c().mloc();
                  int nloc = sd_[ispin][ikp]->c().nloc();
@@ -2760,7 +3333,7 @@ void Wavefunction::read_fast(string filebase) {
                  }                       
               }                       
                
-              for (int jj=1; jj<nTasksPerFile; jj++)
+              for (int jj=1; jj<nTasksPerFile && !packed; jj++)
               {
                  int dataTask = jj + readerTask;
                  if (mype == dataTask)
@@ -2823,15 +3396,27 @@ void Wavefunction::read_fast(string filebase) {
   
   if (mype == readerTask)
      is.close();
-  
+
+  if (packed) {
+     report_compression("Wavefunction::read_fast",dec);
+     check_lossy_ortho(*this,"Wavefunction::read_fast",dec);
+  }
 }
 ////////////////////////////////////////////////////////////////////////////////
-void Wavefunction::read_states(string filebase) {
+void Wavefunction::read_states(string filebase, const CheckpointSlice* slice) {
    
    if (!hasdata_) {
       hasdata_ = true;
       allocate();
    }
+   if (slice != 0 && slice->all())
+      slice = 0;
+   if (slice != 0 && !slice->kplist.empty() && slice->kplist.size() != nkp()) {
+      if ( ctxt_.oncoutpe() )
+         cout << "<ERROR> Wavefunction::read_states: " << slice->kplist.size()
+              << " k-points selected, wavefunction has " << nkp() << " </ERROR>" << endl;
+      return;
+   }
    int mype, npes;
 #if USE_MPI
    MPI_Comm_rank(MPI_COMM_WORLD,&mype);
@@ -2842,6 +3427,8 @@ void Wavefunction::read_states(string filebase) {
 #endif
    
    bool ifempty = (nempty_ > 0);
+   // decoder for compressed (.z) state files
+   CheckpointCompressor dec("OFF",0.0);
    if (!hasdata_) {
       hasdata_ = true;
       allocate();
@@ -2875,6 +3462,10 @@ void Wavefunction::read_states(string filebase) {
                         for ( int n = 0; n < nstloc; n++ ) {
                            // global n index
                            const int nn = sd(ispin,kp)->c().j(0,n);
+                           // states outside the slice are not read, all
+                           // tasks of this process column skip together
+                           if (slice != 0 && !slice->has_state(nn))
+                              continue;
 
                            vector<complex<double> > wftmp(ft.np012loc());
 
@@ -2883,26 +3474,42 @@ void Wavefunction::read_states(string filebase) {
                            if (mype == readerTask) {
                               // read in wavefunction for this state and k-point
                               ostringstream oss1,oss2,oss3;
-                              oss1.width(5);  oss1.fill('0');  oss1 << nn;
-                              oss2.width(4);  oss2.fill('0');  oss2 << kp;
+                              oss1.width(5);  oss1.fill('0');  oss1 << (slice != 0 ? slice->state(nn) : nn);
+                              oss2.width(4);  oss2.fill('0');  oss2 << (slice != 0 ? slice->kpoint(kp) : kp);
                               oss3.width(1);  oss3.fill('0');  oss3 << ispin;
                               string statefile;
                               if (nspin_ == 1) 
                                  statefile = filebase + "k" + oss2.str() + "n" + oss1.str(); 
                               else
                                  statefile = filebase + "s" + oss3.str() + "k" + oss2.str() + "n" + oss1.str(); 
-                              is.open(statefile.c_str(),ofstream::binary);
+                              // compressed states (save_compression) first
+                              is.open((statefile + ".z").c_str(),ofstream::binary);
                               if (is.is_open()) {
-                                 // read local data
-                                 int size = ft.np012loc();
-                                 is.read((char*)&wftmp[0],sizeof(complex<double>)*size);
-                                 fileFound = 1;
+                                 fileFound = 2;
+                                 long long int bsize;
+                                 is.read((char*)&bsize,sizeof(bsize));
+                                 string block(bsize,'\0');
+                                 is.read(&block[0],bsize);
+                                 if (!dec.decompress(block,(double*)&wftmp[0],2*(long long int)ft.np012loc()))
+                                 {
+                                    cout << "<!-- Error on load: " << statefile << ".z is corrupt. -->" << endl;
+                                    MPI_Abort(MPI_COMM_WORLD, 1);
+                                 }
                               }
                               else {
-                                 fileFound = -1;
-                                 checkPointFound = -1;
-				 cout << "<!-- Error on load: " << statefile << " checkpoint file not found. -->" << endl;
-				 MPI_Abort(MPI_COMM_WORLD, 1);
+                                 is.open(statefile.c_str(),ofstream::binary);
+                                 if (is.is_open()) {
+                                    // read local data
+                                    int size = ft.np012loc();
+                                    is.read((char*)&wftmp[0],sizeof(complex<double>)*size);
+                                    fileFound = 1;
+                                 }
+                                 else {
+                                    fileFound = -1;
+                                    checkPointFound = -1;
+                                    cout << "<!-- Error on load: " << statefile << " checkpoint file not found. -->" << endl;
+                                    MPI_Abort(MPI_COMM_WORLD, 1);
+                                 }
                               }
                            }
 
@@ -2912,6 +3519,16 @@ void Wavefunction::read_states(string filebase) {
                               if (mype == readerTask)
                               {
                                  MPI_Send(&fileFound,1,MPI_INT,dataTask,dataTask,MPI_COMM_WORLD);
+                                 if (fileFound == 2)
+                                 {
+                                    long long int bsize;
+                                    is.read((char*)&bsize,sizeof(bsize));
+                                    string block(bsize,'\0');
+                                    is.read(&block[0],bsize);
+                                    int nBytes = bsize;
+                                    MPI_Send(&nBytes,1,MPI_INT,dataTask,dataTask,MPI_COMM_WORLD);
+                                    MPI_Send(&block[0],nBytes,MPI_CHAR,dataTask,dataTask,MPI_COMM_WORLD);
+                                 }
                                  if (fileFound == 1)
                                  {
                                     int nComplex;
@@ -2925,6 +3542,18 @@ void Wavefunction::read_states(string filebase) {
                               if (mype == dataTask)
                               {
                                  MPI_Recv(&fileFound,1,MPI_INT,readerTask,dataTask,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+                                 if (fileFound == 2)
+                                 {
+                                    int nBytes;
+                                    MPI_Recv(&nBytes,1,MPI_INT,readerTask,dataTask,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+                                    string block(nBytes,'\0');
+                                    MPI_Recv(&block[0],nBytes,MPI_CHAR,readerTask,dataTask,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+                                    if (!dec.decompress(block,(double*)&wftmp[0],2*(long long int)ft.np012loc()))
+                                    {
+                                       cout << "<!-- Error on load: corrupt compressed state " << nn << " -->" << endl;
+                                       MPI_Abort(MPI_COMM_WORLD, 1);
+                                    }
+                                 }
                                  if (fileFound == 1)
                                  {
                                     int size = ft.np012loc();
@@ -2938,7 +3567,7 @@ void Wavefunction::read_states(string filebase) {
                            //if (fileFound <= 0)
                            //   return;
 
-                           if (fileFound == 1)
+                           if (fileFound >= 1)
                            {
                               if (mype == readerTask)
                                  is.close();
@@ -2968,7 +3597,7 @@ void Wavefunction::read_states(string filebase) {
                            if (mype == procZero) {
                               // get occupation for this state and k-point
                               ostringstream oss2,oss3;
-                              oss2.width(4);  oss2.fill('0');  oss2 << kp;
+                              oss2.width(4);  oss2.fill('0');  oss2 << (slice != 0 ? slice->kpoint(kp) : kp);
                               oss3.width(1);  oss3.fill('0');  oss3 << ispin;
                               string statefile;
                               if (nspin_ == 1) 
@@ -2981,7 +3610,28 @@ void Wavefunction::read_states(string filebase) {
                            int nst = sd_[ispin][ikp]->nst();
                            double* peig = (double*)sd_[ispin][ikp]->eig_ptr();
                            double* pocc = (double*)sd_[ispin][ikp]->occ_ptr();
-                           if (mype == procZero) {
+                           if (mype == procZero && slice != 0) {
+                              // the file holds eig and occ of all its states
+                              is.seekg(0,ios::end);
+                              const int fnst = is.tellg()/(2*sizeof(double));
+                              int nread = min(nst,fnst-slice->nfirst);
+                              if (slice->nlast >= 0)
+                                 nread = min(nread,slice->nlast-slice->nfirst+1);
+                              if (nread > 0) {
+                                 is.seekg(slice->nfirst*sizeof(double));
+                                 is.read((char*)&peig[0],sizeof(double)*nread);
+                                 is.seekg((fnst+slice->nfirst)*sizeof(double));
+                                 is.read((char*)&pocc[0],sizeof(double)*nread);
+                              }
+                              is.close();
+                              for (int jj=1; jj<nProcs; jj++)
+                              {
+                                 int dataTask = jj + procZero;
+                                 MPI_Send(&peig[0],nst,MPI_DOUBLE,dataTask,dataTask,MPI_COMM_WORLD);
+                                 MPI_Send(&pocc[0],nst,MPI_DOUBLE,dataTask,dataTask,MPI_COMM_WORLD);
+                              }
+                           }
+                           else if (mype == procZero) {
                               is.read((char*)&peig[0],sizeof(double)*nst);
                               is.read((char*)&pocc[0],sizeof(double)*nst);
                               is.close();
@@ -3005,6 +3655,397 @@ void Wavefunction::read_states(string filebase) {
          }
       }
    }
+   // no output unless .z files were read
+   report_compression("Wavefunction::read_states",dec);
+   check_lossy_ortho(*this,"Wavefunction::read_states",dec);
+}
+////////////////////////////////////////////////////////////////////////////////
+// Layout of the file written by write_mpiio:
+//   char[16] "qbox-wf-mpiio-2"
+//   int nspin, nkp, nst[2], mditer
+//   double ecut, cell a0 a1 a2
+//   double kpoint[3], weight for each k-point
+//   int ngw, the size of the basis, for each k-point
+//   double eig[nst], occ[nst] for each spin and k-point
+//   complex<double> c(G)[ngw] for each spin, k-point and state
+// The plane wave coefficients of a state are stored rod by rod, with the
+// rods sorted by (h,k) and l increasing within a rod. This order only
+// depends on ecut, cell and k-point, not on the process grid.
+////////////////////////////////////////////////////////////////////////////////
+namespace {
+const char mpiio_magic[16] = "qbox-wf-mpiio-2";
+const int mpiio_nint = 5;
+const int mpiio_fixed_size = 16 + mpiio_nint*sizeof(int) + 10*sizeof(double);
+
+// contiguous piece of a local column: file offset in bytes from the start
+// of the coefficients, memory address and number of coefficients
+struct MPIIOBlock {
+  MPI_Offset offset;
+  MPI_Aint addr;
+  int size;
+  bool operator<(const MPIIOBlock& b) const { return offset < b.offset; }
+};
+
+// offset (in coefficients) of the first state of spin ispin and k-point kp
+long long int mpiio_offset(int ispin, int kp, const int* nst,
+                           const vector<int>& ngw) {
+  long long int ngwsum = 0, offset = 0;
+  for ( int k = 0; k < ngw.size(); k++ ) {
+    if ( k == kp )
+      offset = (long long int) nst[ispin]*ngwsum;
+    ngwsum += ngw[k];
+  }
+  for ( int is = 0; is < ispin; is++ )
+    offset += (long long int) nst[is]*ngwsum;
+  return offset;
+}
+
+// add the local columns n < nmax of sd, stored in the file as states
+// nfirst+n starting at coefficient offset base
+void mpiio_add_blocks(SlaterDet& sd, long long int base, int ngw,
+                      int nfirst, int nmax, vector<MPIIOBlock>& blocks) {
+  const Basis& basis = sd.basis();
+
+  // position of each rod in the canonical order
+  vector<pair<pair<int,int>,int> > rods;
+  for ( int ipe = 0; ipe < basis.context().nprow(); ipe++ )
+    for ( int irod = 0; irod < basis.nrod_loc(ipe); irod++ )
+      rods.push_back(make_pair(make_pair(basis.rod_h(ipe,irod),
+                     basis.rod_k(ipe,irod)),basis.rod_size(ipe,irod)));
+  sort(rods.begin(),rods.end());
+  map<pair<int,int>,long long int> rodoffset;
+  long long int first = 0;
+  for ( int i = 0; i < rods.size(); i++ ) {
+    rodoffset[rods[i].first] = first;
+    first += rods[i].second;
+  }
+  vector<long long int> loc(basis.nrod_loc());
+  for ( int irod = 0; irod < basis.nrod_loc(); irod++ )
+    loc[irod] = rodoffset[make_pair(basis.rod_h(irod),basis.rod_k(irod))];
+
+  ComplexMatrix& c = sd.c();
+  for ( int lj=0; lj < c.nblocks(); lj++ )
+    for ( int jj=0; jj < c.nbs(lj); jj++ ) {
+      const int n = c.j(lj,jj);
+      if ( n >= nmax )
+        continue;
+      complex<double>* p = c.valptr(c.mloc()*(lj*c.nb()+jj));
+      const long long int state = base + (long long int) (nfirst+n)*ngw;
+      for ( int irod = 0; irod < basis.nrod_loc(); irod++ ) {
+        MPIIOBlock b;
+        b.offset = (MPI_Offset) sizeof(complex<double>) * (state + loc[irod]);
+        MPI_Get_address(p+basis.rod_first(irod),&b.addr);
+        b.size = basis.rod_size(irod);
+        blocks.push_back(b);
+      }
+    }
+}
+
+// one collective transfer of all local blocks through a file view
+void mpiio_transfer(MPI_File fh, MPI_Offset disp, vector<MPIIOBlock>& blocks,
+                    bool write) {
+  sort(blocks.begin(),blocks.end());
+  const int n = blocks.size();
+  vector<int> len(n);
+  vector<MPI_Aint> foff(n), addr(n);
+  for ( int i = 0; i < n; i++ ) {
+    len[i] = 2*blocks[i].size;
+    foff[i] = (MPI_Aint) blocks[i].offset;
+    addr[i] = blocks[i].addr;
+  }
+  MPI_Datatype filetype, memtype;
+  MPI_Type_create_hindexed(n,n > 0 ? &len[0] : 0,n > 0 ? &foff[0] : 0,
+                           MPI_DOUBLE,&filetype);
+  MPI_Type_create_hindexed(n,n > 0 ? &len[0] : 0,n > 0 ? &addr[0] : 0,
+                           MPI_DOUBLE,&memtype);
+  MPI_Type_commit(&filetype);
+  MPI_Type_commit(&memtype);
+  MPI_File_set_view(fh,disp,MPI_DOUBLE,filetype,(char*) "native",MPI_INFO_NULL);
+  MPI_Status status;
+  if ( write )
+    MPI_File_write_all(fh,MPI_BOTTOM,n > 0 ? 1 : 0,memtype,&status);
+  else
+    MPI_File_read_all(fh,MPI_BOTTOM,n > 0 ? 1 : 0,memtype,&status);
+  MPI_Type_free(&filetype);
+  MPI_Type_free(&memtype);
+}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Wavefunction::write_mpiio(string filename, int mditer) {
+
+  int mype;
+  MPI_Comm_rank(ctxt_.comm(),&mype);
+
+  const int nkp = kpoint_.size();
+  int nst[2] = { 0, 0 };
+  for ( int ispin = 0; ispin < nspin_; ispin++ )
+    nst[ispin] = nst_[ispin];
+
+  // local Slater determinants and the basis size of each k-point
+  map<int,SlaterDet*> sdmap;
+  vector<int> ngw(nkp,0);
+  for ( int ispin = 0; ispin < nspin_; ispin++ ) {
+    if (spinactive(ispin)) {
+      for ( int ikp = 0; ikp < sdcontext_[ispin].size(); ikp++ ) {
+        if (sdcontext_[ispin][ikp] != 0 && sdcontext_[ispin][ikp]->active() ) {
+          for ( int kloc=0; kloc<nkptloc_; kloc++) {
+            int kp = kptloc_[kloc];
+            if ( sd_[ispin][kp] != 0 ) {
+              sdmap[ispin*nkp+kp] = sd_[ispin][kp];
+              ngw[kp] = sd_[ispin][kp]->basis().size();
+            }
+          }
+        }
+      }
+    }
+  }
+  // task 0 may not hold all k-points
+  MPI_Allreduce(MPI_IN_PLACE,&ngw[0],nkp,MPI_INT,MPI_MAX,ctxt_.comm());
+
+  MPI_File fh;
+  int err = MPI_File_open(ctxt_.comm(),(char*) filename.c_str(),
+                          MPI_MODE_WRONLY|MPI_MODE_CREATE,MPI_INFO_NULL,&fh);
+  if ( err != 0 ) {
+    if ( mype == 0 )
+      cout << "<ERROR> Wavefunction::write_mpiio: cannot open " << filename
+           << " </ERROR>" << endl;
+    return;
+  }
+  MPI_File_set_size(fh,0);
+  MPI_Status status;
+
+  // fixed part of the header, k-points and basis sizes
+  const MPI_Offset koffset = mpiio_fixed_size;
+  const MPI_Offset ngwoffset = koffset + 4*nkp*sizeof(double);
+  const MPI_Offset eigoffset = ngwoffset + nkp*sizeof(int);
+  if ( mype == 0 ) {
+    vector<char> buf(mpiio_fixed_size);
+    char* p = &buf[0];
+    memcpy(p,mpiio_magic,16);
+    int ihead[mpiio_nint] = { nspin_, nkp, nst[0], nst[1], mditer };
+    memcpy(p+16,ihead,sizeof(ihead));
+    double dhead[10];
+    dhead[0] = ecut_;
+    for ( int i = 0; i < 3; i++ ) {
+      dhead[1+3*i] = cell_.a(i).x;
+      dhead[2+3*i] = cell_.a(i).y;
+      dhead[3+3*i] = cell_.a(i).z;
+    }
+    memcpy(p+16+sizeof(ihead),dhead,sizeof(dhead));
+    MPI_File_write_at(fh,0,&buf[0],mpiio_fixed_size,MPI_CHAR,&status);
+    vector<double> kbuf(4*nkp);
+    for ( int k = 0; k < nkp; k++ ) {
+      kbuf[4*k] = kpoint_[k].x;
+      kbuf[4*k+1] = kpoint_[k].y;
+      kbuf[4*k+2] = kpoint_[k].z;
+      kbuf[4*k+3] = weight_[k];
+    }
+    MPI_File_write_at(fh,koffset,&kbuf[0],4*nkp,MPI_DOUBLE,&status);
+    MPI_File_write_at(fh,ngwoffset,&ngw[0],nkp,MPI_INT,&status);
+  }
+
+  // eigenvalues and occupations, written by the first task of each context
+  for ( map<int,SlaterDet*>::iterator i = sdmap.begin(); i != sdmap.end(); i++ ) {
+    const int ispin = i->first / nkp;
+    const int kp = i->first % nkp;
+    const SlaterDet* sd = i->second;
+    if ( sd->context().myrow() == 0 && sd->context().mycol() == 0 ) {
+      MPI_Offset offset = eigoffset;
+      for ( int is = 0; is < ispin; is++ )
+        offset += 2*nkp*nst[is]*sizeof(double);
+      offset += 2*kp*nst[ispin]*sizeof(double);
+      MPI_File_write_at(fh,offset,(void*)sd->eig_ptr(),nst[ispin],MPI_DOUBLE,&status);
+      MPI_File_write_at(fh,offset+nst[ispin]*sizeof(double),(void*)sd->occ_ptr(),
+                        nst[ispin],MPI_DOUBLE,&status);
+    }
+  }
+  MPI_Offset dataoffset = eigoffset;
+  for ( int is = 0; is < nspin_; is++ )
+    dataoffset += 2*nkp*nst[is]*sizeof(double);
+
+  // coefficients: a single collective write of all local columns
+  vector<MPIIOBlock> blocks;
+  for ( map<int,SlaterDet*>::iterator i = sdmap.begin(); i != sdmap.end(); i++ ) {
+    const int ispin = i->first / nkp;
+    const int kp = i->first % nkp;
+    mpiio_add_blocks(*i->second,mpiio_offset(ispin,kp,nst,ngw),ngw[kp],
+                     0,nst[ispin],blocks);
+  }
+  mpiio_transfer(fh,dataoffset,blocks,true);
+  MPI_File_close(&fh);
+
+  if ( mype == 0 )
+    cout << "<!-- Wavefunction::write_mpiio: " << filename << " written -->"
+         << endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void Wavefunction::read_mpiio(string filename, int& mditer,
+  const CheckpointSlice* slice) {
+
+  if (!hasdata_) {
+    hasdata_ = true;
+    allocate();
+  }
+  CheckpointSlice all;
+  if (slice == 0)
+    slice = &all;
+  int mype;
+  MPI_Comm_rank(ctxt_.comm(),&mype);
+  const int nkp = kpoint_.size();
+
+  MPI_File fh;
+  int err = MPI_File_open(ctxt_.comm(),(char*) filename.c_str(),
+                          MPI_MODE_RDONLY,MPI_INFO_NULL,&fh);
+  if ( err != 0 ) {
+    if ( mype == 0 )
+      cout << "<ERROR> Wavefunction::read_mpiio: cannot open " << filename
+           << " </ERROR>" << endl;
+    MPI_Abort(MPI_COMM_WORLD,1);
+  }
+  MPI_Status status;
+
+  // the header is read by task 0 and broadcast
+  vector<char> buf(mpiio_fixed_size);
+  if ( mype == 0 )
+    MPI_File_read_at(fh,0,&buf[0],mpiio_fixed_size,MPI_CHAR,&status);
+  MPI_Bcast(&buf[0],mpiio_fixed_size,MPI_CHAR,0,ctxt_.comm());
+  if ( strncmp(&buf[0],mpiio_magic,16) != 0 ) {
+    if ( mype == 0 )
+      cout << "<ERROR> Wavefunction::read_mpiio: " << filename
+           << " is not an MPI-IO wavefunction file </ERROR>" << endl;
+    MPI_Abort(MPI_COMM_WORLD,1);
+  }
+  int ihead[mpiio_nint];
+  memcpy(ihead,&buf[16],sizeof(ihead));
+  double dhead[10];
+  memcpy(dhead,&buf[16+sizeof(ihead)],sizeof(dhead));
+  const int fnspin = ihead[0];
+  const int fnkp = ihead[1];
+  const int fnst[2] = { ihead[2], ihead[3] };
+
+  // number of states read for each spin
+  int nread[2] = { 0, 0 };
+  bool ok = ( fnspin == nspin_ );
+  if ( slice->all() ) {
+    ok = ok && ( fnkp == nkp );
+    for ( int ispin = 0; ok && ispin < nspin_; ispin++ ) {
+      ok = ( fnst[ispin] == nst_[ispin] );
+      nread[ispin] = nst_[ispin];
+    }
+  }
+  else {
+    if ( slice->kplist.empty() )
+      ok = ok && ( fnkp == nkp );
+    else
+      ok = ok && ( slice->kplist.size() == nkp );
+    for ( int k = 0; ok && k < nkp; k++ )
+      ok = ( slice->kpoint(k) >= 0 && slice->kpoint(k) < fnkp );
+    for ( int ispin = 0; ok && ispin < nspin_; ispin++ ) {
+      nread[ispin] = min(nst_[ispin],fnst[ispin]-slice->nfirst);
+      if ( slice->nlast >= 0 )
+        nread[ispin] = min(nread[ispin],slice->nlast-slice->nfirst+1);
+      ok = ( nread[ispin] > 0 );
+    }
+  }
+  if ( !ok ) {
+    if ( mype == 0 )
+      cout << "<ERROR> Wavefunction::read_mpiio: " << filename << " has nspin = "
+           << fnspin << ", nkp = " << fnkp << ", nst = " << fnst[0] << " " << fnst[1]
+           << ", not compatible with the current wavefunction </ERROR>" << endl;
+    MPI_Abort(MPI_COMM_WORLD,1);
+  }
+  if ( mype == 0 && fabs(dhead[0] - ecut_) > 1.e-8 )
+    cout << "<WARNING> Wavefunction::read_mpiio: " << filename
+         << " was written with ecut = " << dhead[0] << " </WARNING>" << endl;
+
+  const MPI_Offset koffset = mpiio_fixed_size;
+  const MPI_Offset ngwoffset = koffset + 4*fnkp*sizeof(double);
+  const MPI_Offset eigoffset = ngwoffset + fnkp*sizeof(int);
+  int neig = 0;
+  for ( int is = 0; is < nspin_; is++ )
+    neig += 2*fnkp*fnst[is];
+  const MPI_Offset dataoffset = eigoffset + neig*sizeof(double);
+
+  // k-points, basis sizes, eigenvalues and occupations are read by task 0
+  // and broadcast
+  vector<double> kbuf(4*fnkp);
+  vector<int> fngw(fnkp);
+  vector<double> eigbuf(neig);
+  if ( mype == 0 ) {
+    MPI_File_read_at(fh,koffset,&kbuf[0],4*fnkp,MPI_DOUBLE,&status);
+    MPI_File_read_at(fh,ngwoffset,&fngw[0],fnkp,MPI_INT,&status);
+    MPI_File_read_at(fh,eigoffset,&eigbuf[0],neig,MPI_DOUBLE,&status);
+  }
+  MPI_Bcast(&kbuf[0],4*fnkp,MPI_DOUBLE,0,ctxt_.comm());
+  MPI_Bcast(&fngw[0],fnkp,MPI_INT,0,ctxt_.comm());
+  MPI_Bcast(&eigbuf[0],neig,MPI_DOUBLE,0,ctxt_.comm());
+  for ( int k = 0; k < nkp; k++ ) {
+    const int fk = slice->kpoint(k);
+    D3vector kp(kbuf[4*fk],kbuf[4*fk+1],kbuf[4*fk+2]);
+    if ( length(kp - kpoint_[k]) > 1.e-6 ) {
+      if ( mype == 0 )
+        cout << "<ERROR> Wavefunction::read_mpiio: k-point " << fk << " of "
+             << filename << " is " << kp << " </ERROR>" << endl;
+      MPI_Abort(MPI_COMM_WORLD,1);
+    }
+  }
+
+  // local states
+  vector<MPIIOBlock> blocks;
+  int basisok = 1;
+  for ( int ispin = 0; ispin < nspin_; ispin++ ) {
+    if (spinactive(ispin)) {
+      for ( int ikp = 0; ikp < sdcontext_[ispin].size(); ikp++ ) {
+        if (sdcontext_[ispin][ikp] != 0 && sdcontext_[ispin][ikp]->active() ) {
+          for ( int kloc=0; kloc<nkptloc_; kloc++) {
+            int kp = kptloc_[kloc];
+            if ( sd_[ispin][kp] != 0 ) {
+              SlaterDet& sd = *sd_[ispin][kp];
+              const int fkp = slice->kpoint(kp);
+              if ( sd.basis().size() != fngw[fkp] ) {
+                basisok = 0;
+                continue;
+              }
+              // only states in the slice are read
+              mpiio_add_blocks(sd,mpiio_offset(ispin,fkp,fnst,fngw),fngw[fkp],
+                               slice->nfirst,nread[ispin],blocks);
+
+              // eigenvalues and occupations
+              int ieig = 0;
+              for ( int is = 0; is < ispin; is++ )
+                ieig += 2*fnkp*fnst[is];
+              ieig += 2*fkp*fnst[ispin] + slice->nfirst;
+              vector<double> eig(sd.eig()), occ(sd.occ());
+              for ( int n = 0; n < nread[ispin]; n++ ) {
+                eig[n] = eigbuf[ieig+n];
+                occ[n] = eigbuf[ieig+fnst[ispin]+n];
+              }
+              sd.set_eig(eig);
+              sd.set_occ(occ);
+            }
+          }
+        }
+      }
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE,&basisok,1,MPI_INT,MPI_MIN,ctxt_.comm());
+  if ( !basisok ) {
+    if ( mype == 0 )
+      cout << "<ERROR> Wavefunction::read_mpiio: the basis sizes of " << filename
+           << " are not compatible with ecut and cell </ERROR>" << endl;
+    MPI_Abort(MPI_COMM_WORLD,1);
+  }
+
+  mpiio_transfer(fh,dataoffset,blocks,false);
+  MPI_File_close(&fh);
+
+  if ( ihead[4] > 0 )
+    mditer = ihead[4];
+  if ( mype == 0 )
+    cout << "<!-- Wavefunction::read_mpiio: " << filename << " read, mditer = "
+         << mditer << " -->" << endl;
 }
 ////////////////////////////////////////////////////////////////////////////////
 void Wavefunction::write_states_old(string filebase, string format) {
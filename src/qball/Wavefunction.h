@@ -44,9 +44,24 @@ using namespace std;
 
 class SlaterDet;
 class Context;
+class AsyncFileWriter;
+class CheckpointCompressor;
 
 typedef map<string,Timer> TimerMap;
 
+// part of a checkpoint to load (load -states i:j -kpoints list): state n and
+// k-point k of the wavefunction are read from state nfirst+n and k-point
+// kplist[k] of the checkpoint. States past nlast are left unchanged.
+struct CheckpointSlice {
+  int nfirst, nlast;   // nlast < 0: as many states as the wavefunction has
+  vector<int> kplist;  // empty: same k-points as the wavefunction
+  CheckpointSlice(void) : nfirst(0), nlast(-1) {}
+  bool all(void) const { return nfirst == 0 && nlast < 0 && kplist.empty(); }
+  bool has_state(int n) const { return nlast < 0 || nfirst + n <= nlast; }
+  int state(int n) const { return nfirst + n; }
+  int kpoint(int k) const { return kplist.empty() ? k : kplist[k]; }
+};
+
 class Wavefunction {
   private:
 
@@ -98,6 +113,15 @@ class Wavefunction {
   void resize(); // resize SlaterDets if ecut,cell,refcell,or nst have changed
   void reshape(); // reshape SlaterDets onto new parallel distribution while
                   // preserving existing data
+
+  // the layout is stored next to dump and fast checkpoints so that they
+  // can be read with another layout
+  void write_layout(string filebase) const;
+  // if filebase was written with another layout, read it in that layout
+  // and redistribute it, returns false if the layouts are the same
+  bool read_reshaped(string filebase, bool fast);
+  // copy the coefficients of wf, same states and basis on another layout
+  void redistribute(const Wavefunction& wf);
   
   mutable TimerMap tmap;
 
@@ -110,6 +134,8 @@ class Wavefunction {
   Wavefunction& operator=(const Wavefunction& wf);
   
   const Context& context(void) const { return ctxt_; }
+  // process grid and block sizes of the SlaterDets
+  vector<int> layout(void) const;
   const UnitCell& cell(void) const { return cell_; }
   const UnitCell& refcell(void) const { return refcell_; }
   const D3vector kpoint(int ikp) const { return kpoint_[ikp]; }
@@ -205,13 +231,24 @@ class Wavefunction {
   void printocc(void);
   void write(SharedFilePtr& fh, string encoding, string tag) const;
   void write_dump(string filebase);
-  void write_fast(string filebase);
-  void write_states(string filebase, string format);
+  void write_fast(string filebase, CheckpointCompressor* cmp = 0);
+  // with a writer, binary files are staged and written in the background
+  void write_states(string filebase, string format, AsyncFileWriter* writer = 0,
+    CheckpointCompressor* cmp = 0);
   void write_states_old(string filebase, string format);
   void write_mditer(string filebase, int mditer);
   void read_dump(string filebase);
   void read_fast(string filebase);
-  void read_states(string filebase);
+  void read_states(string filebase, const CheckpointSlice* slice = 0);
+  // single file written collectively with MPI-IO. The plane wave
+  // coefficients are stored in a global G order that does not depend on the
+  // process grid, so the file can be read with any nrowmax, nparallelkpts
+  // or number of tasks
+  void write_mpiio(string filename, int mditer);
+  // the fixed size records of the file are also indexed by state and
+  // k-point, so a slice only reads the selected states
+  void read_mpiio(string filename, int& mditer,
+    const CheckpointSlice* slice = 0);
   void read_states_old(string filebase);
   void read_mditer(string filebase, int& mditer);
   void info(ostream& os, string tag);
@@ -31,6 +31,7 @@
 #ifndef WAVEFUNCTIONSTEPPER_H
 #define WAVEFUNCTIONSTEPPER_H
 #include "Timer.h"
+#include <iostream>
 #include <map>
 #include <string>
 
@@ -52,6 +53,20 @@ class WavefunctionStepper
   virtual void preprocess(void) {}
   virtual void postprocess(void) {}
 
+  // adaptive time step: steppers that provide an error estimate of the
+  // last step return a non-negative value
+  virtual void enable_error_estimate(void) {}
+  virtual double error_estimate(void) const { return -1.0; }
+  virtual void set_tddt(double tddt) {}
+
+  // history kept between steps (e.g. previous potentials), saved in TD
+  // restart records
+  virtual void write_state(std::ostream& os) const {}
+  virtual void read_state(std::istream& is) {}
+
+  // memory of the work wavefunctions held by the stepper
+  virtual void print_memory(std::ostream& os, double& totsum, double& locsum) const {}
+
   WavefunctionStepper(Wavefunction& wf, TimerMap& tmap) : 
   wf_(wf), tmap_(tmap)
   {}
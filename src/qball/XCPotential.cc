@@ -158,7 +158,7 @@ XCPotential::~XCPotential(void)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void XCPotential::update(vector<vector<double> >& vr, vector<vector<double> >& vxc_tau) //YY
+void XCPotential::update(vector<vector<double> >& vr, vector<vector<double> >& vxc_tau, bool compute_exc) //YY
 {
   // compute exchange-correlation energy and add vxc potential to vr[ispin][ir]
   
@@ -235,7 +235,8 @@ void XCPotential::update(vector<vector<double> >& vr, vector<vector<double> >& v
     double tsum = exc_ * vbasis_.cell().volume() / vft_.np012();
 
     //ewd notes:  ctxt_ is a single-column context here
-    ctxt_.dsum(1,1,&tsum,1);
+    if ( compute_exc )
+      ctxt_.dsum(1,1,&tsum,1);
     exc_ = tsum;
 
   }
@@ -470,7 +471,8 @@ void XCPotential::update(vector<vector<double> >& vr, vector<vector<double> >& v
     }
 
     double tsum = esum * vbasis_.cell().volume() / vft_.np012();
-    ctxt_.dsum(1,1,&tsum,1);
+    if ( compute_exc )
+      ctxt_.dsum(1,1,&tsum,1);
     exc_ = tsum;
 
   }
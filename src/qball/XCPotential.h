@@ -84,7 +84,9 @@ class XCPotential
   XCPotential(ChargeDensity& cd, const string functional_name, const Sample& s);
   XCPotential(ChargeDensity& cd, const string functional_name, ChargeDensity& cd_ecalc, const Sample& s);
   ~XCPotential();
-  void update(vector<vector<double> >& vr, vector<vector<double> >& vxc_tau);
+  // if compute_exc is false, exc() only holds the local contribution
+  void update(vector<vector<double> >& vr, vector<vector<double> >& vxc_tau,
+              bool compute_exc = true);
   void update_exc(vector<vector<double> >& vr);
   void compute_stress(valarray<double>& sigma_exc);
   double exc(void) { return exc_; }
@@ -52,6 +52,11 @@ using namespace std;
 #include "Timer.h"
 #include "BOSampleStepper.h"
 #include "CPSampleStepper.h"
+#include "EhrenSampleStepper.h"
+#include "ChargeDensity.h"
+#include "FourierTransform.h"
+#include "Basis.h"
+#include "SlaterDet.h"
 #include "qbLink.h"
 #include "profile.h"
 
@@ -69,6 +74,7 @@ using namespace std;
 #include <ui/RandomizeRealWfCmd.h>
 #include <ui/RandomizeVelCmd.h>
 #include <ui/RunCmd.h>
+#include <ui/RunKicksCmd.h>
 #include <ui/MDSaveCmd.h>
 #include <ui/SaveCmd.h>
 #include <ui/SavesysCmd.h>
@@ -160,8 +166,14 @@ using namespace std;
 #include <vars/Pblock.h>
 #include <vars/SaveFreq.h>
 #include <vars/SaveDenFreq.h>
+#include <vars/SaveAsync.h>
+#include <vars/SaveCompression.h>
+#include <vars/SaveDenFormat.h>
+#include <vars/ObservableLogFile.h>
+#include <vars/SpeciesCacheDir.h>
 #include <vars/SaveWfFreq.h>
 #include <vars/CalDipFreq.h>
+#include <vars/EnergyOutputFreq.h>
 #include <vars/NetCharge.h>
 #include <vars/EsmBC.h>
 #include <vars/EsmW.h>
@@ -171,6 +183,37 @@ using namespace std;
 #include <vars/LaserAmp.h>
 #include <vars/LaserEnvelope.h>
 #include <vars/VdW.h>
+#include <vars/AlphaPBE0.h>
+#include <vars/AlphaRSH.h>
+#include <vars/BetaRSH.h>
+#include <vars/MuRSH.h>
+#include <vars/BlHF.h>
+#include <vars/BtHF.h>
+#include <vars/MLWFDist.h>
+#include <vars/MLWFSubbox.h>
+#include <vars/Efield.h>
+#include <vars/EfieldAnti.h>
+#include <vars/Polarization.h>
+#include <vars/Occ.h>
+#include <vars/KrylovTol.h>
+#include <vars/ChebyshevTol.h>
+#include <vars/TDDtAdapt.h>
+#include <vars/SaveProjFreq.h>
+#include <vars/SaveHoleFreq.h>
+#include <vars/SaveElecFreq.h>
+#include <vars/SaveNTOFreq.h>
+#include <vars/Save2ndProjFreq.h>
+#include <vars/NaturalOrbital.h>
+#include <vars/EfieldAmp.h>
+#include <vars/GaussField.h>
+#include <vars/SineField.h>
+#include <vars/FcpThermostat.h>
+#include <vars/FcpThTemp.h>
+#include <vars/FcpThTime.h>
+#include <vars/FcpThWidth.h>
+#include <vars/FcpPmass.h>
+#include <vars/FcpMu.h>
+#include <vars/Vext.h>
 
 #ifdef USE_JAGGEMM
 extern "C" int setup_grid();
@@ -348,6 +391,7 @@ void qbLink::init(void) {
   ui->addCmd(new RandomizeWfCmd(s));
   ui->addCmd(new RandomizeVelCmd(s));
   ui->addCmd(new RunCmd(s));
+  ui->addCmd(new RunKicksCmd(s));
   ui->addCmd(new SaveCmd(s));
   ui->addCmd(new SavesysCmd(s));
   ui->addCmd(new SavedenCmd(s));
@@ -430,8 +474,14 @@ void qbLink::init(void) {
   ui->addVar(new WF_Phase_RealVar(s));
   ui->addVar(new SaveFreq(s));
   ui->addVar(new SaveDenFreq(s));
+  ui->addVar(new SaveAsync(s));
+  ui->addVar(new SaveCompression(s));
+  ui->addVar(new SaveDenFormat(s));
+  ui->addVar(new ObservableLogFile(s));
+  ui->addVar(new SpeciesCacheDir(s));
   ui->addVar(new SaveWfFreq(s));
   ui->addVar(new CalDipFreq(s));
+  ui->addVar(new EnergyOutputFreq(s));
   ui->addVar(new NetCharge(s));
   ui->addVar(new EsmBC(s));
   ui->addVar(new EsmW(s));
@@ -441,6 +491,38 @@ void qbLink::init(void) {
   ui->addVar(new LaserFreq(s));
   ui->addVar(new LaserEnvelope(s));
   ui->addVar(new VdW(s));
+  ui->addVar(new AlphaPBE0(s));
+  ui->addVar(new AlphaRSH(s));
+  ui->addVar(new BetaRSH(s));
+  ui->addVar(new MuRSH(s));
+  ui->addVar(new BlHF(s));
+  ui->addVar(new BtHF(s));
+  ui->addVar(new MLWFDist(s));
+  ui->addVar(new MLWFSubbox(s));
+  ui->addVar(new Efield(s));
+  ui->addVar(new EfieldAnti(s));
+  ui->addVar(new Polarization(s));
+  ui->addVar(new Occ(s));
+  ui->addVar(new KrylovTol(s));
+  ui->addVar(new ChebyshevTol(s));
+  ui->addVar(new WfExtrap(s));
+  ui->addVar(new TDDtAdapt(s));
+  ui->addVar(new SaveProjFreq(s));
+  ui->addVar(new SaveHoleFreq(s));
+  ui->addVar(new SaveElecFreq(s));
+  ui->addVar(new SaveNTOFreq(s));
+  ui->addVar(new Save2ndProjFreq(s));
+  ui->addVar(new NaturalOrbital(s));
+  ui->addVar(new EfieldAmp(s));
+  ui->addVar(new GaussField(s));
+  ui->addVar(new SineField(s));
+  ui->addVar(new FcpThermostat(s));
+  ui->addVar(new FcpThTemp(s));
+  ui->addVar(new FcpThTime(s));
+  ui->addVar(new FcpThWidth(s));
+  ui->addVar(new FcpPmass(s));
+  ui->addVar(new FcpMu(s));
+  ui->addVar(new Vext(s));
 
 #ifdef USE_JAGGEMM
   setup_grid();
@@ -481,10 +563,7 @@ void qbLink::processInputLine(string inputline) {
 void qbLink::processInputFile(string filename) {
   if (active_) {
     cout_to_qboxlog();
-    ifstream infile;
-    if ( ctxt->oncoutpe() )
-      infile.open(filename.c_str(),ios::in);
-    ui->processCmds(infile, "[qbLink]", true);
+    ui->processFile(filename, "[qbLink]", true);
 
     restore_cout();
   }
@@ -677,6 +756,143 @@ void qbLink::runCPSteps(int niter) {
     restore_cout();
   }
 }
+void qbLink::runEhrenSteps(int niter, string wf_dyn, double tddt) {
+  if (active_) {
+    cout_to_qboxlog();
+    if (stepper != 0)
+      delete stepper;
+
+    const string wf_dyn_save = s->ctrl.wf_dyn;
+    const double tddt_save = s->ctrl.tddt;
+    s->ctrl.wf_dyn = wf_dyn;
+    s->ctrl.tddt = tddt;
+
+    if (s->hamil_wf == 0) {
+      s->hamil_wf = new Wavefunction(s->wf);
+      (*s->hamil_wf) = s->wf;
+      (*s->hamil_wf).update_occ(0.0,0);
+    }
+
+    stepper = new EhrenSampleStepper(*s,1,0);
+    assert(stepper!=0);
+    if (ctxt->oncoutpe() ) 
+      cout << "<run niter_ionic=\"" << niter << "\" wf_dyn=\"" << wf_dyn
+           << "\" tddt=\"" << tddt << "\">" << endl;
+    s->wf.info(cout,"wavefunction");
+    stepper->step(niter);
+    if (ctxt->oncoutpe() ) 
+      cout << "</run>" << endl;
+
+    s->ctrl.wf_dyn = wf_dyn_save;
+    s->ctrl.tddt = tddt_save;
+    restore_cout();
+  }
+}
+string qbLink::get_wf_dyn(void) {
+  if (active_)
+    return s->ctrl.wf_dyn;
+  else
+    return "";
+}
+double qbLink::get_tddt(void) {
+  if (active_)
+    return s->ctrl.tddt;
+  else
+    return 0.0;
+}
+int qbLink::get_savefreq(void) {
+  if (active_)
+    return s->ctrl.savefreq;
+  else
+    return 0;
+}
+void qbLink::get_wavefunction(vector<complex<double> > &c) {
+  c.clear();
+  if (active_) {
+    Wavefunction& wf = s->wf;
+    for ( int ispin = 0; ispin < wf.nspin(); ispin++ )
+      if (wf.spinactive(ispin))
+        for ( int ikp = 0; ikp < wf.nkp(); ikp++ )
+          if (wf.kptactive(ikp)) {
+            assert(wf.sd(ispin,ikp) != 0);
+            const ComplexMatrix& sdc = wf.sd(ispin,ikp)->c();
+            const complex<double>* p = sdc.cvalptr();
+            c.insert(c.end(),p,p+sdc.size());
+          }
+  }
+}
+void qbLink::set_wavefunction(const vector<complex<double> > &c,
+                              bool orthonormalize) {
+  if (active_) {
+    Wavefunction& wf = s->wf;
+    size_t offset = 0;
+    for ( int ispin = 0; ispin < wf.nspin(); ispin++ )
+      if (wf.spinactive(ispin))
+        for ( int ikp = 0; ikp < wf.nkp(); ikp++ )
+          if (wf.kptactive(ikp)) {
+            assert(wf.sd(ispin,ikp) != 0);
+            ComplexMatrix& sdc = wf.sd(ispin,ikp)->c();
+            assert(offset + sdc.size() <= c.size());
+            complex<double>* p = sdc.valptr();
+            for ( int i = 0; i < sdc.size(); i++ )
+              p[i] = c[offset+i];
+            offset += sdc.size();
+          }
+    assert(offset == c.size());
+    if (orthonormalize)
+      wf.gram();
+    // the Hamiltonian wavefunction of a TD run follows the new state
+    if (s->hamil_wf != 0)
+      (*s->hamil_wf) = wf;
+    // the previous wavefunction of SOTD belongs to the replaced state
+    delete s->wfv;
+    s->wfv = 0;
+  }
+}
+void qbLink::get_density(vector<double> &rhor, double dipole[3]) {
+  dipole[0] = dipole[1] = dipole[2] = 0.0;
+  rhor.clear();
+  if (active_) {
+    ChargeDensity cd(*s);
+    cd.update_density();
+    const FourierTransform& vft = *cd.vft();
+    const int np012loc = vft.np012loc();
+    rhor.assign(np012loc,0.0);
+    for ( int ispin = 0; ispin < s->wf.nspin(); ispin++ )
+      for ( int i = 0; i < np012loc; i++ )
+        rhor[i] += cd.rhor[ispin][i];
+
+    // electronic dipole -sum_r r rho(r) dV, with r in the reference cell
+    const UnitCell& cell = s->wf.cell();
+    const double dv = cell.volume() / vft.np012();
+    for ( int i = 0; i < np012loc; i++ ) {
+      const D3vector r = ( (double) vft.i(i) / vft.np0() ) * cell.a(0) +
+                         ( (double) vft.j(i) / vft.np1() ) * cell.a(1) +
+                         ( (double) vft.k(i) / vft.np2() ) * cell.a(2);
+      dipole[0] -= r.x * rhor[i] * dv;
+      dipole[1] -= r.y * rhor[i] * dv;
+      dipole[2] -= r.z * rhor[i] * dv;
+    }
+    cd.vcontext().dsum(3,1,dipole,3);
+  }
+}
+double qbLink::density_difference(const vector<double> &rho1,
+                                  const vector<double> &rho2) {
+  double sum = 0.0;
+  if (active_) {
+    assert(rho1.size() == rho2.size());
+    for ( int i = 0; i < rho1.size(); i++ )
+      sum += fabs(rho1[i] - rho2[i]);
+    // the density slabs are distributed over the rows of the
+    // first column of the wavefunction context
+    const Context& vctxt = s->wf.sdloc(0)->basis().context();
+    double np = rho1.size();
+    vctxt.dsum(1,1,&np,1);
+    vctxt.dsum(1,1,&sum,1);
+    sum *= s->wf.cell().volume() / np;
+  }
+  return sum;
+}
 int qbLink::nsp(void) {
   if (active_) 
     return s->atoms.nsp();
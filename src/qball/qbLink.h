@@ -33,6 +33,8 @@
 
 #include <valarray>
 #include <vector>
+#include <complex>
+#include <string>
 using namespace std;
 
 class Context;
@@ -75,6 +77,24 @@ class qbLink {
   
   void runBOSteps(int niter, int nitscf, int nite);
   void runCPSteps(int niter);
+  // run niter time steps of length tddt with the given wf_dyn, leaving
+  // the wf_dyn and tddt variables of the sample unchanged
+  void runEhrenSteps(int niter, string wf_dyn, double tddt);
+  string get_wf_dyn(void);
+  double get_tddt(void);
+  int get_savefreq(void);
+
+  // local coefficients of all states, used to exchange wavefunctions
+  // between links running on identically shaped contexts; set_wavefunction
+  // optionally re-orthonormalizes a linear combination of states and
+  // drops the previous wavefunction of SOTD
+  void get_wavefunction(vector<complex<double> > &c);
+  void set_wavefunction(const vector<complex<double> > &c, bool orthonormalize);
+  // local slab of the total electronic density and electronic dipole
+  void get_density(vector<double> &rhor, double dipole[3]);
+  // integral of |rho1-rho2| over the cell
+  double density_difference(const vector<double> &rho1,
+                            const vector<double> &rho2);
   int nsp(void);
   int nsp_mm(void);
   int na(int isp);
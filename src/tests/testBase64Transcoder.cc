@@ -28,37 +28,122 @@
 
 #include <config.h>
 
-#include "Base64Transcoder.h"
+#include <qball/Base64Transcoder.h>
+#include <qball/Timer.h>
 #include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cassert>
 using namespace std;
 
-int main()
+// use: testBase64Transcoder [nbytes]
+// checks encode/decode against a reference encoder for all sizes up to
+// 300 bytes, then reports the throughput for nbytes bytes
+// (default 64 MB)
+
+////////////////////////////////////////////////////////////////////////////////
+string reference_encode(const vector<my_byte>& a)
+{
+  const char* t =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  string s;
+  for ( size_t i = 0; i < a.size(); i += 3 )
+  {
+    int v = a[i] << 16;
+    if ( i+1 < a.size() ) v |= a[i+1] << 8;
+    if ( i+2 < a.size() ) v |= a[i+2];
+    s += t[(v >> 18) & 63];
+    s += t[(v >> 12) & 63];
+    s += i+1 < a.size() ? t[(v >> 6) & 63] : '=';
+    s += i+2 < a.size() ? t[v & 63] : '=';
+  }
+  return s;
+}
+
+int main(int argc, char** argv)
 {
-  const int n = 7;
-  double a[n] = { 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0};
-  double c[n] = { 0, 0, 0, 0, 0, 0, 0 };
-  
   Base64Transcoder xcdr;
-  
-  int nbytes = n * sizeof(double);
-  
-  int nchars = xcdr.nchars(nbytes);
-  
-  cout << " nbytes=" << nbytes << endl;
-  cout << " nchars=" << nchars << endl;
-  
-  char* b = new char[nchars];
-  
-  xcdr.encode(nbytes,(unsigned char*) &a[0],b);
-  
-  cout << " b=" << b << endl;
-  
-  xcdr.decode(nchars,b,(unsigned char*) &c[0]);
-  
-  for ( int i = 0; i < n; i++ )
-    assert(a[i]==c[i]);
-    
+
+  // correctness
+  for ( int n = 0; n <= 300; n++ )
+  {
+    vector<my_byte> a(n), c(n+16);
+    for ( int i = 0; i < n; i++ )
+      a[i] = rand() & 0xff;
+    const string ref = reference_encode(a);
+
+    const int nchars = xcdr.nchars(n);
+    vector<char> b(nchars+1);
+    xcdr.encode(n,n ? &a[0] : 0,&b[0]);
+    assert(string(&b[0],nchars) == ref);
+    assert(xcdr.decode(nchars,&b[0],&c[0]) == n);
+    for ( int i = 0; i < n; i++ )
+      assert(a[i]==c[i]);
+
+    // streaming encoder, decoded with the line breaks
+    ostringstream os;
+    xcdr.encode((size_t) n,n ? &a[0] : 0,os);
+    const string sb = os.str();
+    for ( size_t i = 0; i < sb.size(); i += 73 )
+      assert(sb.compare(i,72,ref,(i/73)*72,72) == 0 || i+73 > sb.size());
+    fill(c.begin(),c.end(),0);
+    assert(xcdr.decode(sb.size(),sb.c_str(),&c[0]) == n);
+    for ( int i = 0; i < n; i++ )
+      assert(a[i]==c[i]);
+  }
+  cout << " encode/decode correct" << endl;
+
+  // throughput
+  const size_t nbytes = argc > 1 ? atol(argv[1]) : 64 << 20;
+  vector<my_byte> a(nbytes), c(nbytes);
+  for ( size_t i = 0; i < nbytes; i++ )
+    a[i] = rand() & 0xff;
+  const int nchars = xcdr.nchars(nbytes);
+  vector<char> b(nchars);
+  const double mb = nbytes / 1048576.0;
+
+  Timer tm;
+  tm.start();
+  xcdr.encode(nbytes,&a[0],&b[0]);
+  tm.stop();
+  cout << " encode:        " << mb/tm.real() << " MB/s" << endl;
+
+  // output to /dev/null to exclude the cost of the stream buffer
+  ofstream devnull("/dev/null");
+  tm.reset();
+  tm.start();
+  xcdr.encode(nbytes,&a[0],devnull);
+  tm.stop();
+  cout << " encode stream: " << mb/tm.real() << " MB/s" << endl;
+
+  tm.reset();
+  tm.start();
+  xcdr.encode(nbytes,&a[0],&b[0]);
+  xcdr.print(nchars,&b[0],devnull);
+  tm.stop();
+  cout << " encode+print:  " << mb/tm.real() << " MB/s" << endl;
+
+  tm.reset();
+  tm.start();
+  xcdr.decode(nchars,&b[0],&c[0]);
+  tm.stop();
+  cout << " decode:        " << mb/tm.real() << " MB/s" << endl;
+  assert(a == c);
+
+  ostringstream os;
+  xcdr.encode(nbytes,&a[0],os);
+  const string sb = os.str();
+  tm.reset();
+  tm.start();
+  xcdr.decode(sb.size(),sb.c_str(),&c[0]);
+  tm.stop();
+  cout << " decode lines:  " << mb/tm.real() << " MB/s" << endl;
+  assert(a == c);
+
   cout << " done" << endl;
-  
+
   return 0;
 }
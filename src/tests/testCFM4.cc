@@ -0,0 +1,365 @@
+////////////////////////////////////////////////////////////////////////////////  
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC. 
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory. 
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008 
+// LLNL-CODE-635376. All rights reserved. 
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// testCFM4.C
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#include <qball/CFM4WavefunctionStepper.h>
+#include <iostream>
+#include <iomanip>
+#include <complex>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+using namespace std;
+
+// use: testCFM4
+// 1. checks the history helpers of CFM4WavefunctionStepper: a cubic in t
+//    stored after steps of different lengths is mixed into the exact
+//    values 2 (w1 f(t + c1 dt) + w2 f(t + c2 dt)) of the two exponentials,
+//    and a shorter history into those of a polynomial of lower degree
+// 2. checks the order of the CFM4 step on a model of n levels with a
+//    self-consistent potential, H = H0 + g <psi|W|psi> V + E(t) X, using
+//    the same helpers and a fourth-order Taylor exponential. The error at
+//    t = tmax against an RK4 reference is computed for dt, dt/2, dt/4 and
+//    dt/8 with
+//     A: no field, started with the ETRS predictor steps
+//     B: E(t) = e0 sin(omega t), with the history of the steps before t = 0
+
+typedef complex<double> zc;
+typedef vector<zc> zvec;
+
+const int n = 4;
+const double g = 0.8;
+const double e0 = 0.5;
+const double omega = 1.3;
+const double tmax = 2.0;
+vector<zc> h0(n*n), wm(n*n), vm(n*n), xm(n*n);
+
+////////////////////////////////////////////////////////////////////////////////
+void hermitian(vector<zc>& a)
+{
+  for ( int i = 0; i < n; i++ )
+    for ( int j = 0; j <= i; j++ )
+    {
+      zc z(rand()/(double)RAND_MAX-0.5,rand()/(double)RAND_MAX-0.5);
+      if ( i == j ) z = zc(2.0*real(z)+i,0.0);
+      a[i*n+j] = z;
+      a[j*n+i] = conj(z);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+zvec mult(const vector<zc>& a, const zvec& x)
+{
+  zvec y(n);
+  for ( int i = 0; i < n; i++ )
+    for ( int j = 0; j < n; j++ )
+      y[i] += a[i*n+j] * x[j];
+  return y;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double potential(const zvec& psi)
+{
+  const zvec wpsi = mult(wm,psi);
+  zc s;
+  for ( int i = 0; i < n; i++ )
+    s += conj(psi[i]) * wpsi[i];
+  return g * real(s);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double efield(double t, bool field)
+{
+  return field ? e0 * sin(omega*t) : 0.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+zvec hpsi(double v, double e, const zvec& psi)
+{
+  zvec y = mult(h0,psi);
+  const zvec ypv = mult(vm,psi);
+  const zvec ypx = mult(xm,psi);
+  for ( int i = 0; i < n; i++ )
+    y[i] += v * ypv[i] + e * ypx[i];
+  return y;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+zvec rhs(double t, const zvec& psi, bool field)
+{
+  zvec y = hpsi(potential(psi),efield(t,field),psi);
+  for ( int i = 0; i < n; i++ )
+    y[i] *= zc(0.0,-1.0);
+  return y;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+zvec rk4(zvec psi, double t0, double t1, bool field)
+{
+  const int nstep = (int) ( fabs(t1-t0) / 1.e-4 + 0.5 );
+  const double h = ( t1 - t0 ) / nstep;
+  for ( int istep = 0; istep < nstep; istep++ )
+  {
+    const double t = t0 + istep * h;
+    zvec k1 = rhs(t,psi,field), y(n);
+    for ( int i = 0; i < n; i++ ) y[i] = psi[i] + 0.5*h*k1[i];
+    zvec k2 = rhs(t+0.5*h,y,field);
+    for ( int i = 0; i < n; i++ ) y[i] = psi[i] + 0.5*h*k2[i];
+    zvec k3 = rhs(t+0.5*h,y,field);
+    for ( int i = 0; i < n; i++ ) y[i] = psi[i] + h*k3[i];
+    zvec k4 = rhs(t+h,y,field);
+    for ( int i = 0; i < n; i++ )
+      psi[i] += h/6.0 * ( k1[i] + 2.0*k2[i] + 2.0*k3[i] + k4[i] );
+  }
+  return psi;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// exp(-i dt H) psi, fourth-order Taylor expansion in one step
+zvec exponential(double v, double e, double dt, const zvec& psi)
+{
+  zvec y = psi, term = psi;
+  for ( int k = 1; k <= 4; k++ )
+  {
+    term = hpsi(v,e,term);
+    for ( int i = 0; i < n; i++ )
+    {
+      term[i] *= zc(0.0,-dt/k);
+      y[i] += term[i];
+    }
+  }
+  return y;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ETRS step, as ExponentialWavefunctionStepper with the field at t
+zvec etrs(double dt, double e, const zvec& psi)
+{
+  const double v = potential(psi);
+  const zvec half = exponential(v,e,0.5*dt,psi);
+  const zvec pred = exponential(v,e,0.5*dt,half);
+  return exponential(potential(pred),e,0.5*dt,half);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// cubic test function of s = (t' - t)/dt
+D3vector cubic(double s)
+{
+  return D3vector(1.0 - 0.5*s, s*s + 0.25*s*s*s, 2.0 - s*s*s);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// 2 (w1 s^m(c1) + w2 s^m(c2)) for m = 0..3 and the two exponentials
+const double moment[2][4] = { { 1.0, 1.0/6.0, 0.0, -1.0/36.0 },
+                              { 1.0, 5.0/6.0, 2.0/3.0, 19.0/36.0 } };
+
+////////////////////////////////////////////////////////////////////////////////
+int check_history(void)
+{
+  int status = 0;
+  const double tddt = 0.1;
+  const double steps[3] = { 0.07, 0.13, 0.09 };
+  vector<double> step(3,tddt);
+  vector<D3vector> h(4,D3vector(0.0,0.0,0.0));
+  double x[4];
+
+  // values at t-0.29, t-0.22, t-0.09 and t, the step to t+tddt comes next
+  double t = -0.29;
+  for ( int k = 0; k < 4; k++ )
+  {
+    CFM4WavefunctionStepper::push_history(h,cubic(t/tddt));
+    if ( k < 3 )
+    {
+      CFM4WavefunctionStepper::push_history(step,steps[k]);
+      t += steps[k];
+    }
+  }
+  CFM4WavefunctionStepper::history_times(step,tddt,x);
+  const double xref[4] = { -2.9, -2.2, -0.9, 0.0 };
+  for ( int k = 0; k < 4; k++ )
+    if ( fabs(x[k]-xref[k]) > 1.e-12 )
+    {
+      cout << " history_times: x[" << k << "] = " << x[k] << ", exact "
+           << xref[k] << endl;
+      status = 1;
+    }
+
+  // the exponentials see the cubic at the nodes
+  double coef[2][4];
+  CFM4WavefunctionStepper::node_weights(4,x,coef);
+  for ( int iexp = 0; iexp < 2; iexp++ )
+  {
+    const double* m = moment[iexp];
+    const D3vector ref(m[0] - 0.5*m[1], m[2] + 0.25*m[3], 2.0*m[0] - m[3]);
+    const D3vector mix =
+      CFM4WavefunctionStepper::mix_history(4,coef[iexp],h);
+    cout << " cubic history, exponential " << iexp << ": " << mix
+         << "  exact: " << ref << endl;
+    if ( length(mix - ref) > 1.e-12 )
+      status = 1;
+  }
+
+  // at the start of a run only the last nhist values are used: they give
+  // the exact mix for a polynomial of degree nhist-1
+  for ( int nhist = 1; nhist < 4; nhist++ )
+  {
+    for ( int k = 0; k < 4; k++ )
+    {
+      // s^(nhist-1) in the x component
+      const double p = pow(x[k],nhist-1);
+      CFM4WavefunctionStepper::push_history(h,D3vector(p,0.0,0.0));
+    }
+    CFM4WavefunctionStepper::node_weights(nhist,&x[4-nhist],coef);
+    for ( int iexp = 0; iexp < 2; iexp++ )
+    {
+      const D3vector mix =
+        CFM4WavefunctionStepper::mix_history(nhist,coef[iexp],h);
+      if ( fabs(mix.x - moment[iexp][nhist-1]) > 1.e-12 )
+      {
+        cout << " history of " << nhist << " steps, exponential " << iexp
+             << ": " << mix.x << ", exact " << moment[iexp][nhist-1] << endl;
+        status = 1;
+      }
+    }
+  }
+  if ( status )
+    cout << " history helpers failed" << endl;
+  return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double run(double dt, bool field, const zvec& psi0)
+{
+  // history of the potential and the field of the last four steps
+  vector<double> vh(4,0.0), eh(4,0.0), step(3,dt);
+  int nhist = 0;
+  zvec psi = psi0;
+  if ( field )
+    for ( int k = 3; k > 0; k-- )
+    {
+      const zvec p = rk4(psi0,0.0,-k*dt,field);
+      CFM4WavefunctionStepper::push_history(vh,potential(p));
+      CFM4WavefunctionStepper::push_history(eh,efield(-k*dt,field));
+      nhist++;
+    }
+
+  const int nstep = (int) ( tmax / dt + 0.5 );
+  for ( int istep = 0; istep < nstep; istep++ )
+  {
+    const double t = istep * dt;
+    CFM4WavefunctionStepper::push_history(vh,potential(psi));
+    CFM4WavefunctionStepper::push_history(eh,efield(t,field));
+    nhist = min(nhist+1,4);
+    double x[4];
+    CFM4WavefunctionStepper::history_times(step,dt,x);
+    double coef_hist[2][4], coef_v[2][4];
+    CFM4WavefunctionStepper::node_weights(nhist,&x[4-nhist],coef_hist);
+
+    vector<double> vpts;
+    if ( nhist == 4 )
+    {
+      vpts = vh;
+      CFM4WavefunctionStepper::node_weights(4,x,coef_v);
+    }
+    else
+    {
+      // predictor: two ETRS steps of dt/2
+      const zvec p1 = etrs(0.5*dt,eh[3],psi);
+      const zvec p2 = etrs(0.5*dt,eh[3],p1);
+      vpts.push_back(vh[3]);
+      vpts.push_back(potential(p1));
+      vpts.push_back(potential(p2));
+      const double xp[3] = { 0.0, 0.5, 1.0 };
+      CFM4WavefunctionStepper::node_weights(3,xp,coef_v);
+    }
+
+    for ( int iexp = 0; iexp < 2; iexp++ )
+    {
+      double vmix = 0.0, emix = 0.0;
+      for ( int k = 0; k < vpts.size(); k++ )
+        vmix += coef_v[iexp][k] * vpts[k];
+      for ( int k = 0; k < nhist; k++ )
+        emix += coef_hist[iexp][k] * eh[4-nhist+k];
+      psi = exponential(vmix,emix,0.5*dt,psi);
+    }
+    CFM4WavefunctionStepper::push_history(step,dt);
+  }
+
+  const zvec ref = rk4(psi0,0.0,tmax,field);
+  double err = 0.0;
+  for ( int i = 0; i < n; i++ )
+    err += norm(psi[i]-ref[i]);
+  return sqrt(err);
+}
+
+int main(int argc, char** argv)
+{
+  srand(7);
+  hermitian(h0);
+  hermitian(wm);
+  hermitian(vm);
+  hermitian(xm);
+  zvec psi0(n);
+  double s = 0.0;
+  for ( int i = 0; i < n; i++ )
+  {
+    psi0[i] = zc(rand()/(double)RAND_MAX,rand()/(double)RAND_MAX);
+    s += norm(psi0[i]);
+  }
+  for ( int i = 0; i < n; i++ )
+    psi0[i] /= sqrt(s);
+
+  int status = check_history();
+  for ( int icase = 0; icase < 2; icase++ )
+  {
+    const bool field = ( icase == 1 );
+    cout << ( field ? " B: sine field" : " A: no field, predictor start" )
+         << endl;
+    double dt = 0.05;
+    double err_prev = run(dt,field,psi0);
+    cout << "  dt = " << setw(8) << dt << "  error = " << err_prev << endl;
+    double order = 0.0;
+    for ( int i = 0; i < 3; i++ )
+    {
+      dt *= 0.5;
+      const double err = run(dt,field,psi0);
+      order = log(err_prev/err) / log(2.0);
+      cout << "  dt = " << setw(8) << dt << "  error = " << err
+           << "  order = " << order << endl;
+      err_prev = err;
+    }
+    if ( order < 3.8 )
+    {
+      cout << "  order too low" << endl;
+      status = 1;
+    }
+  }
+
+  return status;
+}
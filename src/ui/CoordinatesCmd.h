@@ -34,6 +34,7 @@
 #include <string>
 #include <cstdlib>
 #include <iostream>
+#include <sstream>
 #include <cstdlib>
 using namespace std;
 
@@ -91,12 +92,13 @@ private:
       pos_unit_name = "bohr";
     }
     
-    std::ifstream file(filename.c_str());
-
-    if(!file){
+    // the file is read on one task and broadcast to all
+    string contents;
+    if(!s->ctxt_.file_bcast(filename, contents)){
       ui->error("CoordinateCmd: Cannot open coordinates file '" + filename + "'.");
       return 1;
     }
+    std::istringstream file(contents);
 
     int natoms;
     file >> natoms;
@@ -38,19 +38,25 @@
 #include "fstream"
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <algorithm>
 //ewd DEBUG
 #include <qball/SlaterDet.h>
 #include <qball/Wavefunction.h>
+#include <qball/TDState.h>
 //ewd DEBUG
 using namespace std;
 
+static const char* const load_usage =
+  "  <!-- use: load [-dump|-fast|-states|-mpiio|-proj|-proj2nd|-full|-text|-xml]"
+  " [-states i:j] [-kpoints k0,k1,...] [-vel] [-serial] filename -->";
+
 ////////////////////////////////////////////////////////////////////////////////
 int LoadCmd::action(int argc, char **argv) {
 
-  if ( !(argc>=2 && argc<=4 ) ) {
+  if ( !(argc>=2 && argc<=9 ) ) {
     if ( ui->oncoutpe() )
-      cout << "  <!-- use: load [-dump|-fast|-states|-proj|-proj2nd|-text|-xml] [-serial] filename -->" 
-           << endl;
+      cout << load_usage << endl;
     return 1;
   }
   
@@ -59,11 +65,56 @@ int LoadCmd::action(int argc, char **argv) {
   char* filename = 0;
   bool serial = false;
   bool readvel = false;
+  // -states i:j and -kpoints k0,k1,... read part of a states/mpiio checkpoint
+  CheckpointSlice slice;
+  bool encoding_set = false;
   
   // parse arguments
   for ( int i = 1; i < argc; i++ ) {
     string arg(argv[i]);
     
+    if ( arg=="-states" && i < argc-2 && string(argv[i+1]).find(':') != string::npos ) {
+      string range(argv[++i]);
+      int n0 = -1, n1 = -1;
+      char sep = 0;
+      istringstream iss(range);
+      if ( !(iss >> n0 >> sep >> n1) || sep != ':' || n0 < 0 || n1 < n0 ) {
+        if ( ui->oncoutpe() )
+          cout << "  <!-- load: invalid state range " << range << " -->" << endl;
+        return 1;
+      }
+      slice.nfirst = n0;
+      slice.nlast = n1;
+      if ( !encoding_set )
+        encoding = "states";
+      continue;
+    }
+    if ( arg=="-kpoints" ) {
+      if ( i >= argc-2 ) {
+        if ( ui->oncoutpe() )
+          cout << "  <!-- load: -kpoints needs a k-point list before the filename -->"
+               << endl;
+        return 1;
+      }
+      string list(argv[++i]);
+      replace(list.begin(),list.end(),',',' ');
+      istringstream iss(list);
+      int k;
+      while ( iss >> k )
+        slice.kplist.push_back(k);
+      if ( slice.kplist.empty() || !iss.eof() ||
+           *min_element(slice.kplist.begin(),slice.kplist.end()) < 0 ) {
+        if ( ui->oncoutpe() )
+          cout << "  <!-- load: invalid k-point list " << argv[i] << " -->" << endl;
+        return 1;
+      }
+      if ( !encoding_set )
+        encoding = "states";
+      continue;
+    }
+    if ( arg[0] == '-' && arg != "-vel" && arg != "-serial" )
+      encoding_set = true;
+
     if ( arg=="-text" )
       encoding = "text";
     else if ( arg=="-dump" )
@@ -72,6 +123,8 @@ int LoadCmd::action(int argc, char **argv) {
       encoding = "fast";
     else if ( arg=="-states" )
       encoding = "states";
+    else if ( arg=="-mpiio" )
+      encoding = "mpiio";
     else if ( arg=="-proj" )
       encoding = "proj";
     else if ( arg=="-proj2nd" )
@@ -90,19 +143,31 @@ int LoadCmd::action(int argc, char **argv) {
       filename = argv[i];
     else {
       if ( ui->oncoutpe() )
-        cout << "  <!-- use: load [-dump|-states|-text|-xml] [-serial] filename -->" 
-             << endl;
+        cout << load_usage << endl;
       return 1;
     }
   }
   
   if ( filename == 0 ) {
     if ( ui->oncoutpe() )
-      cout << "  <!-- use: load [-dump|-states|-text|-xml] [-serial] filename -->" 
+      cout << load_usage << endl;
+    return 1;
+  }
+
+  // dump and fast checkpoints store whole per-task blocks, only the per-state
+  // files and the indexed mpiio file can be read in part
+  if ( !slice.all() && encoding != "states" && encoding != "mpiio" &&
+       encoding != "proj" && encoding != "proj2nd" && encoding != "full" ) {
+    if ( ui->oncoutpe() )
+      cout << "  <!-- load: -states i:j and -kpoints need a -states or -mpiio checkpoint -->"
            << endl;
     return 1;
   }
 
+  // a checkpoint may still be written in the background (save_async),
+  // by this or any other task
+  s->wait_for_checkpoints();
+
   Timer loadtm;
   loadtm.start();
 
@@ -161,20 +226,19 @@ int LoadCmd::action(int argc, char **argv) {
              rhorfile = filestr + ".s" + oss.str() + ".lastrhor";
           }
 
+          // only pe0 reads the file, the other pes learn from it whether
+          // the file exists
           int file_exists = 0;
-          if (wfctxt->myrow() == 0) {
+          if (wfctxt->onpe0()) {
              is.open(rhorfile.c_str(),ifstream::binary);
              if (is.is_open()) 
                 file_exists = 1;
              else 
                 file_exists = -1;
-             
-             // send file_exists flag to other pes in column
-             for ( int i = 0; i < wfctxt->nprow(); i++ ) {
-                wfctxt->isend(1,1,&file_exists,1,i,wfctxt->mycol());
-             }
+             wfctxt->ibcast_send(1,1,&file_exists,1);
           }
-          wfctxt->irecv(1,1,&file_exists,1,0,wfctxt->mycol());
+          else
+             wfctxt->ibcast_recv(1,1,&file_exists,1,0,0);
           if (file_exists == 1) { 
              // send local charge density size from each pe in column to row 0
              if (wfctxt->mycol() == 0) {
@@ -220,7 +284,7 @@ int LoadCmd::action(int argc, char **argv) {
              if ( ui->oncoutpe() )
                 cout << "<!-- LoadCmd: mixed charge density checkpoint file not found. -->" << endl;
           }
-          if (wfctxt->myrow() == 0) 
+          if (wfctxt->onpe0()) 
              is.close();
        }
     }
@@ -300,20 +364,19 @@ int LoadCmd::action(int argc, char **argv) {
              rhorfile = filestr + ".s" + oss.str() + ".lastrhor";
           }
 
+          // only pe0 reads the file, the other pes learn from it whether
+          // the file exists
           int file_exists = 0;
-          if (wfctxt->myrow() == 0) {
+          if (wfctxt->onpe0()) {
              is.open(rhorfile.c_str(),ifstream::binary);
              if (is.is_open()) 
                 file_exists = 1;
              else 
                 file_exists = -1;
-             
-             // send file_exists flag to other pes in column
-             for ( int i = 0; i < wfctxt->nprow(); i++ ) {
-                wfctxt->isend(1,1,&file_exists,1,i,wfctxt->mycol());
-             }
+             wfctxt->ibcast_send(1,1,&file_exists,1);
           }
-          wfctxt->irecv(1,1,&file_exists,1,0,wfctxt->mycol());
+          else
+             wfctxt->ibcast_recv(1,1,&file_exists,1,0,0);
           if (file_exists == 1) { 
              // send local charge density size from each pe in column to row 0
              if (wfctxt->mycol() == 0) {
@@ -359,7 +422,7 @@ int LoadCmd::action(int argc, char **argv) {
              if ( ui->oncoutpe() )
                 cout << "<!-- LoadCmd: mixed charge density checkpoint file not found. -->" << endl;
           }
-          if (wfctxt->myrow() == 0) 
+          if (wfctxt->onpe0()) 
              is.close();
        }
     }
@@ -386,9 +449,13 @@ int LoadCmd::action(int argc, char **argv) {
         cout << "<!-- LoadCmd:  serial flag only used with xml input, ignoring. -->" << endl;
   }
   /////  STATES CHECKPOINTING  /////
-  else if (encoding == "states" ) {
-     s->wf.read_states(filestr);
-     s->wf.read_mditer(filestr,s->ctrl.mditer);
+  else if (encoding == "states" || encoding == "mpiio" ) {
+     if (encoding == "mpiio")
+        s->wf.read_mpiio(filestr,s->ctrl.mditer,&slice);
+     else {
+        s->wf.read_states(filestr,&slice);
+        s->wf.read_mditer(filestr,s->ctrl.mditer);
+     }
      if ( ui->oncoutpe())
         cout << "<!-- LoadCmd:  setting MD iteration count to " << s->ctrl.mditer << ". -->" << endl;       
 
@@ -406,7 +473,31 @@ int LoadCmd::action(int argc, char **argv) {
           (*s->hamil_wf).update_occ(0.0,0);
           //s->hamil_wf->clear();
         }
-        s->hamil_wf->read_states(hamwffile);
+        if (encoding == "mpiio") {
+          int mditer = 0;
+          s->hamil_wf->read_mpiio(hamwffile,mditer,&slice);
+        }
+        else
+          s->hamil_wf->read_states(hamwffile,&slice);
+
+        // propagator history written with TD checkpoints, if present
+        TDState* tdstate = new TDState();
+        if ( tdstate->read(filestr + ".tdstate",s->wf.context(),s->wf.layout()) )
+        {
+          if ( tdstate->has_wfv && encoding == "states" )
+          {
+            if ( s->wfv == 0 )
+              s->wfv = new Wavefunction(s->wf);
+            s->wfv->read_states(filestr + "wfv",&slice);
+          }
+          delete s->tdstate;
+          s->tdstate = tdstate;
+          if ( ui->oncoutpe() )
+            cout << "<!-- LoadCmd:  TD propagator history loaded, " << tdstate->wf_dyn
+                 << " step " << tdstate->tdstep << ". -->" << endl;
+        }
+        else
+          delete tdstate;
     }
     else
     {
@@ -439,20 +530,19 @@ int LoadCmd::action(int argc, char **argv) {
              rhorfile = filestr + ".s" + oss.str() + ".lastrhor";
           }
 
+          // only pe0 reads the file, the other pes learn from it whether
+          // the file exists
           int file_exists = 0;
-          if (wfctxt->myrow() == 0) {
+          if (wfctxt->onpe0()) {
              is.open(rhorfile.c_str(),ifstream::binary);
              if (is.is_open()) 
                 file_exists = 1;
              else 
                 file_exists = -1;
-
-             // send file_exists flag to other pes in column
-             for ( int i = 0; i < wfctxt->nprow(); i++ ) {
-                wfctxt->isend(1,1,&file_exists,1,i,wfctxt->mycol());
-             }
+             wfctxt->ibcast_send(1,1,&file_exists,1);
           }
-          wfctxt->irecv(1,1,&file_exists,1,0,wfctxt->mycol());
+          else
+             wfctxt->ibcast_recv(1,1,&file_exists,1,0,0);
           if (file_exists == 1) { 
              // send local charge density size from each pe in column to row 0
              if (wfctxt->mycol() == 0) {
@@ -499,7 +589,7 @@ int LoadCmd::action(int argc, char **argv) {
              if ( ui->oncoutpe() )
                 cout << "<!-- LoadCmd: mixed charge density checkpoint file not found. -->" << endl;
           }
-          if (wfctxt->myrow() == 0) 
+          if (wfctxt->onpe0()) 
              is.close();
        }
     }
@@ -513,7 +603,12 @@ int LoadCmd::action(int argc, char **argv) {
           s->wfv = new Wavefunction(s->wf);
           s->wfv->clear();
         }
-        s->wfv->read_states(wfvfile);
+        if (encoding == "mpiio") {
+          int mditer = 0;
+          s->wfv->read_mpiio(wfvfile,mditer,&slice);
+        }
+        else
+          s->wfv->read_states(wfvfile,&slice);
       }
       else {
         if ( ui->oncoutpe() )
@@ -531,14 +626,14 @@ int LoadCmd::action(int argc, char **argv) {
   new Wavefunction(s->wf);
   s->proj_wf = new Wavefunction(s->wf);
   *(s->proj_wf) = s->wf;
-  (*(s->proj_wf)).read_states(filestr);
+  (*(s->proj_wf)).read_states(filestr,&slice);
   }
 
  if (encoding == "full") {
   //new Wavefunction(s->wf);
   //s->proj_wf = new Wavefunction(s->wf);
   //(s->proj_wf) = s->wf;
-  (*(s->proj_wf_virtual)).read_states(filestr);
+  (*(s->proj_wf_virtual)).read_states(filestr,&slice);
   }
 
   //////  2nd proj ///////
@@ -546,7 +641,7 @@ int LoadCmd::action(int argc, char **argv) {
   new Wavefunction(s->wf);
   s->proj2nd_wf = new Wavefunction(s->wf);
   *(s->proj2nd_wf) = s->wf;
-  (*(s->proj2nd_wf)).read_states(filestr);
+  (*(s->proj2nd_wf)).read_states(filestr,&slice);
   }
 
   /////  OLD STATES CHECKPOINTING  /////
@@ -603,20 +698,19 @@ int LoadCmd::action(int argc, char **argv) {
              rhorfile = filestr + ".s" + oss.str() + ".lastrhor";
           }
 
+          // only pe0 reads the file, the other pes learn from it whether
+          // the file exists
           int file_exists = 0;
-          if (wfctxt->myrow() == 0) {
+          if (wfctxt->onpe0()) {
              is.open(rhorfile.c_str(),ifstream::binary);
              if (is.is_open()) 
                 file_exists = 1;
              else 
                 file_exists = -1;
-
-             // send file_exists flag to other pes in column
-             for ( int i = 0; i < wfctxt->nprow(); i++ ) {
-                wfctxt->isend(1,1,&file_exists,1,i,wfctxt->mycol());
-             }
+             wfctxt->ibcast_send(1,1,&file_exists,1);
           }
-          wfctxt->irecv(1,1,&file_exists,1,0,wfctxt->mycol());
+          else
+             wfctxt->ibcast_recv(1,1,&file_exists,1,0,0);
           if (file_exists == 1) { 
              // send local charge density size from each pe in column to row 0
              if (wfctxt->mycol() == 0) {
@@ -663,7 +757,7 @@ int LoadCmd::action(int argc, char **argv) {
              if ( ui->oncoutpe() )
                 cout << "<!-- LoadCmd: mixed charge density checkpoint file not found. -->" << endl;
           }
-          if (wfctxt->myrow() == 0) 
+          if (wfctxt->onpe0()) 
              is.close();
        }
     }
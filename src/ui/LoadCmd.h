@@ -53,9 +53,13 @@ class LoadCmd : public Cmd
   {
     return 
     "\n load\n\n"
-    " syntax: load [-serial] filename \n\n"
+    " syntax: load [-serial] filename \n"
+    "         load [-states i:j] [-kpoints k0,k1,...] [-mpiio] filename \n\n"
     "   The load command loads a sample from the file filename.\n"
-    "   The -serial option bypasses the parallel load algorithm.\n\n";
+    "   The -serial option bypasses the parallel load algorithm.\n"
+    "   -states i:j and -kpoints read states i to j and the listed\n"
+    "   k-points of a states or mpiio checkpoint into the states and\n"
+    "   k-points of the current wavefunction.\n\n";
   }
 
   int action(int argc, char **argv);
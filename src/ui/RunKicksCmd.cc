@@ -0,0 +1,162 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// RunKicksCmd.cc:
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+#include "RunKicksCmd.h"
+#include<iostream>
+#include <qball/EhrenSampleStepper.h>
+#include <qball/SlaterDet.h>
+#include<cassert>
+#include<string>
+#include<vector>
+using namespace std;
+
+int RunKicksCmd::action(int argc, char **argv)
+{
+  if ( argc != 3 && argc != 4 )
+  {
+    if ( ui->oncoutpe() )
+      cout << " use: run_kicks niter e_strength [directions]" << endl;
+    return 1;
+  }
+
+  if (s->ctrl.timer_hit) {
+    if ( ui->oncoutpe() )
+      cout << " <!-- RunKicksCmd: run_timer exceeded in previous run, skipping current run command. -->" << endl;
+    return 0;
+  }
+
+  if ( !s->ctrl.tddft_involved )
+  {
+    if ( ui->oncoutpe() )
+      cout << "<ERROR> run_kicks requires a TD wf_dyn </ERROR>" << endl;
+    return 1;
+  }
+
+  Wavefunction& wf = s->wf;
+  if ( wf.nst() == 0 || !wf.hasdata() )
+  {
+    if ( ui->oncoutpe() )
+      cout << " <!-- RunKicksCmd: no ground state wavefunction, cannot run -->" << endl;
+    return 1;
+  }
+
+  if (wf.nkp() > 1 || wf.kpoint(0) != D3vector(0,0,0)) {
+    if ( ui->oncoutpe() )
+      cout << "<ERROR> run_kicks command only works for gamma-point calculations! </ERROR>" << endl;
+    return 1;
+  }
+
+  if (not wf.force_complex_set()) {
+    if ( ui->oncoutpe() )
+      cout << "<ERROR> run_kicks command only works for complex wavefunction calculations! </ERROR>" << endl;
+    return 1;
+  }
+
+  const int niter = atoi(argv[1]);
+  const double e_strength = atof(argv[2]);
+  const string dirs = ( argc == 4 ) ? argv[3] : "xyz";
+  vector<int> e_direction;
+  for ( int i = 0; i < dirs.size(); i++ )
+  {
+    if ( dirs[i] < 'x' || dirs[i] > 'z' )
+    {
+      if ( ui->oncoutpe() )
+        cout << "<ERROR> run_kicks: directions must be a combination of x, y and z </ERROR>" << endl;
+      return 1;
+    }
+    e_direction.push_back(dirs[i] - 'x');
+  }
+
+  if (s->hamil_wf == 0)
+  {
+    s->hamil_wf = new Wavefunction(wf);
+    (*s->hamil_wf) = wf;
+    (*s->hamil_wf).update_occ(0.0,0);
+  }
+
+  // state shared by all perturbations. mditer is not reset between the
+  // directions: the savefreq, savedenfreq and NTO files and the steps of
+  // the observable log of each direction keep distinct numbers
+  Wavefunction wf0(wf);
+  wf0 = wf;
+  vector<vector<double> > tau0, vel0;
+  s->atoms.get_positions(tau0);
+  s->atoms.get_velocities(vel0);
+  // the previous wavefunction of SOTD is set aside: each direction starts
+  // its propagation without one
+  Wavefunction* wfv0 = s->wfv;
+  s->wfv = 0;
+
+  for ( int idir = 0; idir < e_direction.size(); idir++ )
+  {
+    if ( idir > 0 )
+    {
+      wf = wf0;
+      s->atoms.set_positions(tau0);
+      s->atoms.set_velocities(vel0);
+      delete s->wfv;
+      s->wfv = 0;
+    }
+    for ( int ispin = 0; ispin < wf.nspin(); ispin++ )
+      if ( wf.spinactive(ispin) )
+        wf.sd(ispin,0)->apply_electric_field(e_direction[idir],e_strength,-1);
+    (*s->hamil_wf) = wf;
+
+    SampleStepper* stepper = new EhrenSampleStepper(*s,1,0);
+    assert(stepper!=0);
+
+    if (ui->oncoutpe() )
+    {
+      cout << "<kick direction=\"" << dirs[idir] << "\" e_strength=\""
+           << e_strength << "\" first_mditer=\"" << s->ctrl.mditer + 1
+           << "\">" << endl;
+      cout << "<run niter_ionic=\"" << niter << "\">" << endl;
+    }
+    wf.info(cout,"wavefunction");
+    stepper->step(niter);
+    if (ui->oncoutpe() )
+    {
+      cout << "</run>" << endl;
+      cout << "</kick>" << endl;
+    }
+    delete stepper;
+
+    if (s->ctrl.timer_hit)
+      break;
+  }
+
+  wf = wf0;
+  (*s->hamil_wf) = wf;
+  s->atoms.set_positions(tau0);
+  s->atoms.set_velocities(vel0);
+  delete s->wfv;
+  s->wfv = wfv0;
+
+  return 0;
+}
@@ -0,0 +1,70 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// RunKicksCmd.h:
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#ifndef RUNKICKSCMD_H
+#define RUNKICKSCMD_H
+
+#include <iostream>
+#include <ui/UserInterface.h>
+#include <qball/Sample.h>
+
+class RunKicksCmd : public Cmd
+{
+  private:
+
+  public:
+
+  Sample *s;
+
+  RunKicksCmd(Sample *sample) : s(sample) {};
+
+  char const*name(void) const { return "run_kicks"; }
+  char const*help_msg(void) const
+  {
+    return 
+    "\n run_kicks\n\n"
+    " syntax: run_kicks niter e_strength [directions]\n\n"
+    "   The run_kicks command propagates one delta-kicked copy of the\n"
+    "   current state for each direction (default xyz) for niter TD\n"
+    "   steps. Every copy starts from the same wavefunction, ionic\n"
+    "   positions and velocities, and its output is enclosed in a\n"
+    "   <kick direction=...> element. The step count (mditer) runs on\n"
+    "   across the directions, so that the files written with savefreq,\n"
+    "   savedenfreq, etc. by each direction have distinct numbers.\n"
+    "   The directions are propagated one after the other, so the cost\n"
+    "   is that of one run per direction; the command saves the setup\n"
+    "   and restart of separate jobs. The initial wavefunction, ions\n"
+    "   and, for SOTD, previous wavefunction are restored at the end.\n\n";
+  }
+
+  int action(int argc, char **argv);
+
+};
+#endif
@@ -39,6 +39,7 @@
 #include <qball/ChargeDensity.h>
 #include <qball/FourierTransform.h>
 #include <qball/Wavefunction.h>
+#include <qball/CheckpointCompressor.h>
 #include <qball/EnergyFunctional.h>
 #include <qball/AtomSet.h>
 #include <qball/release.h>
@@ -64,6 +65,7 @@ int SaveCmd::action(int argc, char **argv) {
       cout << "  <!--       -dump:  one binary file for each process                 -->" << endl;
       cout << "  <!--       -fast:  one binary file for each I/O node                 -->" << endl;
       cout << "  <!--       -states:  one file for each state                        -->" << endl;
+      cout << "  <!--       -mpiio:  one file written with MPI-IO, any process count -->" << endl;
       cout << "  <!--       -xml:  entire system in one xml file (Gamma-point only)  -->" << endl;
       cout << "  <!--       -casino:  wavefunction in CASINO trial function format  -->" << endl;
       cout << "  <!--       -vmd:  wavefunction and density in VMD cube visualization format  -->" << endl;
@@ -95,6 +97,8 @@ int SaveCmd::action(int argc, char **argv) {
       encoding = "fast";
     else if ( arg=="-states" )
       encoding = "states";
+    else if ( arg=="-mpiio" )
+      encoding = "mpiio";
     else if ( arg=="-xml" )
       encoding = "xml";
     else if ( arg=="-casino" )
@@ -128,6 +132,7 @@ int SaveCmd::action(int argc, char **argv) {
         cout << "  <!--     encoding options:                                          -->" << endl;
         cout << "  <!--       -dump:  one binary file for each process                 -->" << endl;
         cout << "  <!--       -states:  one file for each state                        -->" << endl;
+        cout << "  <!--       -mpiio:  one file written with MPI-IO, any process count -->" << endl;
         cout << "  <!--       -xml:  entire system in one xml file (Gamma-point only)  -->" << endl;
         cout << "  <!--       -vmd:  wavefunction and density in VMD cube visualization format  -->" << endl;
         cout << "  <!--     state format options:                                      -->" << endl;
@@ -145,6 +150,7 @@ int SaveCmd::action(int argc, char **argv) {
       cout << "  <!--     encoding options:                                          -->" << endl;
       cout << "  <!--       -dump:  one binary file for each process                 -->" << endl;
       cout << "  <!--       -states:  one file for each state                        -->" << endl;
+      cout << "  <!--       -mpiio:  one file written with MPI-IO, any process count -->" << endl;
       cout << "  <!--       -xml:  entire system in one xml file (Gamma-point only)  -->" << endl;
       cout << "  <!--       -vmd:  wavefunction and density in VMD cube visualization format  -->" << endl;
       cout << "  <!--     state format options:                                      -->" << endl;
@@ -165,6 +171,10 @@ int SaveCmd::action(int argc, char **argv) {
       s->ctrl.timer_savecmd = true;
   }
   
+  // files written in the background (save_async) by any task may have
+  // the same name
+  s->wait_for_checkpoints();
+
   Timer savetm;
   savetm.start();
 
@@ -273,7 +283,8 @@ int SaveCmd::action(int argc, char **argv) {
   else if (encoding == "fast" ) {
      if ( ui->oncoutpe() )
         cout << "<!-- SaveCmd:  writing wf " << filestr << "... -->" << endl;
-     s->wf.write_fast(filestr);
+     CheckpointCompressor cmp(s->ctrl.save_compression,s->ctrl.save_compression_tol);
+     s->wf.write_fast(filestr,&cmp);
      s->wf.write_mditer(filestr,s->ctrl.mditer);
      if (s->ctrl.tddft_involved)
      {
@@ -281,7 +292,7 @@ int SaveCmd::action(int argc, char **argv) {
        string hamwffile = filestr + "hamwf";
        if ( ui->oncoutpe() )
           cout << "<!-- SaveCmd:  wf write finished, writing hamil_wf " << hamwffile << "... -->" << endl;
-       s->hamil_wf->write_fast(hamwffile);
+       s->hamil_wf->write_fast(hamwffile,&cmp);
     }
     else
     {
@@ -352,7 +363,9 @@ int SaveCmd::action(int argc, char **argv) {
       const bool compute_forces = ( atoms_dyn != "LOCKED" );
       if (compute_forces) {
         string wfvfile = filestr + "wfv";
-        s->wfv->write_fast(wfvfile);
+        // the velocities are not orthonormal, keep them exact
+        CheckpointCompressor wfvcmp(cmp.active() ? "lossless" : "OFF",0.0);
+        s->wfv->write_fast(wfvfile,&wfvcmp);
       }
       else {
         if ( ui->oncoutpe() )
@@ -370,9 +383,10 @@ int SaveCmd::action(int argc, char **argv) {
     
   }
 
-  else if (encoding == "states" ) {
-    if ( ui->oncoutpe() ) {
+  else if (encoding == "states" || encoding == "mpiio" ) {
+    if ( ui->oncoutpe() )
       cout << "<!-- SaveCmd:  writing wf " << filestr << "... -->" << endl;
+    if ( ui->oncoutpe() && encoding == "states" ) {
       string dirstr = filestr.substr(0, filestr.find_last_of('/'));
       
       int mode = 0775;
@@ -393,8 +407,14 @@ int SaveCmd::action(int argc, char **argv) {
     //this barrier insures that the directory is created before writing the states
     MPI_Barrier(MPI_COMM_WORLD);
 
-    s->wf.write_states(filestr,format);
-    s->wf.write_mditer(filestr,s->ctrl.mditer);
+    // the -mpiio file keeps fixed offsets and is never compressed
+    CheckpointCompressor cmp(s->ctrl.save_compression,s->ctrl.save_compression_tol);
+    if (encoding == "mpiio")
+      s->wf.write_mpiio(filestr,s->ctrl.mditer);
+    else {
+      s->wf.write_states(filestr,format,0,&cmp);
+      s->wf.write_mditer(filestr,s->ctrl.mditer);
+    }
 
     if (s->ctrl.tddft_involved)
     {
@@ -402,7 +422,10 @@ int SaveCmd::action(int argc, char **argv) {
        string hamwffile = filestr + "hamwf";
        if ( ui->oncoutpe() )
           cout << "<!-- SaveCmd:  wf write finished, writing hamil_wf " << hamwffile << "... -->" << endl;
-       s->hamil_wf->write_states(hamwffile,format);
+       if (encoding == "mpiio")
+         s->hamil_wf->write_mpiio(hamwffile,s->ctrl.mditer);
+       else
+         s->hamil_wf->write_states(hamwffile,format,0,&cmp);
     }
     else
     {
@@ -471,7 +494,12 @@ int SaveCmd::action(int argc, char **argv) {
       const bool compute_forces = ( atoms_dyn != "LOCKED" );
       if (compute_forces) {
         string wfvfile = filestr + "wfv";
-        s->wfv->write_states(wfvfile,format);
+        if (encoding == "mpiio")
+          s->wfv->write_mpiio(wfvfile,s->ctrl.mditer);
+        else {
+          CheckpointCompressor wfvcmp(cmp.active() ? "lossless" : "OFF",0.0);
+          s->wfv->write_states(wfvfile,format,0,&wfvcmp);
+        }
       }
       else {
         if ( ui->oncoutpe() )
@@ -36,13 +36,14 @@
 #include <qball/qbox_xmlns.h>
 #include <qball/ChargeDensity.h>
 #include <qball/FourierTransform.h>
+#include <qball/GridFile.h>
 
 using namespace std;
 
 ////////////////////////////////////////////////////////////////////////////////
 int SavedenCmd::action(int argc, char **argv) {
 
-  if ( !(argc == 2 || argc == 3) ) {
+  if ( argc < 2 ) {
     if ( ui->oncoutpe() )
       cout << "  <!-- use: saveden filename -->" << endl;
     return 1;
@@ -50,6 +51,7 @@ int SavedenCmd::action(int argc, char **argv) {
 
   char* filename = argv[1];
   string format = "vmd";
+  int stride = 1;
   for ( int i = 1; i < argc; i++ ) {
     string arg(argv[i]);
     if ( arg=="-molmol" ) 
@@ -58,15 +60,26 @@ int SavedenCmd::action(int argc, char **argv) {
       format = "gopenmol";
     else if ( arg=="-vmd" ) 
       format = "vmd";
+    else if ( arg=="-binary" )
+      format = "binary";
+    else if ( arg=="-float" )
+      format = "float";
+    else if ( arg=="-stride" && i+1 < argc && atoi(argv[i+1]) > 0 )
+      stride = atoi(argv[++i]);
     else if ( arg[0] != '-' && i == argc-1 )
       filename = argv[i];
     else {
       if ( ui->oncoutpe() )
-        cout << "  <!-- use: saveden [-binary|-molmol|-gopenmol] filename -->" 
+        cout << "  <!-- use: saveden [-vmd|-molmol|-gopenmol|-binary|-float] [-stride n] filename -->" 
              << endl;
       return 1;
     }
   }
+  if ( stride > 1 && !( format == "binary" || format == "float" ) ) {
+    if ( ui->oncoutpe() )
+      cout << "  <!-- saveden: -stride only used with -binary or -float -->" << endl;
+    return 1;
+  }
 
 
 
@@ -88,6 +101,21 @@ int SavedenCmd::action(int argc, char **argv) {
   if (s->wf.nspin() == 2 && ctxt_->oncoutpe() )
     cout << "<WARNING> saveden command only prints spin = 0 density </WARNING>" << endl;
 
+  if (format == "binary" || format == "float") {
+     // all tasks write their slab of the grid, see GridFile.h
+     GridFileHeader h;
+     h.label = "electron density";
+     h.wordsize = ( format == "float" ) ? 4 : 8;
+     h.stride = stride;
+     h.mditer = s->ctrl.mditer;
+     h.set_atoms(s->atoms);
+     vector<const double*> fields(1,cd_.rhor[0].data());
+     const UnitCell& cell = s->wf.cell();
+     GridFile::write(filename,h,fields,*ft_,*ctxt_,s->ctxt_,
+                     cell.a(0),cell.a(1),cell.a(2));
+     return 0;
+  }
+
   ofstream os;
   if ( ctxt_->oncoutpe() )
   {
@@ -51,8 +51,11 @@ class SavedenCmd : public Cmd {
   char const*help_msg(void) const {
     return 
     "\n saveden\n\n"
-    " syntax: saveden filename \n\n"
-    "   The saveden command saves the real-space charge density to file.\n\n";
+    " syntax: saveden [-vmd|-molmol|-gopenmol|-binary|-float] [-stride n] filename \n\n"
+    "   The saveden command saves the real-space charge density to file.\n"
+    "   -binary and -float write double or single precision data in\n"
+    "   parallel, -stride n keeps every n-th grid point. These files are\n"
+    "   converted to cube or VTK with qball-grid2cube.\n\n";
   }
 
   int action(int argc, char **argv);
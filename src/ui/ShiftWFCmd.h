@@ -88,6 +88,10 @@ class ShiftWFCmd : public Cmd
            ( s->ctrl.wf_dyn == "SORKTD" ) ||
            ( s->ctrl.wf_dyn == "ETRS" ) ||
            ( s->ctrl.wf_dyn == "AETRS" ) ||
+           ( s->ctrl.wf_dyn == "KRYLOV" ) ||
+           ( s->ctrl.wf_dyn == "CHEBYSHEV" ) ||
+           ( s->ctrl.wf_dyn == "CFM4" ) ||
+           ( s->ctrl.wf_dyn == "LSRK4" ) ||
            ( s->ctrl.wf_dyn == "FORKTD" ) ) && (s->hamil_wf == &(s->wf) ) )
     {
       if ( ui->oncoutpe() )
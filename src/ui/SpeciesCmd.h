@@ -89,6 +89,7 @@ class SpeciesCmd : public Cmd
       SpeciesReader sp_reader(s->ctxt_);
       
       Species* sp = new Species(s->ctxt_, argv[1]);
+      if ( s->ctrl.species_cache != "OFF" ) sp->set_cache_dir(s->ctrl.species_cache);
       
       try {
 	sp_reader.readSpecies(*sp, argv[2]);
@@ -165,6 +166,7 @@ class SpeciesCmd : public Cmd
 	SpeciesReader sp_reader(s->ctxt_);
 	
 	Species* sp = new Species(s->ctxt_, el.symbol());
+	if ( s->ctrl.species_cache != "OFF" ) sp->set_cache_dir(s->ctrl.species_cache);
 	
 	try {
 	  sp_reader.readSpecies(*sp, collection.file_path(el));
@@ -34,6 +34,7 @@
 #include <list>
 #include <unistd.h> // isatty
 #include <fstream>
+#include <sstream>
 #include <cassert>
 using namespace std;
 
@@ -99,19 +100,15 @@ char *UserInterface::readCmd(char *s, int max, istream &fp, bool echo)
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-void UserInterface::processCmds ( istream &cmdstream, char const*prompt, bool echo, bool interactive)
+bool UserInterface::nextCmd(char *cmdline, istream &cmdstream, bool echo, bool replicated)
 {
-  // read and process commands from cmdstream until end of file is reached
+  // read the next command line into cmdline, returns true at the end of
+  // cmdstream. Replicated streams are read on all tasks, otherwise the
+  // line read on task coutpe is broadcast.
+  int done;
+  if ( replicated )
+    return terminate_ || !readCmd(cmdline, 256, cmdstream, echo && ctxt_.oncoutpe() );
 
-  char cmdline[256];
-  list<Cmd*>::iterator cmd;
-  char *tok;
-  const char *separators = " ;\t";
-  int i,done,status;
-  if ( ctxt_.oncoutpe() )
-    cout << "<!-- " << prompt << " ";
-    
-  // read a command terminated by '\n' or ';'
   if ( ctxt_.oncoutpe() )
   {
     done = terminate_ || !readCmd(cmdline, 256, cmdstream, echo );
@@ -135,6 +132,35 @@ void UserInterface::processCmds ( istream &cmdstream, char const*prompt, bool ec
             
     ctxt_.ibcast_recv(1,1,&done,1,irow,icol);
   }
+  return done;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool UserInterface::processFile(const string& filename, char const*prompt, bool echo, bool interactive)
+{
+  string contents;
+  if ( !ctxt_.file_bcast(filename,contents) )
+    return false;
+  istringstream is(contents);
+  processCmds(is, prompt, echo, interactive, true);
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void UserInterface::processCmds ( istream &cmdstream, char const*prompt, bool echo, bool interactive, bool replicated)
+{
+  // read and process commands from cmdstream until end of file is reached
+
+  char cmdline[256];
+  list<Cmd*>::iterator cmd;
+  char *tok;
+  const char *separators = " ;\t";
+  int i,done,status;
+  if ( ctxt_.oncoutpe() )
+    cout << "<!-- " << prompt << " ";
+    
+  // read a command terminated by '\n' or ';'
+  done = nextCmd(cmdline, cmdstream, echo, replicated);
 
   while ( !done )
   {
@@ -223,28 +249,12 @@ void UserInterface::processCmds ( istream &cmdstream, char const*prompt, bool ec
         }
         else
         {
-          // command is not in the command list, check for script files
-          ifstream cmdstr;
-          if ( ctxt_.oncoutpe() )
-          {
-            cmdstr.open(av[0],ios::in);
-            status = !cmdstr;
-          }
-
-          if ( ctxt_.oncoutpe() ) {
-            ctxt_.ibcast_send(1,1,&status,1);
-          }
-          else {
-            // calculate row and col indices of process oncoutpe
-            int irow = ctxt_.coutpe();
-            while (irow >= ctxt_.nprow())
-              irow -= ctxt_.nprow();
-            int icol = int (ctxt_.coutpe()/ctxt_.nprow());
-            assert(ctxt_.pmap(irow,icol) == ctxt_.coutpe());
-
-            ctxt_.ibcast_recv(1,1,&status,1,irow,icol);
-          }
+          // command is not in the command list, check for script files.
+          // The script is read once and parsed on all tasks.
+          string script;
+          status = !ctxt_.file_bcast(av[0],script);
 	  if ( !status ) {
+            istringstream cmdstr(script);
             // create new prompt in the form: prompt<filename>
             char *newprompt=0;
             if ( ctxt_.oncoutpe() )
@@ -258,7 +268,7 @@ void UserInterface::processCmds ( istream &cmdstream, char const*prompt, bool ec
               // MPI: process commands on all processes.
               // Note: newprompt is 0 on all processes > 0
               // Note: echo == true for scripts
-            processCmds (cmdstr, newprompt, true);
+            processCmds (cmdstr, newprompt, true, true, true);
             if ( ctxt_.oncoutpe() )
               delete [] newprompt;
           } else {
@@ -278,30 +288,7 @@ void UserInterface::processCmds ( istream &cmdstream, char const*prompt, bool ec
     }
     
     // read a command terminated by '\n' or ';'
-    if ( ctxt_.oncoutpe() )
-    {
-      done = terminate_ || !readCmd(cmdline, 256, cmdstream, echo );
-    }
-
-    string cmdlinestr(cmdline);
-    ctxt_.string_bcast(cmdlinestr,ctxt_.coutpe());
-    cmdlinestr.copy(cmdline,cmdlinestr.length(),0);
-    cmdline[cmdlinestr.length()] = 0;
-
-    if ( ctxt_.oncoutpe() ) {
-      ctxt_.ibcast_send(1,1,&done,1);
-    }
-    else {
-      // calculate row and col indices of process oncoutpe
-      int irow = ctxt_.coutpe();
-      while (irow >= ctxt_.nprow())
-        irow -= ctxt_.nprow();
-      int icol = int (ctxt_.coutpe()/ctxt_.nprow());
-      assert(ctxt_.pmap(irow,icol) == ctxt_.coutpe());
-
-      ctxt_.ibcast_recv(1,1,&done,1,irow,icol);
-    }
-
+    done = nextCmd(cmdline, cmdstream, echo, replicated);
   }
   if ( ctxt_.oncoutpe() )          
     cout << " -->" << endl << "<!-- end of command stream -->" << endl;
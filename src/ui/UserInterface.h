@@ -74,6 +74,7 @@ class UserInterface
   bool oncoutpe_;
 
   char *readCmd(char *s, int max, istream &fp, bool echo);
+  bool nextCmd(char *cmdline, istream &cmdstream, bool echo, bool replicated);
   bool terminate_;
 
   public: 
@@ -137,7 +138,13 @@ class UserInterface
     }
   };
 
-  void processCmds(istream &cmdstream, char const*prompt, bool echo, bool interactive = true);
+  // replicated: cmdstream holds the same commands on all tasks (see
+  // processFile), otherwise it is only read on task coutpe and each
+  // command line is broadcast
+  void processCmds(istream &cmdstream, char const*prompt, bool echo, bool interactive = true, bool replicated = false);
+  // read a command file once on task coutpe and process it on all tasks,
+  // returns false if the file cannot be opened
+  bool processFile(const string& filename, char const*prompt, bool echo, bool interactive = true);
   
   void terminate(void) { terminate_ = true; };
 
@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// EnergyOutputFreq.h
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#ifndef ENERGYOUTPUTFREQ_H
+#define ENERGYOUTPUTFREQ_H
+
+#include<iostream>
+#include<iomanip>
+#include<sstream>
+#include<stdlib.h>
+
+#include <qball/Sample.h>
+
+// energy_output_freq N
+// In TD runs, the energy terms that do not enter the propagation (and the
+// ionic forces and stress when ions and cell are fixed) are only computed
+// and printed every N iterations and on the last one.
+
+class EnergyOutputFreq : public Var {
+  Sample *s;
+
+  public:
+
+  char const*name ( void ) const { return "energy_output_freq"; };
+
+  int set ( int argc, char **argv ) {
+    if ( argc != 2 ) {
+      if ( ui->oncoutpe() )
+      cout << " <ERROR> energy_output_freq takes only one value </ERROR>" << endl;
+      return 1;
+    }
+    
+    int v = atoi(argv[1]);
+    if ( v < 1 ) {
+      if ( ui->oncoutpe() )
+        cout << " <ERROR> energy_output_freq must be positive </ERROR>" << endl;
+      return 1;
+    }
+    s->ctrl.energy_output_freq = v;
+    return 0;
+  }
+
+  string print (void) const {
+     ostringstream st;
+     st.setf(ios::left,ios::adjustfield);
+     st << setw(10) << name() << " = ";
+     st.setf(ios::right,ios::adjustfield);
+     st << setw(10) << s->ctrl.energy_output_freq;
+     return st.str();
+  }
+
+  EnergyOutputFreq(Sample *sample) : s(sample) { s->ctrl.energy_output_freq = 1; };
+};
+#endif
+
+// Local Variables:
+// mode: c++
+// End:
@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// ObservableLogFile.h
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#ifndef OBSERVABLELOGFILE_H
+#define OBSERVABLELOGFILE_H
+
+#include<iostream>
+#include<iomanip>
+#include<sstream>
+#include<stdlib.h>
+
+#include <qball/Sample.h>
+#include <qball/ObservableLog.h>
+
+// observable_log filename|OFF [flush_interval] [quiet]
+// Write the observables of each step (energies, dipoles, current, vector
+// potential, projections) to a binary log, see qball/ObservableLog.h. The
+// log is written every flush_interval seconds (default 10). With quiet,
+// the logged quantities are no longer printed on the standard output.
+
+class ObservableLogFile : public Var {
+  Sample *s;
+
+  public:
+
+  char const*name ( void ) const { return "observable_log"; };
+
+  int set ( int argc, char **argv ) {
+    if ( argc < 2 || argc > 4 ) {
+      if ( ui->oncoutpe() )
+      cout << " <ERROR> observable_log takes one to three values </ERROR>" << endl;
+      return 1;
+    }
+    
+    double interval = 10.0;
+    bool quiet = false;
+    for ( int i = 2; i < argc; i++ ) {
+      string arg = argv[i];
+      char* end;
+      const double t = strtod(argv[i],&end);
+      if ( arg == "quiet" )
+        quiet = true;
+      else if ( i == 2 && *end == '\0' && t >= 0.0 )
+        interval = t;
+      else {
+        if ( ui->oncoutpe() )
+          cout << " <ERROR> use: observable_log filename|OFF [flush_interval] [quiet] </ERROR>" << endl;
+        return 1;
+      }
+    }
+
+    string v = argv[1];
+    delete s->obslog;
+    s->obslog = 0;
+    if ( v != "OFF" && ui->oncoutpe() )
+      s->obslog = new ObservableLog(v,interval);
+    s->ctrl.observable_log = v;
+    s->ctrl.observable_log_quiet = quiet && v != "OFF";
+    return 0;
+  }
+
+  string print (void) const {
+     ostringstream st;
+     st.setf(ios::left,ios::adjustfield);
+     st << setw(10) << name() << " = ";
+     st.setf(ios::right,ios::adjustfield);
+     st << setw(10) << s->ctrl.observable_log;
+     return st.str();
+  }
+
+  ObservableLogFile(Sample *sample) : s(sample)
+  {
+    s->ctrl.observable_log = "OFF";
+    s->ctrl.observable_log_quiet = false;
+  };
+};
+#endif
+
+// Local Variables:
+// mode: c++
+// End:
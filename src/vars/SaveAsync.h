@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// SaveAsync.h
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#ifndef SAVEASYNC_H
+#define SAVEASYNC_H
+
+#include<iostream>
+#include<iomanip>
+#include<sstream>
+#include<stdlib.h>
+
+#include <qball/Sample.h>
+
+// save_async ON|OFF
+// With ON, the wavefunction checkpoints of savefreq and the density files
+// of savedenfreq are copied to staging buffers and written to disk in a
+// background thread while the run continues. A checkpoint only waits for
+// the previous one to be finished.
+
+class SaveAsync : public Var {
+  Sample *s;
+
+  public:
+
+  char const*name ( void ) const { return "save_async"; };
+
+  int set ( int argc, char **argv ) {
+    if ( argc != 2 ) {
+      if ( ui->oncoutpe() )
+      cout << " <ERROR> save_async takes only one value </ERROR>" << endl;
+      return 1;
+    }
+    
+    string v = argv[1];
+    if ( !( v == "ON" || v == "OFF" ) ) {
+      if ( ui->oncoutpe() )
+        cout << " <ERROR> save_async must be ON or OFF </ERROR>" << endl;
+      return 1;
+    }
+    s->ctrl.save_async = ( v == "ON" );
+    return 0;
+  }
+
+  string print (void) const {
+     ostringstream st;
+     st.setf(ios::left,ios::adjustfield);
+     st << setw(10) << name() << " = ";
+     st.setf(ios::right,ios::adjustfield);
+     st << setw(10) << ( s->ctrl.save_async ? "ON" : "OFF" );
+     return st.str();
+  }
+
+  SaveAsync(Sample *sample) : s(sample) { s->ctrl.save_async = false; };
+};
+#endif
+
+// Local Variables:
+// mode: c++
+// End:
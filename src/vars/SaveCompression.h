@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// SaveCompression.h
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#ifndef SAVECOMPRESSION_H
+#define SAVECOMPRESSION_H
+
+#include<iostream>
+#include<iomanip>
+#include<sstream>
+#include<stdlib.h>
+
+#include <qball/Sample.h>
+
+// save_compression OFF|lossless|lossy [tol]
+// Compression of the binary wavefunction checkpoints written by save
+// (states and fast formats) and savefreq. lossless stores the exact
+// coefficients, lossy rounds them to tol times the rms magnitude of their
+// |k+G| shell (default tol = 1e-6). Compressed files get a .z suffix and are
+// recognized by load.
+
+class SaveCompression : public Var {
+  Sample *s;
+
+  public:
+
+  char const*name ( void ) const { return "save_compression"; };
+
+  int set ( int argc, char **argv ) {
+    if ( argc < 2 || argc > 3 ) {
+      if ( ui->oncoutpe() )
+      cout << " <ERROR> save_compression takes one or two values </ERROR>" << endl;
+      return 1;
+    }
+    
+    string v = argv[1];
+    if ( !( v == "OFF" || v == "lossless" || v == "lossy" ) ) {
+      if ( ui->oncoutpe() )
+        cout << " <ERROR> save_compression must be OFF, lossless or lossy </ERROR>" << endl;
+      return 1;
+    }
+    double tol = 1.e-6;
+    if ( argc == 3 ) {
+      if ( v != "lossy" ) {
+        if ( ui->oncoutpe() )
+          cout << " <ERROR> save_compression: tolerance only valid with lossy </ERROR>" << endl;
+        return 1;
+      }
+      tol = atof(argv[2]);
+      if ( tol <= 0.0 || tol >= 1.0 ) {
+        if ( ui->oncoutpe() )
+          cout << " <ERROR> save_compression tolerance must be in (0,1) </ERROR>" << endl;
+        return 1;
+      }
+    }
+    s->ctrl.save_compression = v;
+    s->ctrl.save_compression_tol = tol;
+    return 0;
+  }
+
+  string print (void) const {
+     ostringstream st;
+     st.setf(ios::left,ios::adjustfield);
+     st << setw(10) << name() << " = ";
+     st.setf(ios::right,ios::adjustfield);
+     st << setw(10) << s->ctrl.save_compression;
+     if ( s->ctrl.save_compression == "lossy" )
+       st << " " << s->ctrl.save_compression_tol;
+     return st.str();
+  }
+
+  SaveCompression(Sample *sample) : s(sample)
+  {
+    s->ctrl.save_compression = "OFF";
+    s->ctrl.save_compression_tol = 1.e-6;
+  };
+};
+#endif
+
+// Local Variables:
+// mode: c++
+// End:
@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// SaveDenFormat.h
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#ifndef SAVEDENFORMAT_H
+#define SAVEDENFORMAT_H
+
+#include<iostream>
+#include<iomanip>
+#include<sstream>
+#include<stdlib.h>
+
+#include <qball/Sample.h>
+
+// saveden_format cube|binary|float [stride]
+// Format of the files written by savedenfreq. cube is the text format
+// written by the first task. binary (double) and float (single precision)
+// are written in parallel by all tasks (see GridFile.h) and can be
+// converted with qball-grid2cube. With stride > 1 only every stride-th
+// grid point along each axis is written (binary and float only).
+
+class SaveDenFormat : public Var {
+  Sample *s;
+
+  public:
+
+  char const*name ( void ) const { return "saveden_format"; };
+
+  int set ( int argc, char **argv ) {
+    if ( argc != 2 && argc != 3 ) {
+      if ( ui->oncoutpe() )
+      cout << " <ERROR> saveden_format takes one or two values </ERROR>" << endl;
+      return 1;
+    }
+    
+    string v = argv[1];
+    if ( !( v == "cube" || v == "binary" || v == "float" ) ) {
+      if ( ui->oncoutpe() )
+        cout << " <ERROR> saveden_format must be cube, binary or float </ERROR>" << endl;
+      return 1;
+    }
+    int stride = 1;
+    if ( argc == 3 ) {
+      stride = atoi(argv[2]);
+      if ( stride < 1 || ( stride > 1 && v == "cube" ) ) {
+        if ( ui->oncoutpe() )
+          cout << " <ERROR> saveden_format stride must be a positive integer, and 1 with cube </ERROR>" << endl;
+        return 1;
+      }
+    }
+    s->ctrl.saveden_format = v;
+    s->ctrl.saveden_stride = stride;
+    return 0;
+  }
+
+  string print (void) const {
+     ostringstream st;
+     st.setf(ios::left,ios::adjustfield);
+     st << setw(10) << name() << " = ";
+     st.setf(ios::right,ios::adjustfield);
+     st << setw(10) << s->ctrl.saveden_format;
+     if ( s->ctrl.saveden_stride > 1 )
+       st << " " << s->ctrl.saveden_stride;
+     return st.str();
+  }
+
+  SaveDenFormat(Sample *sample) : s(sample)
+  {
+    s->ctrl.saveden_format = "cube";
+    s->ctrl.saveden_stride = 1;
+  };
+};
+#endif
+
+// Local Variables:
+// mode: c++
+// End:
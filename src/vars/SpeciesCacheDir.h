@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// SpeciesCacheDir.h
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#ifndef SPECIESCACHEDIR_H
+#define SPECIESCACHEDIR_H
+
+#include<iostream>
+#include<iomanip>
+#include<sstream>
+#include<stdlib.h>
+#include<errno.h>
+#include<sys/stat.h>
+
+#include <qball/Sample.h>
+
+// species_cache directory|OFF
+// Keep the initialized species (radial grids, splines and projectors in
+// reciprocal space) in directory, see qball/SpeciesCache.h. Species
+// defined later with the same pseudopotential and Ewald width are read
+// from the cache instead of being recomputed. Must be set before the
+// species commands.
+
+class SpeciesCacheDir : public Var {
+  Sample *s;
+
+  public:
+
+  char const*name ( void ) const { return "species_cache"; };
+
+  int set ( int argc, char **argv ) {
+    if ( argc != 2 ) {
+      if ( ui->oncoutpe() )
+      cout << " <ERROR> species_cache takes only one value </ERROR>" << endl;
+      return 1;
+    }
+    
+    string v = argv[1];
+    if ( v != "OFF" && ui->oncoutpe() ) {
+      if ( mkdir(v.c_str(),0755) != 0 && errno != EEXIST )
+        cout << " <WARNING> species_cache: cannot create " << v << " </WARNING>" << endl;
+    }
+    s->ctrl.species_cache = v;
+    return 0;
+  }
+
+  string print (void) const {
+     ostringstream st;
+     st.setf(ios::left,ios::adjustfield);
+     st << setw(10) << name() << " = ";
+     st.setf(ios::right,ios::adjustfield);
+     st << setw(10) << s->ctrl.species_cache;
+     return st.str();
+  }
+
+  SpeciesCacheDir(Sample *sample) : s(sample) { s->ctrl.species_cache = "OFF"; };
+};
+#endif
+
+// Local Variables:
+// mode: c++
+// End:
@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2013, Lawrence Livermore National Security, LLC.
+// qb@ll:  Qbox at Lawrence Livermore
+//
+// This file is part of qb@ll.
+//
+// Produced at the Lawrence Livermore National Laboratory.
+// Written by Erik Draeger (draeger1@llnl.gov) and Francois Gygi (fgygi@ucdavis.edu).
+// Based on the Qbox code by Francois Gygi Copyright (c) 2008
+// LLNL-CODE-635376. All rights reserved.
+//
+// qb@ll is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details, in the file COPYING in the
+// root directory of this distribution or <http://www.gnu.org/licenses/>.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// TDDtAdapt.h
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <config.h>
+
+#ifndef TDDTADAPT_H
+#define TDDTADAPT_H
+
+#include<iostream>
+#include<iomanip>
+#include<sstream>
+#include<stdlib.h>
+
+#include <qball/Sample.h>
+
+// tddt_adapt tol [dtmin dtmax]
+// Enables the adaptive TD time step: after each step the time step is
+// rescaled so that the embedded error estimate of the propagator stays
+// close to tol. With fixed ions and cell, a step whose error exceeds tol
+// is redone with a smaller time step. A tolerance of zero keeps TD_dt
+// fixed. If dtmin and dtmax are not given, the time step is bounded by
+// 0.1*TD_dt and 10*TD_dt.
+
+class TDDtAdapt : public Var {
+  Sample *s;
+
+  public:
+
+  char const*name ( void ) const { return "tddt_adapt"; };
+
+  int set ( int argc, char **argv ) {
+    if ( argc != 2 && argc != 4 ) {
+      if ( ui->oncoutpe() )
+      cout << " <ERROR> tddt_adapt takes one or three values </ERROR>" << endl;
+      return 1;
+    }
+    
+    double v = atof(argv[1]);
+    if ( v < 0.0 ) {
+      if ( ui->oncoutpe() )
+        cout << " <ERROR> tddt_adapt tolerance must be non-negative </ERROR>" << endl;
+      return 1;
+    }
+    double dtmin = 0.0;
+    double dtmax = 0.0;
+    if (argc == 4) {
+      dtmin = atof(argv[2]);
+      dtmax = atof(argv[3]);
+      if ( dtmin <= 0.0 || dtmax < dtmin ) {
+        if ( ui->oncoutpe() )
+          cout << " <ERROR> tddt_adapt requires 0 < dtmin <= dtmax </ERROR>" << endl;
+        return 1;
+      }
+    }
+    s->ctrl.tddt_tol = v;
+    s->ctrl.tddt_min = dtmin;
+    s->ctrl.tddt_max = dtmax;
+    return 0;
+  }
+
+  string print (void) const {
+     ostringstream st;
+     st.setf(ios::left,ios::adjustfield);
+     st << setw(10) << name() << " = ";
+     st.setf(ios::right,ios::adjustfield);
+     st << setw(10) << s->ctrl.tddt_tol << "  " << s->ctrl.tddt_min
+        << "  " << s->ctrl.tddt_max;
+     return st.str();
+  }
+
+  TDDtAdapt(Sample *sample) : s(sample) { 
+    s->ctrl.tddt_tol = 0.0; 
+    s->ctrl.tddt_min = 0.0; 
+    s->ctrl.tddt_max = 0.0; 
+  };
+};
+#endif
+
+// Local Variables:
+// mode: c++
+// End:
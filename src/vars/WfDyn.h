@@ -71,15 +71,19 @@ class WfDyn : public Var
 	    v == "SOTD"    ||
 	    v == "SORKTD"  ||
             v == "FORKTD"  ||
+            v == "LSRK4"   ||
 	    v == "ETRS"    ||
-	    v == "AETRS" ) )
+	    v == "AETRS"   ||
+	    v == "KRYLOV"  ||
+	    v == "CHEBYSHEV" ||
+	    v == "CFM4" ) )
     {
        if ( ui->oncoutpe() )
-          cout << " wf_dyn must be in [LOCKED,SD,PSD,PSDA,RMMDIIS,JD,MD,TDEULER,SOTD,SORKTD,FORKTD,ETRS,AETRS]" << endl;
+          cout << " wf_dyn must be in [LOCKED,SD,PSD,PSDA,RMMDIIS,JD,MD,TDEULER,SOTD,SORKTD,FORKTD,LSRK4,ETRS,AETRS,KRYLOV,CHEBYSHEV,CFM4]" << endl;
        return 1;
     }
 
-    if (v == "TDEULER" || v == "SOTD" || v == "SORKTD" || v == "FORKTD" || v == "ETRS" || v == "AETRS") {
+    if (v == "TDEULER" || v == "SOTD" || v == "SORKTD" || v == "FORKTD" || v == "LSRK4" || v == "ETRS" || v == "AETRS" || v == "KRYLOV" || v == "CHEBYSHEV" || v == "CFM4") {
        s->ctrl.tddft_involved = true;
        if (!( s->wf.force_complex_set() )) {
           cout << "WfDyn::wave functions must be complex to propagate them in time" << endl